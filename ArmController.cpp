@@ -11,15 +11,21 @@ ArmController::ArmController(QObject *parent)
     , m_wristAngle(90)
     , m_gripperAngle(90)
     , m_serverUrl("http://192.168.4.1/setServo")
+    , m_pendingCommand(RobotProtocol::Command::servos())
+    , m_lastCommand(RobotProtocol::Command::servos())
 {
     // Connect to network manager signals
     connect(m_networkManager, &NetworkManager::requestFinished,
             this, &ArmController::onNetworkRequestFinished);
+    connect(m_networkManager, &NetworkManager::linkQualityChanged,
+            this, &ArmController::onLinkQualityChanged);
 
     // Setup command batching timer
     m_commandTimer->setSingleShot(true);
     m_commandTimer->setInterval(COMMAND_BATCH_TIMEOUT);
     connect(m_commandTimer, &QTimer::timeout, this, &ArmController::sendPendingCommands);
+
+    m_networkManager->setHostUrl(m_serverUrl);
 }
 
 void ArmController::setBaseAngle(int angle)
@@ -27,7 +33,7 @@ void ArmController::setBaseAngle(int angle)
     if (isValidAngle(angle) && m_baseAngle != angle) {
         m_baseAngle = angle;
         emit baseAngleChanged();
-        queueServoCommand("base", angle);
+        queueServoCommand(RobotProtocol::Base, angle);
     }
 }
 
@@ -36,7 +42,7 @@ void ArmController::setShoulderAngle(int angle)
     if (isValidAngle(angle) && m_shoulderAngle != angle) {
         m_shoulderAngle = angle;
         emit shoulderAngleChanged();
-        queueServoCommand("shoulder", angle);
+        queueServoCommand(RobotProtocol::Shoulder, angle);
     }
 }
 
@@ -45,7 +51,7 @@ void ArmController::setElbowAngle(int angle)
     if (isValidAngle(angle) && m_elbowAngle != angle) {
         m_elbowAngle = angle;
         emit elbowAngleChanged();
-        queueServoCommand("elbow", angle);
+        queueServoCommand(RobotProtocol::Elbow, angle);
     }
 }
 
@@ -54,7 +60,7 @@ void ArmController::setWristAngle(int angle)
     if (isValidAngle(angle) && m_wristAngle != angle) {
         m_wristAngle = angle;
         emit wristAngleChanged();
-        queueServoCommand("wrist", angle);
+        queueServoCommand(RobotProtocol::Wrist, angle);
     }
 }
 
@@ -63,7 +69,7 @@ void ArmController::setGripperAngle(int angle)
     if (isValidAngle(angle) && m_gripperAngle != angle) {
         m_gripperAngle = angle;
         emit gripperAngleChanged();
-        queueServoCommand("gripper", angle);
+        queueServoCommand(RobotProtocol::Gripper, angle);
     }
 }
 
@@ -72,102 +78,50 @@ void ArmController::setServerUrl(const QString &url)
     if (m_serverUrl != url) {
         m_serverUrl = url;
         emit serverUrlChanged();
+        m_networkManager->setHostUrl(url);
     }
 }
 
 void ArmController::moveBase(int angle)
 {
-    if (isValidAngle(angle)) {
-        QString command = QString("base=%1").arg(angle);
-        sendServoCommand(command);
-
-        // Update internal state
-        m_baseAngle = angle;
-        emit baseAngleChanged();
-    }
+    moveServo(RobotProtocol::Base, angle);
 }
 
 void ArmController::moveShoulder(int angle)
 {
-    if (isValidAngle(angle)) {
-        QString command = QString("shoulder=%1").arg(angle);
-        sendServoCommand(command);
-
-        // Update internal state
-        m_shoulderAngle = angle;
-        emit shoulderAngleChanged();
-    }
+    moveServo(RobotProtocol::Shoulder, angle);
 }
 
 void ArmController::moveElbow(int angle)
 {
-    if (isValidAngle(angle)) {
-        QString command = QString("elbow=%1").arg(angle);
-        sendServoCommand(command);
-
-        // Update internal state
-        m_elbowAngle = angle;
-        emit elbowAngleChanged();
-    }
+    moveServo(RobotProtocol::Elbow, angle);
 }
 
 void ArmController::moveWrist(int angle)
 {
-    if (isValidAngle(angle)) {
-        QString command = QString("wrist=%1").arg(angle);
-        sendServoCommand(command);
-
-        // Update internal state
-        m_wristAngle = angle;
-        emit wristAngleChanged();
-    }
+    moveServo(RobotProtocol::Wrist, angle);
 }
 
 void ArmController::moveGripper(int angle)
 {
-    if (isValidAngle(angle)) {
-        QString command = QString("gripper=%1").arg(angle);
-        sendServoCommand(command);
-
-        // Update internal state
-        m_gripperAngle = angle;
-        emit gripperAngleChanged();
-    }
+    moveServo(RobotProtocol::Gripper, angle);
 }
 
 void ArmController::moveMultipleServos(const QVariantMap &servos)
 {
-    QStringList commandParts;
+    RobotProtocol::Command command = RobotProtocol::Command::servos();
 
     for (auto it = servos.begin(); it != servos.end(); ++it) {
-        QString servo = it.key().toLower();
+        int servo = RobotProtocol::servoIndex(it.key());
         int angle = it.value().toInt();
 
-        if (isValidAngle(angle)) {
-            commandParts << QString("%1=%2").arg(servo).arg(angle);
-
-            // Update internal state
-            if (servo == "base") {
-                m_baseAngle = angle;
-                emit baseAngleChanged();
-            } else if (servo == "shoulder") {
-                m_shoulderAngle = angle;
-                emit shoulderAngleChanged();
-            } else if (servo == "elbow") {
-                m_elbowAngle = angle;
-                emit elbowAngleChanged();
-            } else if (servo == "wrist") {
-                m_wristAngle = angle;
-                emit wristAngleChanged();
-            } else if (servo == "gripper") {
-                m_gripperAngle = angle;
-                emit gripperAngleChanged();
-            }
+        if (servo >= 0 && isValidAngle(angle)) {
+            command.setServo(servo, angle);
+            setServoState(servo, angle);
         }
     }
 
-    if (!commandParts.isEmpty()) {
-        QString command = commandParts.join("&");
+    if (!command.isEmpty()) {
         sendServoCommand(command);
     }
 }
@@ -214,15 +168,22 @@ void ArmController::onNetworkRequestFinished(QObject *requester, bool success, c
     }
 }
 
+void ArmController::onLinkQualityChanged()
+{
+    // Batch servo moves for longer when the link is degraded
+    m_commandTimer->setInterval(qMax(static_cast<int>(COMMAND_BATCH_TIMEOUT),
+                                     m_networkManager->recommendedSendInterval()));
+}
+
 void ArmController::sendPendingCommands()
 {
-    if (m_pendingCommands.isEmpty()) {
+    if (m_pendingCommand.isEmpty()) {
         return;
     }
 
-    // Combine all pending commands into one request
-    QString command = m_pendingCommands.join("&");
-    m_pendingCommands.clear();
+    // Combine all pending servo moves into one request
+    RobotProtocol::Command command = m_pendingCommand;
+    m_pendingCommand = RobotProtocol::Command::servos();
 
     sendServoCommand(command);
 }
@@ -232,23 +193,56 @@ bool ArmController::isValidAngle(int angle) const
     return angle >= MIN_SERVO_ANGLE && angle <= MAX_SERVO_ANGLE;
 }
 
-void ArmController::queueServoCommand(const QString &servo, int angle)
+void ArmController::queueServoCommand(int servo, int angle)
 {
-    // Remove any existing command for this servo
-    for (int i = m_pendingCommands.size() - 1; i >= 0; --i) {
-        if (m_pendingCommands[i].startsWith(servo + "=")) {
-            m_pendingCommands.removeAt(i);
-        }
-    }
-
-    // Add new command
-    m_pendingCommands << QString("%1=%2").arg(servo).arg(angle);
+    // A newer angle for the same servo replaces the pending one
+    m_pendingCommand.setServo(servo, angle);
 
     // Start/restart timer
     m_commandTimer->start();
 }
 
-void ArmController::sendServoCommand(const QString &command)
+void ArmController::moveServo(int servo, int angle)
+{
+    if (isValidAngle(angle)) {
+        RobotProtocol::Command command = RobotProtocol::Command::servos();
+        command.setServo(servo, angle);
+        sendServoCommand(command);
+
+        // Update internal state
+        setServoState(servo, angle);
+    }
+}
+
+void ArmController::setServoState(int servo, int angle)
+{
+    switch (servo) {
+    case RobotProtocol::Base:
+        m_baseAngle = angle;
+        emit baseAngleChanged();
+        break;
+    case RobotProtocol::Shoulder:
+        m_shoulderAngle = angle;
+        emit shoulderAngleChanged();
+        break;
+    case RobotProtocol::Elbow:
+        m_elbowAngle = angle;
+        emit elbowAngleChanged();
+        break;
+    case RobotProtocol::Wrist:
+        m_wristAngle = angle;
+        emit wristAngleChanged();
+        break;
+    case RobotProtocol::Gripper:
+        m_gripperAngle = angle;
+        emit gripperAngleChanged();
+        break;
+    default:
+        break;
+    }
+}
+
+void ArmController::sendServoCommand(const RobotProtocol::Command &command)
 {
     if (command.isEmpty() || command == m_lastCommand) {
         return;
@@ -256,10 +250,11 @@ void ArmController::sendServoCommand(const QString &command)
 
     m_lastCommand = command;
 
-    qDebug() << "ArmController: Sending servo command:" << command;
+    QString description = RobotProtocol::describe(command);
+    qDebug() << "ArmController: Sending servo command:" << description;
 
-    m_networkManager->sendPostRequest(m_serverUrl, command.toUtf8(),
-                                      "application/x-www-form-urlencoded", this);
+    m_networkManager->sendCommand(m_serverUrl, command, this);
 
-    emit commandSent(command);
+    emit commandIssued(command);
+    emit commandSent(description);
 }
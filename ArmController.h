@@ -3,8 +3,9 @@
 
 #include <QObject>
 #include <QTimer>
-#include <QStringList>
+#include <QVariantMap>
 #include "NetworkManager.h"
+#include "RobotProtocol.h"
 
 class ArmController : public QObject
 {
@@ -60,16 +61,20 @@ signals:
     void gripperAngleChanged();
     void serverUrlChanged();
     void commandSent(const QString &command);
+    void commandIssued(const RobotProtocol::Command &command);
     void networkError(const QString &error);
 
 private slots:
     void onNetworkRequestFinished(QObject *requester, bool success, const QString &errorString);
     void sendPendingCommands();
+    void onLinkQualityChanged();
 
 private:
     bool isValidAngle(int angle) const;
-    void queueServoCommand(const QString &servo, int angle);
-    void sendServoCommand(const QString &command);
+    void queueServoCommand(int servo, int angle);
+    void sendServoCommand(const RobotProtocol::Command &command);
+    void setServoState(int servo, int angle);
+    void moveServo(int servo, int angle);
 
     NetworkManager *m_networkManager;
     QTimer *m_commandTimer;
@@ -82,8 +87,8 @@ private:
     QString m_serverUrl;
 
     // For batching commands
-    QStringList m_pendingCommands;
-    QString m_lastCommand;
+    RobotProtocol::Command m_pendingCommand;
+    RobotProtocol::Command m_lastCommand;
 
     static const int COMMAND_BATCH_TIMEOUT = 100; // ms
     static const int MIN_SERVO_ANGLE = 0;
@@ -1,13 +1,13 @@
 #include "CarController.h"
 #include <QDebug>
+#include "PoseEstimator.h"
 #include <QtMath>
 
 CarController::CarController(QObject *parent)
     : QObject(parent)
     , m_networkManager(NetworkManager::instance())
     , m_steeringCenterTimer(new QTimer(this))
-    , m_sendDebounceTimer(new QTimer(this))
-    , m_serialPort(new QSerialPort(this))
+    , m_controlTimer(new QTimer(this))
     , m_speedValue(0)
     , m_turnValue(0)
     , m_processedSpeed(0)
@@ -19,8 +19,27 @@ CarController::CarController(QObject *parent)
     , m_speedPressed(false)
     , m_leftMotorSpeed(0)
     , m_rightMotorSpeed(0)
+    , m_lastCommand(RobotProtocol::Command::stop())
+    , m_controlRate(DEFAULT_CONTROL_RATE)
+    , m_minTicksBetweenSends(1)
+    , m_ticksSinceSend(0)
+    , m_lastTickNs(0)
+    , m_maxTickJitter(0.0)
+    , m_tickOverruns(0)
+    , m_ticksSinceStats(0)
+    , m_serialThread(new QThread(this))
+    , m_serialWorker(new SerialInputWorker(&m_serialQueue))
+    , m_pendingInputUs(0)
+    , m_gamepadThread(new QThread(this))
+    , m_gamepad(new GamepadInput(&m_gamepadQueue, &m_gamepadReleasedUs))
+    , m_gamepadReleasedUs(0)
+    , m_gamepadActive(false)
+    , m_poseEstimator(nullptr)
+    , m_poseUpdatedMs(-1)
+    , m_ticksSinceProgress(0)
     , m_ignoreHardwareInput(false)  // Initialize hardware ignore flag
     , m_emergencyStopActive(false)  // Initialize emergency stop flag
+    , m_inputSinceStop(true)
     , m_hardwareControlActive(false)  // Initialize hardware control flag
 {
     // Connect to network manager signals
@@ -28,18 +47,56 @@ CarController::CarController(QObject *parent)
             this, &CarController::onNetworkRequestFinished);
     connect(m_networkManager, &NetworkManager::connectionStatusChanged,
             this, &CarController::onNetworkConnectionChanged);
+    connect(m_networkManager, &NetworkManager::linkQualityChanged,
+            this, &CarController::onLinkQualityChanged);
 
     // Setup steering auto-center timer
     m_steeringCenterTimer->setSingleShot(true);
     m_steeringCenterTimer->setInterval(STEERING_CENTER_TIMEOUT);
     connect(m_steeringCenterTimer, &QTimer::timeout, this, &CarController::onSteeringCenterTimer);
 
-    // Setup debounce timer for sending requests
-    m_sendDebounceTimer->setSingleShot(true);
-    m_sendDebounceTimer->setInterval(80); // ~80ms debounce
-    connect(m_sendDebounceTimer, &QTimer::timeout, this, &CarController::sendControlCommand);
+    // Fixed-rate control tick; input changes only update state, and each
+    // tick sends at most one command built from the current state
+    m_controlTimer->setTimerType(Qt::PreciseTimer);
+    m_controlTimer->setInterval(qRound(1000.0 / m_controlRate));
+    connect(m_controlTimer, &QTimer::timeout, this, &CarController::onControlTick);
+    updateSendSpacing();
+    m_tickClock.start();
+
+    m_outputStage.setThreshold(DEFAULT_OUTPUT_THRESHOLD);
+    m_outputStage.setMaxSlewPerTick(DEFAULT_MAX_SLEW_PER_TICK);
+    m_outputStage.setKeepaliveInterval(DEFAULT_KEEPALIVE_INTERVAL);
+    m_controlTimer->start();
+
+    // Open the robot connection now so the first command doesn't pay for it
+    m_networkManager->setHostUrl(m_serverUrl);
+
+    // Serial input is read and timestamped off the GUI thread; the control
+    // tick drains it
+    m_serialThread->setObjectName("CarController serial");
+    m_serialWorker->moveToThread(m_serialThread);
+    connect(m_serialThread, &QThread::started, m_serialWorker, &SerialInputWorker::open);
+    connect(m_serialThread, &QThread::finished, m_serialWorker, &QObject::deleteLater);
+    connect(m_serialWorker, &SerialInputWorker::portStatusChanged, this, &CarController::onSerialPortStatus,
+            Qt::QueuedConnection);
+    m_serialThread->start(QThread::HighPriority);
+
+    m_gamepadAxes[GamepadInput::SpeedAxis].invert = true; // Stick forward reports negative Y
+    m_gamepadThread->setObjectName("CarController gamepad");
+    m_gamepad->moveToThread(m_gamepadThread);
+    connect(m_gamepadThread, &QThread::started, m_gamepad, &GamepadInput::start);
+    connect(m_gamepadThread, &QThread::finished, m_gamepad, &QObject::deleteLater);
+    connect(m_gamepad, &GamepadInput::deviceChanged, this, &CarController::onGamepadChanged,
+            Qt::QueuedConnection);
+    m_gamepadThread->start(QThread::HighPriority);
+}
 
-    initSerialPort();
+CarController::~CarController()
+{
+    m_serialThread->quit();
+    m_gamepadThread->quit();
+    m_serialThread->wait();
+    m_gamepadThread->wait();
 }
 
 // bool CarController::isConnected() const
@@ -50,26 +107,22 @@ CarController::CarController(QObject *parent)
 void CarController::setSpeedValue(int speed)
 {
     if (m_speedValue != speed) {
+        m_inputSinceStop = true;
         m_speedValue = speed;
         emit speedValueChanged();
 
-        applyDeadZones();
-        updateMotorSpeeds();
-
-        m_sendDebounceTimer->start();
+        applyManualInput();
     }
 }
 
 void CarController::setTurnValue(int turn)
 {
     if (m_turnValue != turn) {
+        m_inputSinceStop = true;
         m_turnValue = turn;
         emit turnValueChanged();
 
-        applyDeadZones();
-        updateMotorSpeeds();
-
-        m_sendDebounceTimer->start();
+        applyManualInput();
 
         // Only start auto-center timer if not currently pressed AND no hardware input and value is not 0
         if (!m_steeringPressed && !m_hardwareControlActive && turn != 0) {
@@ -103,6 +156,7 @@ void CarController::setServerUrl(const QString &url)
     if (m_serverUrl != url) {
         m_serverUrl = url;
         emit serverUrlChanged();
+        m_networkManager->setHostUrl(url);
     }
 }
 
@@ -124,6 +178,204 @@ void CarController::setTurnDeadZone(int deadZone)
     }
 }
 
+void CarController::setControlRate(int hz)
+{
+    hz = qBound(static_cast<int>(MIN_CONTROL_RATE), hz, static_cast<int>(MAX_CONTROL_RATE));
+    if (m_controlRate != hz) {
+        m_controlRate = hz;
+        m_controlTimer->setInterval(qRound(1000.0 / m_controlRate));
+        updateSendSpacing();
+
+        m_tickPeriods.reset();
+        m_maxTickJitter = 0.0;
+        m_tickOverruns = 0;
+        m_lastTickNs = 0;
+        emit controlRateChanged();
+        emit controlStatsChanged();
+    }
+}
+
+void CarController::setOutputThreshold(int threshold)
+{
+    if (m_outputStage.threshold() != qMax(0, threshold)) {
+        m_outputStage.setThreshold(threshold);
+        emit outputShapingChanged();
+    }
+}
+
+void CarController::setMaxSlewPerTick(int step)
+{
+    if (m_outputStage.maxSlewPerTick() != qMax(0, step)) {
+        m_outputStage.setMaxSlewPerTick(step);
+        emit outputShapingChanged();
+    }
+}
+
+void CarController::setKeepaliveInterval(int ms)
+{
+    if (m_outputStage.keepaliveInterval() != qMax(0, ms)) {
+        m_outputStage.setKeepaliveInterval(ms);
+        emit outputShapingChanged();
+    }
+}
+
+void CarController::setFollowerMode(int mode)
+{
+    const PathFollower::Mode followerMode = mode == PathFollower::Stanley ? PathFollower::Stanley
+                                                                          : PathFollower::PurePursuit;
+    if (m_pathFollower.mode() != followerMode) {
+        m_pathFollower.setMode(followerMode);
+        emit followerSettingsChanged();
+    }
+}
+
+void CarController::setFollowerLookahead(double distance)
+{
+    if (m_pathFollower.lookahead() != qMax(1.0, distance)) {
+        m_pathFollower.setLookahead(distance);
+        emit followerSettingsChanged();
+    }
+}
+
+void CarController::setFollowerSpeed(int speed)
+{
+    if (m_pathFollower.cruiseSpeed() != qBound(0, speed, 255)) {
+        m_pathFollower.setCruiseSpeed(speed);
+        emit followerSettingsChanged();
+    }
+}
+
+bool CarController::followPath(const QVariantList &route)
+{
+    if (m_emergencyStopActive) {
+        qDebug() << "CarController: Can't follow a route during an emergency stop";
+        return false;
+    }
+    if (!refreshPose()) {
+        qDebug() << "CarController: Can't follow a route without a current pose estimate; place the robot first";
+        return false;
+    }
+
+    // A route already being followed is replaced
+    cancelPath();
+    if (!m_pathFollower.setRoute(route)) {
+        qDebug() << "CarController: Route with" << route.size() << "points can't be followed";
+        return false;
+    }
+
+    // The route drives from here on; the manual controls start from zero so
+    // that moving any of them is a clear takeover
+    if (m_speedValue != 0) {
+        m_speedValue = 0;
+        emit speedValueChanged();
+    }
+    if (m_turnValue != 0) {
+        m_turnValue = 0;
+        emit turnValueChanged();
+    }
+    m_steeringCenterTimer->stop();
+    m_inputSinceStop = true;
+
+    qDebug() << "CarController: Following route with" << route.size() << "points";
+    m_ticksSinceProgress = 0;
+    emit followingPathChanged();
+    emit pathProgressChanged();
+    return true;
+}
+
+void CarController::cancelPath()
+{
+    if (!m_pathFollower.isActive()) {
+        return;
+    }
+
+    qDebug() << "CarController: Route following cancelled";
+    m_pathFollower.clear();
+
+    // Back to whatever the manual controls say
+    applyDeadZones();
+    updateMotorSpeeds();
+    emit followingPathChanged();
+    emit pathProgressChanged();
+}
+
+void CarController::setPose(double x, double y, double heading)
+{
+    if (m_poseEstimator) {
+        m_poseEstimator->reset(x, y, heading);
+    }
+
+    m_pose.x = x;
+    m_pose.y = y;
+    m_pose.heading = heading;
+    m_poseUpdatedMs = m_tickClock.elapsed();
+}
+
+bool CarController::refreshPose()
+{
+    if (m_poseEstimator) {
+        // An estimator that was never placed has nothing to follow from,
+        // and one whose thread has stalled is as stale as any other source
+        quint64 updatedUs;
+        if (!m_poseEstimator->currentPose(m_pose, updatedUs)) {
+            return false;
+        }
+        const qint64 ageUs = static_cast<qint64>(RobotProtocol::timestampUs() - updatedUs);
+        return ageUs <= POSE_TIMEOUT * 1000LL;
+    }
+    return m_poseUpdatedMs >= 0 && m_tickClock.elapsed() - m_poseUpdatedMs <= POSE_TIMEOUT;
+}
+
+void CarController::updatePathFollowing()
+{
+    // Steering on an old pose would drive blind
+    if (!refreshPose()) {
+        qDebug() << "CarController: Pose estimate is stale, stopping route following";
+        cancelPath();
+        return;
+    }
+
+    int speed, turn;
+    const bool following = m_pathFollower.update(m_pose, speed, turn);
+
+    // Dead zones are for human input; the follower's small corrections must
+    // reach the motors
+    m_processedSpeed = speed;
+    m_processedTurn = turn;
+    updateMotorSpeeds();
+
+    if (!following) {
+        qDebug() << "CarController: Route complete";
+        emit followingPathChanged();
+        emit pathProgressChanged();
+        emit pathFinished();
+    } else if (++m_ticksSinceProgress >= PROGRESS_UPDATE_TICKS) {
+        m_ticksSinceProgress = 0;
+        emit pathProgressChanged();
+    }
+}
+
+void CarController::applyManualInput()
+{
+    const bool active = qAbs(m_speedValue) > m_speedDeadZone || qAbs(m_turnValue) > m_turnDeadZone;
+    if (active) {
+        // Driving by hand again ends the emergency stop
+        m_emergencyStopActive = false;
+    }
+
+    if (m_pathFollower.isActive()) {
+        // Only input outside the dead zones takes over from the route;
+        // the serial controller streams jitter inside them all the time
+        if (active) {
+            cancelPath();
+        }
+        return;
+    }
+
+    applyDeadZones();
+    updateMotorSpeeds();
+}
+
 void CarController::applyDeadZones()
 {
     // Apply speed dead zone
@@ -198,57 +450,152 @@ void CarController::calculateMotorSpeeds(int &leftSpeed, int &rightSpeed)
     rightSpeed = qBound(-255, rightSpeed, 255);
 }
 
-void CarController::sendControlCommand()
+int CarController::quantizeSpeed(int speed, int step)
+{
+    if (step <= 1) {
+        return speed;
+    }
+    // Round to the nearest step; zero always stays zero so stops are exact
+    int magnitude = (qAbs(speed) + step / 2) / step * step;
+    return qBound(-255, speed < 0 ? -magnitude : magnitude, 255);
+}
+
+bool CarController::sendControlCommand()
 {
     int leftSpeed, rightSpeed;
     calculateMotorSpeeds(leftSpeed, rightSpeed);
 
-    QString command = QString("%1 %2").arg(leftSpeed).arg(rightSpeed);
-    QString formData = QString("plain=%1").arg(command);
-
-    // Only send if there's a change from the last command
-    if (command != m_lastCommand) {
+    // On a poor link, send coarser speeds so small input wobble doesn't
+    // produce a stream of new commands
+    int step = m_networkManager->recommendedSpeedStep();
+    leftSpeed = quantizeSpeed(leftSpeed, step);
+    rightSpeed = quantizeSpeed(rightSpeed, step);
+
+    // Hold back jitter, limit acceleration and refresh a steady command.
+    // The slew step covers at most one send spacing; ticks spent driving
+    // steadily before a keepalive don't add up to one large jump.
+    const int ticks = qMin(m_ticksSinceSend, m_minTicksBetweenSends);
+    int left, right;
+    if (m_outputStage.update(leftSpeed, rightSpeed, ticks, m_tickClock.elapsed(), left, right)) {
+        RobotProtocol::Command command = RobotProtocol::Command::drive(left, right);
         m_lastCommand = command;
 
-        m_networkManager->sendPostRequest(m_serverUrl, formData.toUtf8(),
-                                          "application/x-www-form-urlencoded", this);
+        m_networkManager->sendCommand(m_serverUrl, command, this, m_pendingInputUs, m_inputSinceStop);
+        m_pendingInputUs = 0;
+
+        QString description = RobotProtocol::describe(command);
+        emit commandIssued(command);
+        emit commandSent(description);
+        qDebug() << "CarController: Sending command:" << description;
+        return true;
+    }
+
+    // The input changed nothing on the wire, so there is no latency to measure
+    m_pendingInputUs = 0;
+    return false;
+}
 
-        emit commandSent(command);
-        qDebug() << "CarController: Sending command:" << command << "as form data:" << formData;
+void CarController::onControlTick()
+{
+    // Tick timing: deviation from the nominal period, and ticks that came
+    // so late that at least one was skipped
+    const qint64 nowNs = m_tickClock.nsecsElapsed();
+    if (m_lastTickNs != 0) {
+        const double periodMs = (nowNs - m_lastTickNs) / 1e6;
+        const double nominalMs = m_controlTimer->interval();
+        m_tickPeriods.add(periodMs);
+        m_maxTickJitter = qMax(m_maxTickJitter, qAbs(periodMs - nominalMs));
+        if (periodMs >= 2 * nominalMs) {
+            m_tickOverruns++;
+        }
+    }
+    m_lastTickNs = nowNs;
+
+    drainInputs();
+    runControlStep();
+
+    // The handler itself taking longer than a period is an overrun too
+    if (m_tickClock.nsecsElapsed() - nowNs > m_controlTimer->interval() * 1000000LL) {
+        m_tickOverruns++;
+    }
+
+    if (++m_ticksSinceStats >= m_controlRate) {
+        m_ticksSinceStats = 0;
+        emit controlStatsChanged();
     }
 }
 
-void CarController::stopCar()
+void CarController::runControlStep()
 {
-    int leftSpeed = 0;
-    int rightSpeed = 0;
-    int speedValue = 0;
+    if (m_pathFollower.isActive()) {
+        updatePathFollowing();
+    }
+
+    m_ticksSinceSend++;
+    if (m_ticksSinceSend >= m_minTicksBetweenSends) {
+        if (sendControlCommand()) {
+            m_ticksSinceSend = 0;
+        }
+    }
+}
 
+void CarController::stepControl()
+{
+    // As if a full send spacing had passed, so the step is evaluated and
+    // slew limited as it would be live
+    m_ticksSinceSend = m_minTicksBetweenSends - 1;
+    runControlStep();
+}
+
+void CarController::updateSendSpacing()
+{
+    // The tick rate governs sends. Only a link measured as degraded backs
+    // off to its recommended interval; an unmeasured one gets the benefit
+    // of the doubt.
+    if (!m_networkManager->linkMeasured() || m_networkManager->linkQuality() >= DEGRADED_LINK_SCORE) {
+        m_minTicksBetweenSends = 1;
+        return;
+    }
+    const int interval = m_controlTimer->interval();
+    m_minTicksBetweenSends = qMax(1, (m_networkManager->recommendedSendInterval() + interval - 1) / interval);
+}
+
+void CarController::stopCar()
+{
     // Set emergency stop active flag
     m_emergencyStopActive = true;
     m_ignoreHardwareInput = true;
+    cancelPath();
+    // Until new input arrives, nothing may cancel the stop's retries
+    m_inputSinceStop = false;
 
-    if(m_speedValue != speedValue){
+    if (m_speedValue != 0) {
         m_speedValue = 0;
         emit speedValueChanged();
+    }
+    if (m_turnValue != 0) {
+        m_turnValue = 0;
+        emit turnValueChanged();
+    }
+    m_steeringCenterTimer->stop();
 
-        if (m_leftMotorSpeed != leftSpeed || m_rightMotorSpeed != rightSpeed) {
-            m_leftMotorSpeed = leftSpeed;
-            m_rightMotorSpeed = rightSpeed;
-            emit motorSpeedsChanged();
-        }
-
-        QString command = QString("%1 %2").arg(0).arg(0);
+    // The control tick mixes the processed values; left as they were, the
+    // next tick would send the old drive command again
+    applyDeadZones();
+    updateMotorSpeeds();
 
-        if (command != m_lastCommand) {
-            m_lastCommand = command;
+    // Always sent, even if the last command was already a stop: it may not
+    // have arrived, and drive commands may still be queued behind it
+    RobotProtocol::Command command = RobotProtocol::Command::stop();
+    m_lastCommand = command;
+    m_outputStage.setOutput(0, 0, m_tickClock.elapsed());
+    m_pendingInputUs = 0;
 
-            m_networkManager->sendPostRequest(m_serverUrl, command.toUtf8(), "text/plain", this);
+    m_networkManager->sendStop(m_serverUrl, this);
 
-            emit commandSent(command);
-            qDebug() << "CarController: Emergency stop activated - ignoring hardware input until controls return to dead zone";
-        }
-    }
+    emit commandIssued(command);
+    emit commandSent(RobotProtocol::describe(command));
+    qDebug() << "CarController: Emergency stop activated - ignoring hardware input until controls return to dead zone";
 }
 
 void CarController::centerSteering()
@@ -282,130 +629,181 @@ void CarController::onNetworkConnectionChanged()
     emit connectionStatusChanged();
 }
 
+void CarController::onSerialPortStatus(bool open, const QString &portName)
+{
+    const QString port = open ? portName : QString();
+    if (m_hardwarePort == port) {
+        return;
+    }
+    m_hardwarePort = port;
+    emit hardwareConnectionChanged();
+
+    // A controller unplugged mid-drive must not leave its last input applied
+    if (!open) {
+        InputSample stale;
+        while (m_serialQueue.pop(stale)) {
+        }
+        m_pendingInputUs = 0;
+    }
+    if (!open && m_hardwareControlActive) {
+        qDebug() << "CarController: Hardware controller lost while active, releasing its input";
+        applyHardwareInput(0, 0);
+    }
+}
+
+void CarController::onGamepadChanged(bool connected, const QString &name)
+{
+    m_gamepadName = connected ? name : QString();
+    if (!connected) {
+        m_gamepadActive = false;
+    }
+    emit gamepadChanged();
+}
+
+void CarController::updateGamepadAxis(GamepadInput::Axis axis, const GamepadInput::AxisSettings &settings)
+{
+    m_gamepadAxes[axis] = settings;
+    QMetaObject::invokeMethod(m_gamepad, [gamepad = m_gamepad, axis, settings]() {
+        gamepad->setAxisSettings(axis, settings);
+    }, Qt::QueuedConnection);
+    emit gamepadSettingsChanged();
+}
+
+void CarController::setGamepadSpeedDeadZone(double deadZone)
+{
+    GamepadInput::AxisSettings settings = m_gamepadAxes[GamepadInput::SpeedAxis];
+    if (settings.deadZone != deadZone) {
+        settings.deadZone = deadZone;
+        updateGamepadAxis(GamepadInput::SpeedAxis, settings);
+    }
+}
+
+void CarController::setGamepadTurnDeadZone(double deadZone)
+{
+    GamepadInput::AxisSettings settings = m_gamepadAxes[GamepadInput::TurnAxis];
+    if (settings.deadZone != deadZone) {
+        settings.deadZone = deadZone;
+        updateGamepadAxis(GamepadInput::TurnAxis, settings);
+    }
+}
+
+void CarController::setGamepadSpeedExpo(double expo)
+{
+    GamepadInput::AxisSettings settings = m_gamepadAxes[GamepadInput::SpeedAxis];
+    if (settings.expo != expo) {
+        settings.expo = expo;
+        updateGamepadAxis(GamepadInput::SpeedAxis, settings);
+    }
+}
+
+void CarController::setGamepadTurnExpo(double expo)
+{
+    GamepadInput::AxisSettings settings = m_gamepadAxes[GamepadInput::TurnAxis];
+    if (settings.expo != expo) {
+        settings.expo = expo;
+        updateGamepadAxis(GamepadInput::TurnAxis, settings);
+    }
+}
+
+void CarController::onLinkQualityChanged()
+{
+    // Send faster on a good link and back off on a degraded one
+    updateSendSpacing();
+}
+
 void CarController::initSerialPort()
 {
-    // Find the correct serial port for the Arduino
-    const auto ports = QSerialPortInfo::availablePorts();
-    QString arduinoPortName;
+    QMetaObject::invokeMethod(m_serialWorker, &SerialInputWorker::open, Qt::QueuedConnection);
+}
 
-    for (const QSerialPortInfo &port : ports) {
-        qDebug() << "Checking port:" << port.portName()
-        << "Manufacturer:" << port.manufacturer()
-        << "VID:" << QString::number(port.vendorIdentifier(), 16)
-        << "PID:" << QString::number(port.productIdentifier(), 16);
+void CarController::drainInputs()
+{
+    // Only the newest sample of each device matters to this tick
+    InputSample sample;
+    InputSample serial;
+    InputSample gamepad;
+    bool haveSerial = false;
+    bool haveGamepad = false;
+    while (m_serialQueue.pop(sample)) {
+        serial = sample;
+        haveSerial = true;
+    }
+    while (m_gamepadQueue.pop(sample)) {
+        gamepad = sample;
+        haveGamepad = true;
+    }
 
-        // Genuine Arduino Uno (ATmega16U2 USB chip)
-        bool isGenuineArduino = (port.vendorIdentifier() == 0x2341 && port.productIdentifier() == 0x0043);
+    // A lost gamepad releases the sticks, unless it has been replugged and
+    // sent something newer since
+    const quint64 releasedUs = m_gamepadReleasedUs.exchange(0, std::memory_order_acquire);
+    if (releasedUs != 0 && (!haveGamepad || gamepad.receivedUs < releasedUs)) {
+        gamepad = InputSample();
+        gamepad.receivedUs = releasedUs;
+        haveGamepad = true;
+    }
 
-        // CH340/CH341 clone (wch.cn)
-        bool isCH340Clone = (port.vendorIdentifier() == 0x1A86 && port.productIdentifier() == 0x7523);
+    // The serial controller streams even when idle, so a deflected gamepad
+    // takes precedence over it
+    if (haveGamepad) {
+        m_gamepadActive = gamepad.speed != 0 || gamepad.turn != 0;
+    }
+    const InputSample *input = haveGamepad ? &gamepad
+                               : (haveSerial && !m_gamepadActive ? &serial : nullptr);
 
-        if (isGenuineArduino || isCH340Clone) {
-            arduinoPortName = port.portName();
-            break;
+    if (input && applyHardwareInput(input->speed, input->turn) && m_pendingInputUs == 0) {
+        m_pendingInputUs = input->receivedUs;
+    }
+}
+
+bool CarController::applyHardwareInput(int speed, int turn)
+{
+    bool changed = false;
+
+    // Check if we should ignore hardware input
+    if (m_ignoreHardwareInput) {
+        // Check if both controls have returned to dead zone
+        bool speedInDeadZone = qAbs(speed) <= m_speedDeadZone;
+        bool turnInDeadZone = qAbs(turn) <= m_turnDeadZone;
+
+        if (speedInDeadZone && turnInDeadZone) {
+            qDebug() << "CarController: Both controls returned to dead zone, re-enabling hardware input";
+            m_ignoreHardwareInput = false;
+            m_emergencyStopActive = false;
+
+            // Process these values since they're in the dead zone
+            if (m_speedValue != speed) {
+                setSpeedValue(speed);
+                changed = true;
+            }
+            if (m_turnValue != turn) {
+                setTurnValue(turn);
+                changed = true;
+            }
         }
+        return changed;
     }
 
-    if (arduinoPortName.isEmpty()) {
-        qDebug() << "CarController: Could not find Arduino port. Hardware controls will not work.";
-        return;
+    // Normal operation - process hardware input
+    // Only update if the user is not currently interacting with the UI controls
+    if (!m_speedPressed && m_speedValue != speed) {
+        setSpeedValue(speed);
+        changed = true;
+    }
+    if (!m_steeringPressed && m_turnValue != turn) {
+        setTurnValue(turn);
+        changed = true;
     }
 
-    m_serialPort->setPortName(arduinoPortName);
-    m_serialPort->setBaudRate(QSerialPort::Baud115200); // Must match the Arduino's baud rate!
-    m_serialPort->setDataBits(QSerialPort::Data8);
-    m_serialPort->setParity(QSerialPort::NoParity);
-    m_serialPort->setStopBits(QSerialPort::OneStop);
-    m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
+    // Update hardware control status - active if any non-zero values from hardware
+    bool newHardwareControlActive = (qAbs(speed) > m_speedDeadZone || qAbs(turn) > m_turnDeadZone);
+    if (m_hardwareControlActive != newHardwareControlActive) {
+        m_hardwareControlActive = newHardwareControlActive;
+        qDebug() << "CarController: Hardware control active:" << m_hardwareControlActive;
 
-    if (m_serialPort->open(QIODevice::ReadOnly)) {
-        qDebug() << "CarController: Successfully connected to Arduino on port" << arduinoPortName;
-        // Connect the 'readyRead' signal to our handler slot
-        connect(m_serialPort, &QSerialPort::readyRead, this, &CarController::readSerialData);
-    } else {
-        qDebug() << "CarController: Failed to open serial port" << arduinoPortName
-                 << "Error:" << m_serialPort->errorString();
-    }
-}
-
-void CarController::readSerialData()
-{
-    // Check if there is data to be read
-    while (m_serialPort->canReadLine()) {
-        QByteArray data = m_serialPort->readLine();
-        QString dataString = QString::fromUtf8(data).trimmed();
-
-        qDebug() << "CarController: Received raw data:" << dataString;
-
-        // Parse the comma-separated values: "speed,turn"
-        QStringList values = dataString.split(',');
-
-        if (values.size() == 2) {
-            bool speedOk, turnOk;
-            int speed = values[0].toInt(&speedOk);
-            int turn = values[1].toInt(&turnOk);
-
-            if (speedOk && turnOk &&
-                speed >= -255 && speed <= 255 &&
-                turn >= -50 && turn <= 50) {
-
-                qDebug() << "CarController: Received valid values - Speed:" << speed << "Turn:" << turn;
-
-                // Check if we should ignore hardware input
-                if (m_ignoreHardwareInput) {
-                    // Check if both controls have returned to dead zone
-                    bool speedInDeadZone = qAbs(speed) <= m_speedDeadZone;
-                    bool turnInDeadZone = qAbs(turn) <= m_turnDeadZone;
-
-                    if (speedInDeadZone && turnInDeadZone) {
-                        qDebug() << "CarController: Both controls returned to dead zone, re-enabling hardware input";
-                        m_ignoreHardwareInput = false;
-                        m_emergencyStopActive = false;
-
-                        // Process these values since they're in the dead zone
-                        if (m_speedValue != speed) {
-                            setSpeedValue(speed);
-                        }
-                        if (m_turnValue != turn) {
-                            setTurnValue(turn);
-                        }
-                    } else {
-                        qDebug() << "CarController: Ignoring hardware input - waiting for both controls to return to dead zone"
-                                 << "Speed in dead zone:" << speedInDeadZone
-                                 << "Turn in dead zone:" << turnInDeadZone;
-                    }
-                } else {
-                    // Normal operation - process hardware input
-                    // Only update if the user is not currently interacting with the UI controls
-                    bool hardwareInputReceived = false;
-
-                    if (!m_speedPressed && m_speedValue != speed) {
-                        setSpeedValue(speed);
-                        hardwareInputReceived = true;
-                    }
-                    if (!m_steeringPressed && m_turnValue != turn) {
-                        setTurnValue(turn);
-                        hardwareInputReceived = true;
-                    }
-
-                    // Update hardware control status - active if any non-zero values from hardware
-                    bool newHardwareControlActive = (qAbs(speed) > m_speedDeadZone || qAbs(turn) > m_turnDeadZone);
-                    if (m_hardwareControlActive != newHardwareControlActive) {
-                        m_hardwareControlActive = newHardwareControlActive;
-                        qDebug() << "CarController: Hardware control active:" << m_hardwareControlActive;
-
-                        // If hardware control becomes inactive, restart auto-center timer if needed
-                        if (!m_hardwareControlActive && !m_steeringPressed && m_turnValue != 0) {
-                            m_steeringCenterTimer->start();
-                        }
-                    }
-                }
-            } else {
-                qDebug() << "CarController: Invalid range - Speed:" << speed << "(valid: -255 to 255)"
-                         << "Turn:" << turn << "(valid: -50 to 50)";
-            }
-        } else {
-            qDebug() << "CarController: Invalid data format. Expected 'speed,turn', got:" << dataString;
+        // If hardware control becomes inactive, restart auto-center timer if needed
+        if (!m_hardwareControlActive && !m_steeringPressed && m_turnValue != 0) {
+            m_steeringCenterTimer->start();
         }
     }
+    return changed;
 }
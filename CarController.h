@@ -3,9 +3,19 @@
 
 #include <QObject>
 #include <QTimer>
-#include <QtSerialPort/QSerialPort>
-#include <QtSerialPort/QSerialPortInfo>
+#include <QElapsedTimer>
+#include <QThread>
+#include <atomic>
 #include "NetworkManager.h"
+#include "RobotProtocol.h"
+#include "RollingStats.h"
+#include "MotorOutputStage.h"
+#include "SerialInputWorker.h"
+#include "GamepadInput.h"
+#include "PathFollower.h"
+#include "RobotPose.h"
+
+class PoseEstimator;
 
 class CarController : public QObject
 {
@@ -19,8 +29,44 @@ class CarController : public QObject
     Q_PROPERTY(int leftMotorSpeed READ leftMotorSpeed NOTIFY motorSpeedsChanged)
     Q_PROPERTY(int rightMotorSpeed READ rightMotorSpeed NOTIFY motorSpeedsChanged)
 
+    // Commands go out from a fixed-rate control tick that samples the inputs
+    Q_PROPERTY(int controlRate READ controlRate WRITE setControlRate NOTIFY controlRateChanged) // Hz
+    // The tick period is whole milliseconds, so e.g. 60 Hz actually ticks at 58.8 Hz
+    Q_PROPERTY(double effectiveControlRate READ effectiveControlRate NOTIFY controlRateChanged) // Hz
+    Q_PROPERTY(double tickJitter READ tickJitter NOTIFY controlStatsChanged)       // ms, std dev of the tick period
+    Q_PROPERTY(double maxTickJitter READ maxTickJitter NOTIFY controlStatsChanged) // ms
+    Q_PROPERTY(int tickOverruns READ tickOverruns NOTIFY controlStatsChanged)
+
+    // Hardware controller on the serial port; it may come and go at any time
+    Q_PROPERTY(bool hardwareConnected READ hardwareConnected NOTIFY hardwareConnectionChanged)
+    Q_PROPERTY(QString hardwarePort READ hardwarePort NOTIFY hardwareConnectionChanged)
+
+    // evdev gamepad; dead zones are fractions of the stick's half range,
+    // expo blends from linear (0) to cubic (1)
+    Q_PROPERTY(bool gamepadConnected READ gamepadConnected NOTIFY gamepadChanged)
+    Q_PROPERTY(QString gamepadName READ gamepadName NOTIFY gamepadChanged)
+    Q_PROPERTY(double gamepadSpeedDeadZone READ gamepadSpeedDeadZone WRITE setGamepadSpeedDeadZone NOTIFY gamepadSettingsChanged)
+    Q_PROPERTY(double gamepadTurnDeadZone READ gamepadTurnDeadZone WRITE setGamepadTurnDeadZone NOTIFY gamepadSettingsChanged)
+    Q_PROPERTY(double gamepadSpeedExpo READ gamepadSpeedExpo WRITE setGamepadSpeedExpo NOTIFY gamepadSettingsChanged)
+    Q_PROPERTY(double gamepadTurnExpo READ gamepadTurnExpo WRITE setGamepadTurnExpo NOTIFY gamepadSettingsChanged)
+
+    // Output shaping between the motor mixing and the network
+    Q_PROPERTY(int outputThreshold READ outputThreshold WRITE setOutputThreshold NOTIFY outputShapingChanged)
+    Q_PROPERTY(int maxSlewPerTick READ maxSlewPerTick WRITE setMaxSlewPerTick NOTIFY outputShapingChanged)
+    Q_PROPERTY(int keepaliveInterval READ keepaliveInterval WRITE setKeepaliveInterval NOTIFY outputShapingChanged) // ms
+    Q_PROPERTY(int suppressedCommands READ suppressedCommands NOTIFY controlStatsChanged)
+
+    // Autonomous route following; manual input outside the dead zones takes over again
+    Q_PROPERTY(bool followingPath READ followingPath NOTIFY followingPathChanged)
+    Q_PROPERTY(double pathCrossTrackError READ pathCrossTrackError NOTIFY pathProgressChanged) // map units
+    Q_PROPERTY(double pathRemaining READ pathRemaining NOTIFY pathProgressChanged)             // map units
+    Q_PROPERTY(int followerMode READ followerMode WRITE setFollowerMode NOTIFY followerSettingsChanged) // 0 = pure pursuit, 1 = Stanley
+    Q_PROPERTY(double followerLookahead READ followerLookahead WRITE setFollowerLookahead NOTIFY followerSettingsChanged) // map units
+    Q_PROPERTY(int followerSpeed READ followerSpeed WRITE setFollowerSpeed NOTIFY followerSettingsChanged)
+
 public:
     explicit CarController(QObject *parent = nullptr);
+    ~CarController();
 
     // Property getters
     int speedValue() const { return m_speedValue; }
@@ -31,6 +77,29 @@ public:
     // bool isConnected() const;
     int leftMotorSpeed() const { return m_leftMotorSpeed; }
     int rightMotorSpeed() const { return m_rightMotorSpeed; }
+    int controlRate() const { return m_controlRate; }
+    double effectiveControlRate() const { return 1000.0 / m_controlTimer->interval(); }
+    double tickJitter() const { return m_tickPeriods.stddev(); }
+    double maxTickJitter() const { return m_maxTickJitter; }
+    int tickOverruns() const { return m_tickOverruns; }
+    bool hardwareConnected() const { return !m_hardwarePort.isEmpty(); }
+    QString hardwarePort() const { return m_hardwarePort; }
+    bool gamepadConnected() const { return !m_gamepadName.isEmpty(); }
+    QString gamepadName() const { return m_gamepadName; }
+    double gamepadSpeedDeadZone() const { return m_gamepadAxes[GamepadInput::SpeedAxis].deadZone; }
+    double gamepadTurnDeadZone() const { return m_gamepadAxes[GamepadInput::TurnAxis].deadZone; }
+    double gamepadSpeedExpo() const { return m_gamepadAxes[GamepadInput::SpeedAxis].expo; }
+    double gamepadTurnExpo() const { return m_gamepadAxes[GamepadInput::TurnAxis].expo; }
+    int outputThreshold() const { return m_outputStage.threshold(); }
+    int maxSlewPerTick() const { return m_outputStage.maxSlewPerTick(); }
+    int keepaliveInterval() const { return m_outputStage.keepaliveInterval(); }
+    int suppressedCommands() const { return static_cast<int>(m_outputStage.suppressedCommands()); }
+    bool followingPath() const { return m_pathFollower.isActive(); }
+    double pathCrossTrackError() const { return m_pathFollower.crossTrackError(); }
+    double pathRemaining() const { return m_pathFollower.remainingDistance(); }
+    int followerMode() const { return m_pathFollower.mode(); }
+    double followerLookahead() const { return m_pathFollower.lookahead(); }
+    int followerSpeed() const { return m_pathFollower.cruiseSpeed(); }
 
     // Property setters
     void setSpeedValue(int speed);
@@ -38,13 +107,45 @@ public:
     void setServerUrl(const QString &url);
     void setSpeedDeadZone(int deadZone);
     void setTurnDeadZone(int deadZone);
+    void setControlRate(int hz);
+    void setGamepadSpeedDeadZone(double deadZone);
+    void setGamepadTurnDeadZone(double deadZone);
+    void setGamepadSpeedExpo(double expo);
+    void setGamepadTurnExpo(double expo);
+    void setOutputThreshold(int threshold);
+    void setMaxSlewPerTick(int step);
+    void setKeepaliveInterval(int ms);
+    void setFollowerMode(int mode);
+    void setFollowerLookahead(double distance);
+    void setFollowerSpeed(int speed);
+
+    // Drives a route from PathfindingEngine from the control tick. Needs a
+    // pose estimate: from the attached PoseEstimator once the robot has
+    // been placed, or kept up to date with setPose(). Refused during an
+    // emergency stop.
+    Q_INVOKABLE bool followPath(const QVariantList &route);
+    Q_INVOKABLE void cancelPath();
+    // Map units and radians, see RobotPose. Resets the attached
+    // PoseEstimator, if any.
+    Q_INVOKABLE void setPose(double x, double y, double heading);
+    // Read on every control tick while following a route
+    void setPoseEstimator(PoseEstimator *estimator) { m_poseEstimator = estimator; }
+
+    // Runs the current input through one control step now, as if a full
+    // send spacing had passed since the last one: route following, then
+    // the output stage. For session replay as fast as possible, where the
+    // timer would otherwise see only every few inputs.
+    void stepControl();
 
 public slots:
-    void sendControlCommand();
+    // Runs the current input through the output stage and sends what it
+    // passes on; returns whether a command went out
+    bool sendControlCommand();
     void stopCar();
     void centerSteering();
     void setSteeringPressed(bool pressed);
     void setSpeedPressed(bool pressed);
+    // Discovery runs in the background; this only skips any pending backoff
     void initSerialPort();
 
 signals:
@@ -55,23 +156,46 @@ signals:
     void turnDeadZoneChanged();
     void connectionStatusChanged();
     void motorSpeedsChanged();
+    void controlRateChanged();
+    void controlStatsChanged();
+    void outputShapingChanged();
+    void hardwareConnectionChanged();
+    void gamepadChanged();
+    void gamepadSettingsChanged();
+    void followingPathChanged();
+    void pathProgressChanged();
+    void followerSettingsChanged();
+    void pathFinished();
     void commandSent(const QString &command);
+    void commandIssued(const RobotProtocol::Command &command);
     void networkError(const QString &error);
 
 private slots:
+    void onControlTick();
     void onSteeringCenterTimer();
     void onNetworkRequestFinished(QObject *requester, bool success, const QString &errorString);
     void onNetworkConnectionChanged();
-    void readSerialData();
+    void onLinkQualityChanged();
+    void onSerialPortStatus(bool open, const QString &portName);
+    void onGamepadChanged(bool connected, const QString &name);
 
 private:
     void calculateMotorSpeeds(int &leftSpeed, int &rightSpeed);
+    void applyManualInput();
     void applyDeadZones();
     void updateMotorSpeeds();
+    static int quantizeSpeed(int speed, int step);
+    void updateSendSpacing();
+    void drainInputs();
+    void runControlStep();
+    void updateGamepadAxis(GamepadInput::Axis axis, const GamepadInput::AxisSettings &settings);
+    bool applyHardwareInput(int speed, int turn);
+    void updatePathFollowing();
+    bool refreshPose();
 
     NetworkManager *m_networkManager;
     QTimer *m_steeringCenterTimer;
-    QTimer *m_sendDebounceTimer;
+    QTimer *m_controlTimer;
 
     int m_speedValue;
     int m_turnValue;
@@ -85,15 +209,58 @@ private:
     bool m_speedPressed;
     int m_leftMotorSpeed;
     int m_rightMotorSpeed;
-    QString m_lastCommand;
+    RobotProtocol::Command m_lastCommand;
+    MotorOutputStage m_outputStage;
+
+    // Control tick
+    int m_controlRate;
+    int m_minTicksBetweenSends; // 1, or from the recommended send interval on a degraded link
+    int m_ticksSinceSend;
+    QElapsedTimer m_tickClock;
+    qint64 m_lastTickNs;
+    RollingStats m_tickPeriods;
+    double m_maxTickJitter;
+    int m_tickOverruns;
+    int m_ticksSinceStats;
+
+    // Hardware controller input, read on its own thread
+    QThread *m_serialThread;
+    SerialInputWorker *m_serialWorker;
+    InputSampleQueue m_serialQueue;
+    quint64 m_pendingInputUs; // Read time of the oldest input not yet sent
+    QString m_hardwarePort;   // Empty while no controller is connected
+
+    // Gamepad input, read on its own thread
+    QThread *m_gamepadThread;
+    GamepadInput *m_gamepad;
+    InputSampleQueue m_gamepadQueue;
+    std::atomic<quint64> m_gamepadReleasedUs; // When the gamepad was lost; 0 once handled
+    GamepadInput::AxisSettings m_gamepadAxes[GamepadInput::AxisCount];
+    QString m_gamepadName;    // Empty while no gamepad is connected
+    bool m_gamepadActive;     // Stick deflected; overrides the serial controller
 
-    QSerialPort *m_serialPort;
+    // Route following
+    PathFollower m_pathFollower;
+    PoseEstimator *m_poseEstimator;
+    RobotPose m_pose;
+    qint64 m_poseUpdatedMs; // On m_tickClock, from setPose() without an estimator; -1 until then
+    int m_ticksSinceProgress;
 
     bool m_ignoreHardwareInput;
     bool m_emergencyStopActive;
+    bool m_inputSinceStop; // Drive commands may cancel the last stop's retries
     bool m_hardwareControlActive;
 
     static const int STEERING_CENTER_TIMEOUT = 100; // ms
+    static const int DEFAULT_CONTROL_RATE = 50; // Hz
+    static const int MIN_CONTROL_RATE = 10;     // Hz
+    static const int MAX_CONTROL_RATE = 200;    // Hz
+    static const int DEGRADED_LINK_SCORE = 70;  // Below this, sends back off from one per tick
+    static const int DEFAULT_OUTPUT_THRESHOLD = 4;     // speed units
+    static const int DEFAULT_MAX_SLEW_PER_TICK = 30;   // speed units, ~170 ms to full speed at 50 Hz
+    static const int DEFAULT_KEEPALIVE_INTERVAL = 1000; // ms
+    static const int POSE_TIMEOUT = 500;        // ms - route following stops on an older pose
+    static const int PROGRESS_UPDATE_TICKS = 5; // control ticks between path progress updates
 };
 
 #endif // CARCONTROLLER_H
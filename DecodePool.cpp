@@ -0,0 +1,81 @@
+#include "DecodePool.h"
+#include <QDebug>
+#include <algorithm>
+#include "FrameDecoder.h"
+
+DecodePool *DecodePool::instance()
+{
+    static DecodePool pool;
+    return &pool;
+}
+
+DecodePool::DecodePool()
+    : m_stopping(false)
+{
+    // Leave a core for the GUI and render threads
+    const int count = qBound(1, QThread::idealThreadCount() - 1, MAX_THREADS);
+    for (int i = 0; i < count; ++i) {
+        QThread *thread = QThread::create([this]() { run(); });
+        thread->setObjectName(QString("DecodePool %1").arg(i));
+        thread->start();
+        m_threads.push_back(thread);
+    }
+    qDebug() << "DecodePool: Started" << count << "decode threads";
+}
+
+DecodePool::~DecodePool()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_workAvailable.wakeAll();
+    }
+    for (QThread *thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+void DecodePool::schedule(FrameDecoder *decoder)
+{
+    QMutexLocker locker(&m_mutex);
+    m_ready.push_back(decoder);
+    m_workAvailable.wakeOne();
+}
+
+void DecodePool::detach(FrameDecoder *decoder)
+{
+    QMutexLocker locker(&m_mutex);
+    m_ready.erase(std::remove(m_ready.begin(), m_ready.end(), decoder), m_ready.end());
+    while (std::find(m_active.begin(), m_active.end(), decoder) != m_active.end()) {
+        m_decoderIdle.wait(&m_mutex);
+    }
+}
+
+void DecodePool::run()
+{
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        while (m_ready.empty() && !m_stopping) {
+            m_workAvailable.wait(&m_mutex);
+        }
+        if (m_stopping) {
+            return;
+        }
+
+        FrameDecoder *decoder = m_ready.front();
+        m_ready.pop_front();
+        m_active.push_back(decoder);
+
+        locker.unlock();
+        const bool morePending = decoder->decodeNext();
+        locker.relock();
+
+        m_active.erase(std::find(m_active.begin(), m_active.end(), decoder));
+        if (morePending) {
+            // Back of the line, behind the other streams
+            m_ready.push_back(decoder);
+        }
+        m_decoderIdle.wakeAll();
+    }
+}
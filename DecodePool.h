@@ -0,0 +1,50 @@
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <deque>
+#include <vector>
+
+class FrameDecoder;
+
+// Decode threads shared by all camera streams. Each stream owns a
+// FrameDecoder with a single latest-frame slot; a decoder with a frame
+// waiting is queued here, and workers take decoders in turn from the front
+// and put them back at the end if another frame arrived meanwhile, so
+// streams are served round-robin and one fast camera cannot starve another.
+// A decoder is only ever worked on by one thread at a time, which keeps each
+// stream's frames in order.
+//
+// The pool is sized to the machine, not to the number of cameras; when it
+// falls behind, every stream drops its stale frames instead of queueing.
+class DecodePool
+{
+public:
+    static DecodePool *instance();
+
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+
+    // Called by FrameDecoder
+    void schedule(FrameDecoder *decoder);
+    void detach(FrameDecoder *decoder); // Waits for a decode in progress
+
+private:
+    DecodePool();
+    ~DecodePool();
+
+    void run();
+
+    QMutex m_mutex;
+    QWaitCondition m_workAvailable;
+    QWaitCondition m_decoderIdle;
+    std::deque<FrameDecoder *> m_ready;
+    std::vector<FrameDecoder *> m_active;
+    std::vector<QThread *> m_threads;
+    bool m_stopping;
+
+    static const int MAX_THREADS = 4;
+};
+
+#endif // DECODEPOOL_H
@@ -0,0 +1,88 @@
+#include "DeviceWatcher.h"
+#include <QFile>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+DeviceWatcher::DeviceWatcher(QObject *parent)
+    : QObject(parent)
+    , m_fd(-1)
+    , m_notifier(nullptr)
+    , m_settleTimer(new QTimer(this))
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(HOTPLUG_SETTLE);
+    connect(m_settleTimer, &QTimer::timeout, this, &DeviceWatcher::devicesChanged);
+}
+
+DeviceWatcher::~DeviceWatcher()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        // The notifier must not outlive the descriptor it watches
+        delete m_notifier;
+        m_notifier = nullptr;
+        ::close(m_fd);
+    }
+#endif
+}
+
+bool DeviceWatcher::start(const QString &directory, const QList<QByteArray> &prefixes)
+{
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        return true;
+    }
+    m_prefixes = prefixes;
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        return false;
+    }
+    // IN_ATTRIB catches udev fixing up permissions after the node appears
+    if (inotify_add_watch(m_fd, QFile::encodeName(directory).constData(),
+                          IN_CREATE | IN_DELETE | IN_ATTRIB) < 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &DeviceWatcher::onNotify);
+    return true;
+#else
+    Q_UNUSED(directory)
+    Q_UNUSED(prefixes)
+    return false;
+#endif
+}
+
+void DeviceWatcher::onNotify()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[4096];
+    bool matched = false;
+    ssize_t length;
+
+    while ((length = ::read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length; ) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+            if (event->len > 0) {
+                for (const QByteArray &prefix : std::as_const(m_prefixes)) {
+                    if (std::strncmp(event->name, prefix.constData(), prefix.size()) == 0) {
+                        matched = true;
+                    }
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (matched) {
+        m_settleTimer->start();
+    }
+#endif
+}
@@ -0,0 +1,45 @@
+#ifndef DEVICEWATCHER_H
+#define DEVICEWATCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// Hot-plug notifications for the input backends. Watches a device
+// directory through inotify and reports nodes whose names start with one
+// of the given prefixes appearing, disappearing or changing permissions.
+// Only available on Linux; where it isn't, start() returns false and the
+// caller has to poll.
+class DeviceWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeviceWatcher(QObject *parent = nullptr);
+    ~DeviceWatcher();
+
+    // Call on the thread the watcher lives on
+    bool start(const QString &directory, const QList<QByteArray> &prefixes);
+    bool isWatching() const { return m_notifier != nullptr; }
+
+    static const int HOTPLUG_SETTLE = 200; // ms - let udev set permissions
+
+signals:
+    // Emitted HOTPLUG_SETTLE ms after the last matching event, so a new
+    // node can usually be opened by the time this arrives
+    void devicesChanged();
+
+private slots:
+    void onNotify();
+
+private:
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QTimer *m_settleTimer;
+    QList<QByteArray> m_prefixes;
+};
+
+#endif // DEVICEWATCHER_H
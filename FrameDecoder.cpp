@@ -0,0 +1,104 @@
+#include "FrameDecoder.h"
+#include <QDebug>
+#include "DecodePool.h"
+#include "JpegDecoder.h"
+#include "RobotProtocol.h"
+
+FrameDecoder::FrameDecoder(QObject *parent)
+    : QObject(parent)
+    , m_scheduled(false)
+    , m_decoding(false)
+    , m_decodedFrames(0)
+    , m_droppedFrames(0)
+    , m_decodeScale(1)
+    , m_decodeTimeUs(0)
+{
+}
+
+FrameDecoder::~FrameDecoder()
+{
+    clear();
+    DecodePool::instance()->detach(this);
+}
+
+void FrameDecoder::submit(const JpegFrame &frame, const FrameTiming &timing)
+{
+    bool wake = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_pending.isNull()) {
+            // Latest frame wins; the waiting one is already stale
+            m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_pending = frame;
+        m_pendingTiming = timing;
+        wake = !m_scheduled;
+        m_scheduled = true;
+    }
+
+    if (wake) {
+        DecodePool::instance()->schedule(this);
+    }
+}
+
+void FrameDecoder::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending = JpegFrame();
+}
+
+void FrameDecoder::setTargetSize(const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_targetSize = size;
+}
+
+int FrameDecoder::queuedFrames() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (m_pending.isNull() ? 0 : 1) + (m_decoding ? 1 : 0);
+}
+
+bool FrameDecoder::decodeNext()
+{
+    JpegFrame frame;
+    FrameTiming timing;
+    QSize target;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.isNull()) {
+            m_scheduled = false;
+            return false;
+        }
+        frame = std::move(m_pending);
+        m_pending = JpegFrame();
+        timing = m_pendingTiming;
+        m_decoding = true;
+        target = m_targetSize;
+    }
+
+    timing.decodeStartUs = RobotProtocol::timestampUs();
+    int scale = 1;
+    QImage image = JpegDecoder::decode(frame.bytes(), frame.size, target, &scale);
+    timing.decodedUs = RobotProtocol::timestampUs();
+    m_decodeScale.store(scale, std::memory_order_relaxed);
+    m_decodeTimeUs.fetch_add(timing.decodedUs - timing.decodeStartUs, std::memory_order_relaxed);
+
+    // Release the stream chunk as soon as possible
+    frame = JpegFrame();
+
+    if (image.isNull()) {
+        qDebug() << "FrameDecoder: Failed to decode frame";
+    } else {
+        m_decodedFrames.fetch_add(1, std::memory_order_relaxed);
+        emit frameDecoded(image, timing);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_decoding = false;
+    if (m_pending.isNull()) {
+        m_scheduled = false;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QObject>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <atomic>
+#include "StreamBuffer.h"
+#include "FrameTiming.h"
+
+// Decodes one camera stream's frames into QImage on the shared DecodePool.
+// There is a single pending slot: a frame submitted while another is still
+// waiting replaces it, so when decoding falls behind only the newest frame
+// is decoded and the stale ones are counted as dropped. Frames are decoded
+// no larger than the target size needs, using DCT-domain scaling.
+class FrameDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameDecoder(QObject *parent = nullptr);
+    ~FrameDecoder();
+
+    // Safe to call from any thread; never blocks on decoding
+    void submit(const JpegFrame &frame, const FrameTiming &timing = FrameTiming());
+    void clear();
+
+    // Largest size any consumer displays; empty decodes at full resolution
+    void setTargetSize(const QSize &size);
+
+    // Denominator used for the last decoded frame (1, 2, 4 or 8)
+    int decodeScale() const { return m_decodeScale.load(std::memory_order_relaxed); }
+
+    quint64 decodedFrames() const { return m_decodedFrames.load(std::memory_order_relaxed); }
+    quint64 droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+    int queuedFrames() const;
+
+    // Total time spent decoding this stream, for per-stream CPU load
+    quint64 decodeTimeUs() const { return m_decodeTimeUs.load(std::memory_order_relaxed); }
+
+signals:
+    // Emitted on a pool thread; connect with a queued connection
+    void frameDecoded(const QImage &image, const FrameTiming &timing);
+
+private:
+    friend class DecodePool;
+
+    // Decodes the pending frame, if any; returns whether another one
+    // arrived meanwhile. Called by one pool thread at a time.
+    bool decodeNext();
+
+    mutable QMutex m_mutex;
+    JpegFrame m_pending;
+    FrameTiming m_pendingTiming;
+    bool m_scheduled;
+    bool m_decoding;
+    QSize m_targetSize;
+
+    std::atomic<quint64> m_decodedFrames;
+    std::atomic<quint64> m_droppedFrames;
+    std::atomic<int> m_decodeScale;
+    std::atomic<quint64> m_decodeTimeUs;
+};
+
+#endif // FRAMEDECODER_H
@@ -0,0 +1,42 @@
+#include "FrameTiming.h"
+
+namespace {
+
+double elapsedMs(quint64 from, quint64 to)
+{
+    return to >= from ? (to - from) / 1000.0 : 0.0;
+}
+
+}
+
+void FrameTimingStats::addFrame(const FrameTiming &timing)
+{
+    m_parse.add(elapsedMs(timing.receivedUs, timing.parsedUs));
+    m_decodeQueue.add(elapsedMs(timing.parsedUs, timing.decodeStartUs));
+    m_decode.add(elapsedMs(timing.decodeStartUs, timing.decodedUs));
+    m_delivery.add(elapsedMs(timing.decodedUs, timing.deliveredUs));
+    m_present.add(elapsedMs(timing.deliveredUs, timing.presentedUs));
+    m_pipeline.add(elapsedMs(timing.receivedUs, timing.presentedUs));
+
+    if (timing.cameraUs != 0) {
+        m_endToEnd.add(elapsedMs(timing.cameraUs, timing.presentedUs));
+    }
+
+    if (m_lastPresentedUs != 0) {
+        m_frameInterval.add(elapsedMs(m_lastPresentedUs, timing.presentedUs));
+    }
+    m_lastPresentedUs = timing.presentedUs;
+}
+
+void FrameTimingStats::reset()
+{
+    m_parse.reset();
+    m_decodeQueue.reset();
+    m_decode.reset();
+    m_delivery.reset();
+    m_present.reset();
+    m_pipeline.reset();
+    m_endToEnd.reset();
+    m_frameInterval.reset();
+    m_lastPresentedUs = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAMETIMING_H
+#define FRAMETIMING_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include "RollingStats.h"
+
+// Timestamps a camera frame collects on its way through the pipeline, in
+// RobotProtocol::timestampUs() microseconds. Zero means the stage was not
+// reached (or, for cameraUs, that the frame carried no capture time).
+struct FrameTiming {
+    quint64 sequence = 0;
+    quint64 cameraUs = 0;       // Capture time embedded by the camera
+    quint64 receivedUs = 0;     // Last bytes of the frame read from the socket
+    quint64 parsedUs = 0;       // Frame boundaries found
+    quint64 decodeStartUs = 0;  // Picked up by the decoder thread
+    quint64 decodedUs = 0;
+    quint64 deliveredUs = 0;    // Handed to the views on the GUI thread
+    quint64 presentedUs = 0;    // Frame containing it swapped to the screen
+};
+
+Q_DECLARE_METATYPE(FrameTiming)
+
+// Per-stage latency statistics over recently presented frames. Each stage
+// is measured from the end of the previous one, so the stages add up to the
+// pipeline latency; jitter is the standard deviation.
+class FrameTimingStats
+{
+public:
+    void addFrame(const FrameTiming &timing);
+    void reset();
+
+    const RollingStats &parse() const { return m_parse; }
+    const RollingStats &decodeQueue() const { return m_decodeQueue; }
+    const RollingStats &decode() const { return m_decode; }
+    const RollingStats &delivery() const { return m_delivery; }
+    const RollingStats &present() const { return m_present; }
+    const RollingStats &pipeline() const { return m_pipeline; }   // Received to presented
+    const RollingStats &endToEnd() const { return m_endToEnd; }   // Captured to presented
+    const RollingStats &frameInterval() const { return m_frameInterval; }
+
+private:
+    RollingStats m_parse;
+    RollingStats m_decodeQueue;
+    RollingStats m_decode;
+    RollingStats m_delivery;
+    RollingStats m_present;
+    RollingStats m_pipeline;
+    RollingStats m_endToEnd;
+    RollingStats m_frameInterval;
+    quint64 m_lastPresentedUs = 0;
+};
+
+#endif // FRAMETIMING_H
@@ -0,0 +1,294 @@
+#include "GamepadInput.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QtMath>
+#include "DeviceWatcher.h"
+#include "RobotProtocol.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+const int BITS_PER_LONG = sizeof(unsigned long) * 8;
+
+bool testBit(const unsigned long *bits, int bit)
+{
+    return (bits[bit / BITS_PER_LONG] >> (bit % BITS_PER_LONG)) & 1UL;
+}
+#endif
+
+// CarController's input ranges
+const int SPEED_RANGE = 255;
+const int TURN_RANGE = 50;
+
+}
+
+GamepadInput::GamepadInput(InputSampleQueue *queue, std::atomic<quint64> *releasedUs, QObject *parent)
+    : QObject(parent)
+    , m_queue(queue)
+    , m_releasedUs(releasedUs)
+    , m_fd(-1)
+    , m_readNotifier(nullptr)
+    , m_dirty(false)
+    , m_lastSpeed(0)
+    , m_lastTurn(0)
+    , m_publishRetryTimer(nullptr)
+    , m_deviceWatcher(nullptr)
+    , m_scanTimer(nullptr)
+{
+    // Stick forward reports negative Y
+    m_axes[SpeedAxis].settings.invert = true;
+}
+
+GamepadInput::~GamepadInput()
+{
+    closeDevice();
+}
+
+void GamepadInput::start()
+{
+#ifdef Q_OS_LINUX
+    // Created here so they belong to the worker thread
+    m_scanTimer = new QTimer(this);
+    m_scanTimer->setSingleShot(true);
+    connect(m_scanTimer, &QTimer::timeout, this, &GamepadInput::scan);
+
+    m_publishRetryTimer = new QTimer(this);
+    m_publishRetryTimer->setSingleShot(true);
+    m_publishRetryTimer->setInterval(PUBLISH_RETRY_INTERVAL);
+    connect(m_publishRetryTimer, &QTimer::timeout, this, &GamepadInput::retryPublish);
+
+    m_deviceWatcher = new DeviceWatcher(this);
+    connect(m_deviceWatcher, &DeviceWatcher::devicesChanged, this, &GamepadInput::onDevicesChanged);
+    m_deviceWatcher->start(QStringLiteral("/dev/input"), {"event"});
+
+    scan();
+#endif
+}
+
+void GamepadInput::setAxisSettings(Axis axis, const AxisSettings &settings)
+{
+    m_axes[axis].settings = settings;
+    m_dirty = true;
+}
+
+void GamepadInput::scan()
+{
+    if (m_fd >= 0) {
+        return;
+    }
+
+    const QDir dir(QStringLiteral("/dev/input"));
+    const QStringList devices = dir.entryList({QStringLiteral("event*")}, QDir::System, QDir::Name);
+    for (const QString &device : devices) {
+        if (openDevice(dir.filePath(device))) {
+            return;
+        }
+    }
+
+    // Hot-plug events will trigger the next scan; poll only without them
+    if (!m_deviceWatcher->isWatching() && m_scanTimer) {
+        m_scanTimer->start(RESCAN_INTERVAL);
+    }
+}
+
+void GamepadInput::onDevicesChanged()
+{
+    if (m_fd < 0) {
+        scan();
+    }
+}
+
+bool GamepadInput::openDevice(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    unsigned long keyBits[KEY_MAX / BITS_PER_LONG + 1] = {};
+    unsigned long absBits[ABS_MAX / BITS_PER_LONG + 1] = {};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0
+        || ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Joysticks and gamepads; this skips touchpads and tablets, which also
+    // report absolute axes
+    const bool isGamepad = testBit(keyBits, BTN_GAMEPAD) || testBit(keyBits, BTN_JOYSTICK);
+    if (!isGamepad || !testBit(absBits, ABS_Y)) {
+        ::close(fd);
+        return false;
+    }
+
+    // Left stick drives; the right stick steers, or the left one on
+    // devices with a single stick
+    m_axes[SpeedAxis].code = ABS_Y;
+    m_axes[TurnAxis].code = testBit(absBits, ABS_RX) ? ABS_RX : (testBit(absBits, ABS_X) ? ABS_X : -1);
+
+    for (AxisState &axis : m_axes) {
+        struct input_absinfo info = {};
+        if (axis.code < 0 || ioctl(fd, EVIOCGABS(axis.code), &info) < 0 || info.maximum <= info.minimum) {
+            axis.code = -1;
+            continue;
+        }
+        axis.minimum = info.minimum;
+        axis.maximum = info.maximum;
+        axis.flat = info.flat;
+        axis.value = info.value;
+    }
+
+    // Kernel timestamps on the monotonic clock line up with timestampUs()
+    int clock = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock);
+
+    char name[128] = {};
+    ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+
+    m_fd = fd;
+    m_deviceName = QString::fromUtf8(name);
+    m_readNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_readNotifier, &QSocketNotifier::activated, this, &GamepadInput::readEvents);
+
+    qDebug() << "GamepadInput: Using" << m_deviceName << "on" << path;
+    emit deviceChanged(true, m_deviceName);
+
+    m_dirty = true;
+    publish(0);
+    return true;
+#else
+    Q_UNUSED(path)
+    return false;
+#endif
+}
+
+void GamepadInput::closeDevice()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd < 0) {
+        return;
+    }
+    delete m_readNotifier;
+    m_readNotifier = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+#endif
+}
+
+void GamepadInput::readEvents()
+{
+#ifdef Q_OS_LINUX
+    struct input_event events[64];
+    ssize_t length;
+
+    while ((length = ::read(m_fd, events, sizeof(events))) > 0) {
+        const int count = static_cast<int>(length / sizeof(struct input_event));
+        for (int i = 0; i < count; ++i) {
+            const struct input_event &event = events[i];
+            if (event.type == EV_ABS) {
+                for (AxisState &axis : m_axes) {
+                    if (axis.code == event.code) {
+                        axis.value = event.value;
+                        m_dirty = true;
+                    }
+                }
+            } else if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                publish(static_cast<quint64>(event.input_event_sec) * 1000000ULL + event.input_event_usec);
+            } else if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+                // The kernel buffer overflowed; the next report resyncs us
+                m_dirty = true;
+            }
+        }
+    }
+
+    if (length < 0 && errno == ENODEV) {
+        qDebug() << "GamepadInput: Lost" << m_deviceName;
+        closeDevice();
+        // Release the sticks so the car doesn't keep the last input; not
+        // queued, as a full queue would lose it
+        m_publishRetryTimer->stop();
+        m_dirty = false;
+        m_lastSpeed = m_lastTurn = 0;
+        m_releasedUs->store(RobotProtocol::timestampUs(), std::memory_order_release);
+        emit deviceChanged(false, QString());
+        m_scanTimer->start(m_deviceWatcher->isWatching() ? DeviceWatcher::HOTPLUG_SETTLE : RESCAN_INTERVAL);
+    }
+#endif
+}
+
+double GamepadInput::shape(const AxisState &axis) const
+{
+    if (axis.code < 0) {
+        return 0.0;
+    }
+
+    const double center = (axis.minimum + axis.maximum) / 2.0;
+    const double half = (axis.maximum - axis.minimum) / 2.0;
+    double x = qBound(-1.0, (axis.value - center) / half, 1.0);
+    if (axis.settings.invert) {
+        x = -x;
+    }
+
+    const double deadZone = qBound(0.0, qMax(axis.settings.deadZone, axis.flat / half), 0.95);
+    const double magnitude = qAbs(x);
+    if (magnitude <= deadZone) {
+        return 0.0;
+    }
+
+    // Rescale past the dead zone so output starts from zero, then blend in
+    // a cubic term for finer control near centre
+    const double rescaled = (magnitude - deadZone) / (1.0 - deadZone);
+    const double expo = qBound(0.0, axis.settings.expo, 1.0);
+    const double curved = (1.0 - expo) * rescaled + expo * rescaled * rescaled * rescaled;
+    return x < 0 ? -curved : curved;
+}
+
+void GamepadInput::publish(quint64 timestampUs)
+{
+    if (!m_dirty) {
+        return;
+    }
+    m_dirty = false;
+
+    const int speed = qRound(shape(m_axes[SpeedAxis]) * SPEED_RANGE);
+    const int turn = qRound(shape(m_axes[TurnAxis]) * TURN_RANGE);
+    if (speed == m_lastSpeed && turn == m_lastTurn) {
+        return;
+    }
+
+    InputSample sample;
+    sample.speed = speed;
+    sample.turn = turn;
+    sample.receivedUs = timestampUs != 0 ? timestampUs : RobotProtocol::timestampUs();
+    if (!m_queue->push(sample)) {
+        // A centred stick sends no further reports, so this sample may be
+        // the last one; try again once the control tick has drained
+        m_dirty = true;
+        if (!m_publishRetryTimer->isActive()) {
+            qDebug() << "GamepadInput: Sample queue full, retrying";
+            m_publishRetryTimer->start();
+        }
+        return;
+    }
+    m_lastSpeed = speed;
+    m_lastTurn = turn;
+}
+
+void GamepadInput::retryPublish()
+{
+    if (m_fd >= 0) {
+        publish(0);
+    }
+}
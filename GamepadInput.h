@@ -0,0 +1,99 @@
+#ifndef GAMEPADINPUT_H
+#define GAMEPADINPUT_H
+
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+#include "InputSample.h"
+
+class QSocketNotifier;
+class DeviceWatcher;
+
+// Linux evdev joystick/gamepad backend for CarController.
+//
+// Lives on its own thread and reads /dev/input/event* directly, so input
+// is taken at the device's native report rate with kernel timestamps on
+// the same monotonic clock as RobotProtocol::timestampUs(). Each complete
+// report (SYN_REPORT) that changes the output becomes one sample on the
+// queue. Axes are normalized from the device's own range, then a dead zone
+// (never smaller than the device's flat) and an expo curve are applied
+// before scaling to speed and turn. Devices are found at start and on
+// hot-plug through a DeviceWatcher on /dev/input; uinput virtual devices
+// work the same way (see tools/virtual_gamepad). Elsewhere this does
+// nothing.
+//
+// Losing the device must release the sticks even if the queue is full, so
+// it is signalled through releasedUs rather than as a sample: the time the
+// device was lost, which the consumer swaps back to 0 and applies as a
+// centred sample unless it has a newer one.
+class GamepadInput : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Axis {
+        SpeedAxis,
+        TurnAxis,
+        AxisCount
+    };
+
+    struct AxisSettings {
+        double deadZone = 0.08; // Fraction of the half range
+        double expo = 0.3;      // 0 linear, 1 cubic
+        bool invert = false;
+    };
+
+    GamepadInput(InputSampleQueue *queue, std::atomic<quint64> *releasedUs, QObject *parent = nullptr);
+    ~GamepadInput();
+
+    // Worker thread only; queue calls from other threads
+    void setAxisSettings(Axis axis, const AxisSettings &settings);
+
+public slots:
+    // Must run on the worker thread before anything else
+    void start();
+
+signals:
+    void deviceChanged(bool connected, const QString &name);
+
+private slots:
+    void readEvents();
+    void onDevicesChanged();
+    void scan();
+    void retryPublish();
+
+private:
+    struct AxisState {
+        int code = -1;  // ABS_* code, -1 if the device has no such axis
+        int minimum = 0;
+        int maximum = 0;
+        int flat = 0;
+        int value = 0;
+        AxisSettings settings;
+    };
+
+    bool openDevice(const QString &path);
+    void closeDevice();
+    double shape(const AxisState &axis) const;
+    void publish(quint64 timestampUs);
+
+    InputSampleQueue *m_queue;
+    std::atomic<quint64> *m_releasedUs;
+    int m_fd;
+    QSocketNotifier *m_readNotifier;
+    QString m_deviceName;
+    AxisState m_axes[AxisCount];
+    bool m_dirty;
+    int m_lastSpeed;  // Last sample that made it onto the queue
+    int m_lastTurn;
+    QTimer *m_publishRetryTimer;
+
+    // Hot-plug
+    DeviceWatcher *m_deviceWatcher;
+    QTimer *m_scanTimer;
+
+    static const int RESCAN_INTERVAL = 2000;       // ms - without hot-plug events
+    static const int PUBLISH_RETRY_INTERVAL = 10;  // ms - queue was full
+};
+
+#endif // GAMEPADINPUT_H
@@ -0,0 +1,18 @@
+#ifndef INPUTSAMPLE_H
+#define INPUTSAMPLE_H
+
+#include <QtGlobal>
+#include "SpscQueue.h"
+
+// One reading from a hardware input device, in CarController's units
+// (speed -255..255, turn -50..50), stamped when it was read
+struct InputSample {
+    int speed = 0;
+    int turn = 0;
+    quint64 receivedUs = 0; // RobotProtocol::timestampUs()
+};
+
+// Hands samples from an input thread to the control tick
+using InputSampleQueue = SpscQueue<InputSample, 256>;
+
+#endif // INPUTSAMPLE_H
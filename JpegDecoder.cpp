@@ -0,0 +1,154 @@
+#include "JpegDecoder.h"
+#include <QBuffer>
+#include <QImageReader>
+
+#ifdef HAVE_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace JpegDecoder {
+
+namespace {
+
+#ifdef HAVE_LIBJPEG
+
+struct ErrorManager {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+};
+
+void errorExit(j_common_ptr cinfo)
+{
+    std::longjmp(reinterpret_cast<ErrorManager *>(cinfo->err)->jump, 1);
+}
+
+void outputMessage(j_common_ptr)
+{
+    // Corrupt-data warnings are routine on a lossy radio link; stay quiet
+}
+
+// Kept free of C++ locals with destructors, since errors unwind through
+// longjmp. The image lives in the caller and is only reached via a pointer.
+bool decodeWithLibjpeg(const uchar *data, qsizetype size, const QSize &target,
+                       QImage *image, int *scaleDenom)
+{
+    jpeg_decompress_struct cinfo;
+    ErrorManager error;
+    cinfo.err = jpeg_std_error(&error.pub);
+    error.pub.error_exit = errorExit;
+    error.pub.output_message = outputMessage;
+
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+    jpeg_read_header(&cinfo, TRUE);
+
+    const int denom = chooseScale(QSize(static_cast<int>(cinfo.image_width),
+                                        static_cast<int>(cinfo.image_height)), target);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = static_cast<unsigned int>(denom);
+
+#ifdef JCS_EXTENSIONS
+    // Decode straight into QImage's native 32-bit layout
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    cinfo.out_color_space = JCS_EXT_BGRX;
+#else
+    cinfo.out_color_space = JCS_EXT_XRGB;
+#endif
+    const QImage::Format format = QImage::Format_RGB32;
+#else
+    cinfo.out_color_space = JCS_RGB;
+    const QImage::Format format = QImage::Format_RGB888;
+#endif
+
+    jpeg_start_decompress(&cinfo);
+
+    *image = QImage(static_cast<int>(cinfo.output_width), static_cast<int>(cinfo.output_height), format);
+    if (image->isNull()) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = image->scanLine(static_cast<int>(cinfo.output_scanline));
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    if (scaleDenom) {
+        *scaleDenom = denom;
+    }
+    return true;
+}
+
+#endif // HAVE_LIBJPEG
+
+QImage decodeWithQt(const uchar *data, qsizetype size, const QSize &target, int *scaleDenom)
+{
+    // Qt's JPEG plugin also scales in the DCT domain when given a scaled size
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, "JPEG");
+    const QSize imageSize = reader.size();
+    const int denom = chooseScale(imageSize, target);
+    if (denom > 1) {
+        reader.setScaledSize(QSize(imageSize.width() / denom, imageSize.height() / denom));
+    }
+
+    if (scaleDenom) {
+        *scaleDenom = denom;
+    }
+    return reader.read();
+}
+
+}
+
+int chooseScale(const QSize &imageSize, const QSize &target)
+{
+    if (!target.isValid() || target.isEmpty() || imageSize.isEmpty()) {
+        return 1;
+    }
+
+    // The area the image actually occupies in the target
+    const QSize fitted = imageSize.scaled(target, Qt::KeepAspectRatio);
+
+    for (int denom = 8; denom > 1; denom /= 2) {
+        if (imageSize.width() / denom >= fitted.width()
+            && imageSize.height() / denom >= fitted.height()) {
+            return denom;
+        }
+    }
+    return 1;
+}
+
+QImage decode(const uchar *data, qsizetype size, const QSize &target, int *scaleDenom)
+{
+#ifdef HAVE_LIBJPEG
+    QImage image;
+    if (decodeWithLibjpeg(data, size, target, &image, scaleDenom)) {
+        return image;
+    }
+#endif
+    return decodeWithQt(data, size, target, scaleDenom);
+}
+
+bool hasLibjpeg()
+{
+#ifdef HAVE_LIBJPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace JpegDecoder
@@ -0,0 +1,27 @@
+#ifndef JPEGDECODER_H
+#define JPEGDECODER_H
+
+#include <QImage>
+#include <QSize>
+
+// JPEG decoding with DCT-domain downscaling. libjpeg(-turbo) can decode at
+// 1/2, 1/4 or 1/8 of the coded size for a fraction of the cost of a full
+// decode, by skipping the high-frequency coefficients. The scale is picked
+// so the result still covers the target size when fitted with
+// Qt::KeepAspectRatio, so no consumer ever upscales.
+namespace JpegDecoder {
+
+// Largest denominator (1, 2, 4 or 8) that still covers target; an invalid
+// or empty target means full resolution
+int chooseScale(const QSize &imageSize, const QSize &target);
+
+// Decodes data, downscaled for target. Falls back to Qt's image reader
+// when built without libjpeg or for JPEGs libjpeg rejects.
+QImage decode(const uchar *data, qsizetype size, const QSize &target, int *scaleDenom = nullptr);
+
+// Whether decode() uses libjpeg directly
+bool hasLibjpeg();
+
+} // namespace JpegDecoder
+
+#endif // JPEGDECODER_H
@@ -0,0 +1,83 @@
+#include "LinkQualityEstimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Maps value linearly from [good, bad] to a penalty in [0, 1]
+double penalty(double value, double good, double bad)
+{
+    return std::clamp((value - good) / (bad - good), 0.0, 1.0);
+}
+
+}
+
+LinkQualityEstimator::LinkQualityEstimator()
+{
+    reset();
+}
+
+void LinkQualityEstimator::reset()
+{
+    m_smoothedRtt = 0.0;
+    m_jitter = 0.0;
+    m_lastRtt = 0.0;
+    m_lossRate = 0.0;
+    m_sampleCount = 0;
+}
+
+void LinkQualityEstimator::addRttSample(double rttMs)
+{
+    if (m_sampleCount == 0) {
+        m_smoothedRtt = rttMs;
+        m_jitter = 0.0;
+    } else {
+        m_smoothedRtt += RTT_GAIN * (rttMs - m_smoothedRtt);
+        m_jitter += JITTER_GAIN * (std::abs(rttMs - m_lastRtt) - m_jitter);
+    }
+
+    m_lastRtt = rttMs;
+    m_lossRate *= (1.0 - LOSS_GAIN);
+    m_sampleCount++;
+}
+
+void LinkQualityEstimator::addLoss()
+{
+    m_lossRate = m_lossRate * (1.0 - LOSS_GAIN) + LOSS_GAIN;
+    m_sampleCount++;
+}
+
+int LinkQualityEstimator::score() const
+{
+    if (m_sampleCount == 0) {
+        return 0;
+    }
+
+    double rttPenalty = penalty(m_smoothedRtt, GOOD_RTT_MS, BAD_RTT_MS);
+    double jitterPenalty = penalty(m_jitter, GOOD_JITTER_MS, BAD_JITTER_MS);
+    double lossPenalty = penalty(m_lossRate, 0.0, BAD_LOSS_RATE);
+
+    // Loss hurts a control link the most, then latency, then jitter
+    double quality = 1.0 - (0.45 * lossPenalty + 0.35 * rttPenalty + 0.20 * jitterPenalty);
+    return static_cast<int>(std::lround(std::clamp(quality, 0.0, 1.0) * 100.0));
+}
+
+int LinkQualityEstimator::recommendedSendInterval() const
+{
+    // Without any samples yet, behave like a mediocre link
+    double badness = m_sampleCount == 0 ? 0.5 : (100 - score()) / 100.0;
+    int interval = MIN_SEND_INTERVAL
+                   + static_cast<int>(badness * (MAX_SEND_INTERVAL - MIN_SEND_INTERVAL));
+
+    // Round to 10 ms so small score changes don't keep retiming the controllers
+    return (interval + 5) / 10 * 10;
+}
+
+int LinkQualityEstimator::recommendedSpeedStep() const
+{
+    int s = score();
+    if (m_sampleCount == 0 || s >= 70) {
+        return 1;
+    }
+    return 1 + (70 - s) * (MAX_SPEED_STEP - 1) / 70;
+}
@@ -0,0 +1,55 @@
+#ifndef LINKQUALITYESTIMATOR_H
+#define LINKQUALITYESTIMATOR_H
+
+// Combines round-trip time, jitter and loss from keep-alive probes and real
+// command traffic into a single 0-100 link score, and derives how fast and how
+// finely the controllers should send commands on the current link.
+class LinkQualityEstimator
+{
+public:
+    LinkQualityEstimator();
+
+    void addRttSample(double rttMs);
+    void addLoss();
+    void reset();
+
+    bool hasSamples() const { return m_sampleCount > 0; }
+    double rttMs() const { return m_smoothedRtt; }
+    double jitterMs() const { return m_jitter; }
+    double lossRate() const { return m_lossRate; }
+
+    // 0 (unusable) to 100 (perfect)
+    int score() const;
+
+    // Send interval for continuous drive commands on this link
+    int recommendedSendInterval() const;
+
+    // Quantization step for motor speeds; coarser steps on a poor link mean
+    // fewer distinct commands while the driver holds a steady input
+    int recommendedSpeedStep() const;
+
+private:
+    double m_smoothedRtt;
+    double m_jitter;
+    double m_lastRtt;
+    double m_lossRate;
+    int m_sampleCount;
+
+    // Smoothing factors, as in TCP's SRTT/RTTVAR estimation
+    static constexpr double RTT_GAIN = 0.125;
+    static constexpr double JITTER_GAIN = 0.0625;
+    static constexpr double LOSS_GAIN = 0.1;
+
+    // Ranges over which each metric degrades the score from full to none
+    static constexpr double GOOD_RTT_MS = 30.0;
+    static constexpr double BAD_RTT_MS = 500.0;
+    static constexpr double GOOD_JITTER_MS = 10.0;
+    static constexpr double BAD_JITTER_MS = 200.0;
+    static constexpr double BAD_LOSS_RATE = 0.3;
+
+    static const int MIN_SEND_INTERVAL = 40;  // ms - on an excellent link
+    static const int MAX_SEND_INTERVAL = 300; // ms - on a barely usable link
+    static const int MAX_SPEED_STEP = 10;
+};
+
+#endif // LINKQUALITYESTIMATOR_H
@@ -0,0 +1,92 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue (Vyukov's array-based design). Safe for any number
+// of producer and consumer threads; each slot carries a sequence number so
+// push and pop only contend on a single atomic index each.
+template <typename T, std::size_t Capacity>
+class LockFreeQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "LockFreeQueue capacity must be a power of two");
+
+public:
+    LockFreeQueue()
+    {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // Returns false without blocking if the queue is full
+    bool push(T value)
+    {
+        Slot *slot;
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            slot = &m_slots[pos & (Capacity - 1)];
+            std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = std::move(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false without blocking if the queue is empty
+    bool pop(T &value)
+    {
+        Slot *slot;
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            slot = &m_slots[pos & (Capacity - 1)];
+            std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(slot->value);
+        slot->value = T();
+        slot->sequence.store(pos + Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    // Keep the indices on separate cache lines from each other and the slots
+    alignas(64) std::array<Slot, Capacity> m_slots;
+    alignas(64) std::atomic<std::size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<std::size_t> m_dequeuePos{0};
+};
+
+#endif // LOCKFREEQUEUE_H
@@ -0,0 +1,285 @@
+#include "MjpegParser.h"
+#include <cstring>
+
+namespace {
+
+const char *findBytes(const char *begin, const char *end, const char *needle, qsizetype needleSize)
+{
+    // memchr for the first byte is vectorized by the C library; the full
+    // compare only runs on candidate positions
+    const char *p = begin;
+    while (end - p >= needleSize) {
+        p = static_cast<const char *>(std::memchr(p, needle[0], static_cast<size_t>(end - p - needleSize + 1)));
+        if (!p) {
+            return nullptr;
+        }
+        if (std::memcmp(p, needle, static_cast<size_t>(needleSize)) == 0) {
+            return p;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+inline quint8 byteAt(const char *data, qsizetype pos)
+{
+    return static_cast<quint8>(data[pos]);
+}
+
+// Markers without a length field
+inline bool isStandaloneMarker(quint8 marker)
+{
+    return marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8);
+}
+
+}
+
+MjpegParser::MjpegParser()
+    : m_resyncCount(0)
+{
+    reset();
+}
+
+void MjpegParser::setBoundary(const QByteArray &boundary)
+{
+    if (boundary.isEmpty()) {
+        m_delimiter.clear();
+    } else if (boundary.startsWith("--")) {
+        // Some cameras already include the dashes in the declared boundary
+        m_delimiter = boundary;
+    } else {
+        m_delimiter = "--" + boundary;
+    }
+    reset();
+}
+
+QByteArray MjpegParser::boundaryFromContentType(const QByteArray &contentType)
+{
+    int index = contentType.toLower().indexOf("boundary=");
+    if (index < 0) {
+        return QByteArray();
+    }
+
+    QByteArray boundary = contentType.mid(index + 9);
+    int end = boundary.indexOf(';');
+    if (end >= 0) {
+        boundary.truncate(end);
+    }
+    boundary = boundary.trimmed();
+    if (boundary.size() >= 2 && boundary.startsWith('"') && boundary.endsWith('"')) {
+        boundary = boundary.mid(1, boundary.size() - 2);
+    }
+    return boundary;
+}
+
+void MjpegParser::reset()
+{
+    m_state = afterFrameState();
+    m_pos = 0;
+    m_partStart = 0;
+    m_frameStart = 0;
+    m_contentLength = -1;
+}
+
+MjpegParser::State MjpegParser::afterFrameState() const
+{
+    return m_delimiter.isEmpty() ? State::SeekSoi : State::SeekBoundary;
+}
+
+qsizetype MjpegParser::retainFrom() const
+{
+    switch (m_state) {
+    case State::SeekBoundary:
+    case State::SeekSoi:
+        return m_pos;
+    case State::ReadHeaders:
+        return m_partStart;
+    default:
+        return m_frameStart;
+    }
+}
+
+void MjpegParser::discard(qsizetype count)
+{
+    m_pos -= count;
+    m_partStart = qMax<qsizetype>(0, m_partStart - count);
+    m_frameStart = qMax<qsizetype>(0, m_frameStart - count);
+}
+
+void MjpegParser::finishFrame(qsizetype end, Frame &frame)
+{
+    frame.offset = m_frameStart;
+    frame.size = end - m_frameStart;
+    m_pos = end;
+    m_contentLength = -1;
+    m_state = afterFrameState();
+}
+
+void MjpegParser::resync(qsizetype from)
+{
+    m_resyncCount++;
+    m_pos = from;
+    m_contentLength = -1;
+    m_state = afterFrameState();
+}
+
+bool MjpegParser::next(const char *data, qsizetype size, Frame &frame)
+{
+    const char *end = data + size;
+
+    while (m_pos < size) {
+        switch (m_state) {
+        case State::SeekBoundary: {
+            const char *found = findBytes(data + m_pos, end, m_delimiter.constData(), m_delimiter.size());
+            if (!found) {
+                // Keep a partial delimiter at the end of the buffer
+                m_pos = qMax(m_pos, size - m_delimiter.size() + 1);
+                return false;
+            }
+            m_partStart = found - data;
+            m_pos = m_partStart + m_delimiter.size();
+            m_state = State::ReadHeaders;
+            break;
+        }
+
+        case State::ReadHeaders: {
+            const char *found = findBytes(data + m_pos, end, "\r\n\r\n", 4);
+            if (!found) {
+                if (size - m_partStart > MAX_HEADER_SIZE) {
+                    resync(size - 3);
+                    continue;
+                }
+                m_pos = qMax(m_pos, size - 3);
+                return false;
+            }
+
+            // Part headers, between the delimiter line and the blank line
+            const qsizetype headersEnd = found - data;
+            m_contentLength = -1;
+            const char *line = data + m_partStart + m_delimiter.size();
+            while (line < found) {
+                const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(found - line)));
+                if (!lineEnd) {
+                    lineEnd = found;
+                }
+                static const char header[] = "content-length:";
+                const qsizetype headerSize = sizeof(header) - 1;
+                if (lineEnd - line > headerSize && qstrnicmp(line, header, static_cast<uint>(headerSize)) == 0) {
+                    bool ok = false;
+                    qsizetype length = QByteArray(line + headerSize, lineEnd - line - headerSize).trimmed().toLongLong(&ok);
+                    if (ok && length > 0) {
+                        m_contentLength = length;
+                    }
+                }
+                line = lineEnd + 1;
+            }
+
+            m_frameStart = headersEnd + 4;
+            m_pos = m_frameStart;
+
+            if (m_contentLength > MAX_FRAME_SIZE) {
+                resync(m_frameStart);
+            } else if (m_contentLength > 0) {
+                m_state = State::ReadBody;
+            } else {
+                m_state = State::SeekSoi;
+            }
+            break;
+        }
+
+        case State::ReadBody:
+            if (size - m_frameStart < m_contentLength) {
+                // Nothing to scan; just wait for the rest of the body
+                m_pos = size;
+                return false;
+            }
+            finishFrame(m_frameStart + m_contentLength, frame);
+            return true;
+
+        case State::SeekSoi: {
+            const char *p = data + m_pos;
+            for (;;) {
+                p = static_cast<const char *>(std::memchr(p, 0xFF, static_cast<size_t>(end - p)));
+                if (!p || p + 1 >= end) {
+                    m_pos = p ? p - data : size;
+                    return false;
+                }
+                if (static_cast<quint8>(p[1]) == 0xD8) {
+                    break;
+                }
+                ++p;
+            }
+            m_frameStart = p - data;
+            m_pos = m_frameStart + 2;
+            m_state = State::JpegSegments;
+            break;
+        }
+
+        case State::JpegSegments: {
+            // Walk marker segments up to the start of scan
+            if (size - m_pos < 4) {
+                return false;
+            }
+            if (byteAt(data, m_pos) != 0xFF) {
+                // Not a well-formed segment; fall back to scanning for EOI
+                m_state = State::JpegEntropy;
+                break;
+            }
+
+            quint8 marker = byteAt(data, m_pos + 1);
+            if (marker == 0xFF) {
+                m_pos++; // Fill byte
+            } else if (marker == 0xD9) {
+                finishFrame(m_pos + 2, frame);
+                return true;
+            } else if (isStandaloneMarker(marker)) {
+                m_pos += 2;
+            } else {
+                qsizetype length = (byteAt(data, m_pos + 2) << 8) | byteAt(data, m_pos + 3);
+                m_pos += 2 + length;
+                if (marker == 0xDA) {
+                    m_state = State::JpegEntropy;
+                }
+            }
+
+            if (m_pos - m_frameStart > MAX_FRAME_SIZE) {
+                resync(m_frameStart + 2);
+            }
+            break;
+        }
+
+        case State::JpegEntropy: {
+            const char *p = data + m_pos;
+            for (;;) {
+                p = static_cast<const char *>(std::memchr(p, 0xFF, static_cast<size_t>(end - p)));
+                if (!p || p + 1 >= end) {
+                    m_pos = p ? p - data : size;
+                    if (m_pos - m_frameStart > MAX_FRAME_SIZE) {
+                        resync(m_pos);
+                    }
+                    return false;
+                }
+
+                quint8 marker = static_cast<quint8>(p[1]);
+                if (marker == 0x00 || marker == 0xFF || (marker >= 0xD0 && marker <= 0xD7)) {
+                    // Stuffed byte, fill byte or restart marker: still in scan data
+                    p += (marker == 0xFF) ? 1 : 2;
+                    continue;
+                }
+                if (marker == 0xD9) {
+                    finishFrame((p - data) + 2, frame);
+                    return true;
+                }
+
+                // Another segment, e.g. the next scan of a progressive JPEG
+                m_pos = p - data;
+                m_state = State::JpegSegments;
+                break;
+            }
+            break;
+        }
+        }
+    }
+
+    return false;
+}
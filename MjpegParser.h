@@ -0,0 +1,72 @@
+#ifndef MJPEGPARSER_H
+#define MJPEGPARSER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+// Incremental multipart/x-mixed-replace parser for MJPEG streams.
+//
+// The parser never owns data; it is handed the owner's receive buffer on
+// every call and remembers where it stopped, so each byte is examined once.
+// Parts are delimited by the multipart boundary and sized by their
+// Content-Length header when present. Without a length (or without any
+// multipart framing) the JPEG itself is walked segment by segment, skipping
+// APPn payloads such as EXIF thumbnails, and the entropy-coded data is
+// scanned with memchr for the real end-of-image marker.
+class MjpegParser
+{
+public:
+    struct Frame {
+        qsizetype offset = 0;
+        qsizetype size = 0;
+    };
+
+    MjpegParser();
+
+    // Boundary from the response's Content-Type; empty means raw JPEGs
+    void setBoundary(const QByteArray &boundary);
+    static QByteArray boundaryFromContentType(const QByteArray &contentType);
+
+    void reset();
+
+    // Continues parsing data[0, size). Returns true and fills frame for each
+    // complete JPEG; call again until it returns false, then wait for more.
+    bool next(const char *data, qsizetype size, Frame &frame);
+
+    // Bytes before this offset are no longer needed by the parser
+    qsizetype retainFrom() const;
+
+    // The owner dropped count bytes from the front of its buffer
+    void discard(qsizetype count);
+
+    // Frames abandoned because they exceeded MAX_FRAME_SIZE or were corrupt
+    int resyncCount() const { return m_resyncCount; }
+
+    static const qsizetype MAX_FRAME_SIZE = 4 * 1024 * 1024;
+
+private:
+    enum class State {
+        SeekBoundary,
+        ReadHeaders,
+        ReadBody,
+        SeekSoi,
+        JpegSegments,
+        JpegEntropy
+    };
+
+    void finishFrame(qsizetype end, Frame &frame);
+    void resync(qsizetype from);
+    State afterFrameState() const;
+
+    QByteArray m_delimiter; // "--" + boundary
+    State m_state;
+    qsizetype m_pos;          // Next byte to examine
+    qsizetype m_partStart;    // Start of the current part's headers
+    qsizetype m_frameStart;   // Start of the current JPEG
+    qsizetype m_contentLength;
+    int m_resyncCount;
+
+    static const qsizetype MAX_HEADER_SIZE = 4096;
+};
+
+#endif // MJPEGPARSER_H
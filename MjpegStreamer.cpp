@@ -1,32 +1,106 @@
 #include "MjpegStreamer.h"
 #include <QNetworkRequest>
-#include <QPixmap>
-#include <QBuffer>
 #include <QDebug>
-#include <QMutex>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include "RobotProtocol.h"
 
-// Global image provider instance
-static StreamImageProvider *g_imageProvider = nullptr;
+namespace {
+
+struct RegisteredStream {
+    MjpegStreamer *streamer = nullptr;
+    QImage latestFrame;
+};
+
+// Streams by ID; the frames are read by image provider threads
+QMutex s_registryMutex;
+QHash<QString, RegisteredStream> s_registry;
+
+}
 
 MjpegStreamer::MjpegStreamer(QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
+    , m_decoder(new FrameDecoder(this))
+    , m_recorder(new StreamRecorder(this))
+    , m_replay(new ReplaySource(this))
+    , m_quality(new StreamQualityController(m_networkManager, this))
     , m_reply(nullptr)
     , m_connected(false)
     , m_status("Disconnected")
     , m_frameCount(0)
     , m_frameRate(0)
+    , m_lastDecodeTimeUs(0)
+    , m_decodeLoad(0.0)
+    , m_parsedFrames(0)
+    , m_receivedBytes(0)
+    , m_lastDroppedFrames(0)
+    , m_queueDepthSum(0)
     , m_boundaryFound(false)
+    , m_latestSequence(0)
+    , m_nextSequence(1)
+    , m_lastReceiveUs(0)
+    , m_measureEndToEnd(false)
 {
     // Initialize frame rate timer
     m_frameRateTimer = new QTimer(this);
     connect(m_frameRateTimer, &QTimer::timeout, this, &MjpegStreamer::updateFrameRate);
     m_frameRateTimer->start(1000); // Update every second
+
+    // Decoded frames arrive from the decoder thread
+    connect(m_decoder, &FrameDecoder::frameDecoded, this, &MjpegStreamer::onFrameDecoded,
+            Qt::QueuedConnection);
+
+    // Recorder signals come from its writer thread
+    connect(m_recorder, &StreamRecorder::recordingFailed, this, &MjpegStreamer::onRecordingFailed,
+            Qt::QueuedConnection);
+    connect(m_recorder, &StreamRecorder::writeError, this, &MjpegStreamer::onRecordingWriteError,
+            Qt::QueuedConnection);
+
+    connect(m_replay, &ReplaySource::frameReady, this, &MjpegStreamer::onReplayFrame);
+    connect(m_replay, &ReplaySource::finished, this, &MjpegStreamer::onReplayFinished);
+    connect(m_quality, &StreamQualityController::levelChanged, this, &MjpegStreamer::qualityChanged);
 }
 
 MjpegStreamer::~MjpegStreamer()
 {
     stopStream();
+    stopRecording();
+
+    QMutexLocker locker(&s_registryMutex);
+    auto it = s_registry.find(m_streamId);
+    if (it != s_registry.end() && it->streamer == this) {
+        s_registry.erase(it);
+    }
+}
+
+void MjpegStreamer::setStreamId(const QString &id)
+{
+    if (id.isEmpty() || m_streamId == id) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&s_registryMutex);
+        auto it = s_registry.find(m_streamId);
+        if (it != s_registry.end() && it->streamer == this) {
+            s_registry.erase(it);
+        }
+        if (s_registry.contains(id) && s_registry.value(id).streamer) {
+            qDebug() << "MjpegStreamer: Stream ID" << id << "is already in use; taking it over";
+        }
+        s_registry.insert(id, RegisteredStream{this, m_latestFrame});
+    }
+
+    m_streamId = id;
+    emit streamIdChanged();
+}
+
+QImage MjpegStreamer::latestFrame(const QString &id)
+{
+    QMutexLocker locker(&s_registryMutex);
+    return s_registry.value(id).latestFrame;
 }
 
 void MjpegStreamer::setUrl(const QString &url)
@@ -39,7 +113,7 @@ void MjpegStreamer::setUrl(const QString &url)
 
 void MjpegStreamer::startStream()
 {
-    if (m_reply) {
+    if (m_reply || m_replay->isOpen()) {
         stopStream();
     }
 
@@ -48,11 +122,17 @@ void MjpegStreamer::startStream()
         return;
     }
 
+    const QUrl url(m_url);
+    if (url.isLocalFile()) {
+        startReplay(url.toLocalFile());
+        return;
+    }
+
     setStatus("Connecting...");
 
     QNetworkRequest request(m_url);
     request.setRawHeader("Cache-Control", "no-cache");
-    request.setRawHeader("Connection", "close");
+    request.setRawHeader("Connection", "keep-alive");
     request.setRawHeader("User-Agent", "Qt MJPEG Streamer");
 
     m_reply = m_networkManager->get(request);
@@ -61,11 +141,12 @@ void MjpegStreamer::startStream()
     connect(m_reply, &QNetworkReply::errorOccurred, this, &MjpegStreamer::handleNetworkError);
     connect(m_reply, &QNetworkReply::finished, this, &MjpegStreamer::handleNetworkFinished);
 
-    // Reset frame counting
-    m_frameCount = 0;
-    m_buffer.clear();
-    m_boundaryFound = false;
-    m_boundary.clear();
+    resetPipeline();
+
+    // The camera may have rebooted into its default settings
+    m_quality->setStreamUrl(url);
+    m_quality->reset();
+    m_quality->apply();
 }
 
 void MjpegStreamer::stopStream()
@@ -82,11 +163,104 @@ void MjpegStreamer::stopStream()
         m_reply = nullptr;
     }
 
+    if (m_replay->isOpen()) {
+        m_replay->close();
+        emit replayChanged();
+    }
+
     setConnected(false);
     setStatus("Disconnected");
+    resetPipeline();
+}
+
+void MjpegStreamer::resetPipeline()
+{
+    m_frameCount = 0;
+    m_parsedFrames = 0;
+    m_receivedBytes = 0;
+    m_queueDepthSum = 0;
+    m_lastDroppedFrames = m_decoder->droppedFrames();
     m_buffer.clear();
     m_boundaryFound = false;
     m_boundary.clear();
+    m_parser.reset();
+    m_decoder->clear();
+    m_inFlight.fill(FrameTiming());
+    m_timingStats.reset();
+    emit timingChanged();
+}
+
+void MjpegStreamer::replay(const QString &path)
+{
+    setUrl(QUrl::fromLocalFile(path).toString());
+    startStream();
+}
+
+void MjpegStreamer::startReplay(const QString &path)
+{
+    resetPipeline();
+
+    if (!m_replay->open(path)) {
+        setStatus("Error: Cannot open recording " + path);
+        emit replayChanged();
+        return;
+    }
+
+    setConnected(true);
+    setStatus(QString("Replaying %1 frames").arg(m_replay->frameCount()));
+    emit replayChanged();
+    m_replay->play();
+}
+
+void MjpegStreamer::onReplayFrame(const JpegFrame &frame, quint64 timestampUs)
+{
+    Q_UNUSED(timestampUs)
+
+    // Replayed frames skip the network stages; their latency starts here
+    FrameTiming timing;
+    timing.sequence = m_nextSequence++;
+    timing.receivedUs = RobotProtocol::timestampUs();
+    timing.parsedUs = timing.receivedUs;
+    m_decoder->submit(frame, timing);
+}
+
+void MjpegStreamer::onReplayFinished()
+{
+    setStatus("Replay finished");
+    emit replayPositionChanged();
+}
+
+void MjpegStreamer::seek(double positionMs)
+{
+    if (m_replay->isOpen()) {
+        m_replay->seek(static_cast<quint64>(qMax(0.0, positionMs) * 1000.0));
+        emit replayPositionChanged();
+    }
+}
+
+void MjpegStreamer::setAdaptiveQuality(bool enabled)
+{
+    if (m_quality->isEnabled() != enabled) {
+        m_quality->setStreamUrl(QUrl(m_url));
+        m_quality->setEnabled(enabled);
+        emit qualityChanged();
+    }
+}
+
+void MjpegStreamer::setReplaySpeed(double speed)
+{
+    if (m_replay->speed() != speed) {
+        m_replay->setSpeed(speed);
+        emit replayChanged();
+    }
+}
+
+void MjpegStreamer::setReplayLoop(bool loop)
+{
+    if (m_replay->loop() != loop) {
+        m_replay->setLoop(loop);
+        emit replayChanged();
+    }
 }
 
 void MjpegStreamer::reconnect()
@@ -95,12 +269,81 @@ void MjpegStreamer::reconnect()
     QTimer::singleShot(1000, this, &MjpegStreamer::startStream);
 }
 
+void MjpegStreamer::setConsumerSize(const QString &consumer, int width, int height)
+{
+    if (width > 0 && height > 0) {
+        m_consumerSizes.insert(consumer, QSize(width, height));
+    } else {
+        m_consumerSizes.remove(consumer);
+    }
+
+    QSize largest;
+    for (const QSize &size : std::as_const(m_consumerSizes)) {
+        largest = largest.expandedTo(size);
+    }
+    m_decoder->setTargetSize(largest);
+}
+
+void MjpegStreamer::startRecording(const QString &path)
+{
+    QString target = path;
+    if (target.isEmpty()) {
+        // The recorder creates the folder on its own thread
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::MoviesLocation));
+        target = dir.filePath("RC_GUI/camera-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".mjpg");
+    }
+
+    // Failing to open the files is reported by onRecordingFailed()
+    m_recorder->start(target);
+    emit recordingChanged();
+    emit frameStatsChanged();
+}
+
+void MjpegStreamer::stopRecording()
+{
+    if (m_recorder->isRecording()) {
+        m_recorder->stop();
+        emit recordingChanged();
+    }
+}
+
+void MjpegStreamer::onRecordingFailed(const QString &path, const QString &message)
+{
+    setStatus("Error: Cannot record to " + path + ": " + message);
+    emit recordingChanged();
+}
+
+void MjpegStreamer::onRecordingWriteError(const QString &message)
+{
+    setStatus("Error: Recording write failed: " + message);
+    emit recordingChanged();
+}
+
 void MjpegStreamer::handleNetworkData()
 {
     if (!m_reply) return;
 
-    QByteArray data = m_reply->readAll();
-    m_buffer.append(data);
+    // Take the multipart boundary from the response headers once
+    if (!m_boundaryFound) {
+        m_boundary = MjpegParser::boundaryFromContentType(m_reply->rawHeader("Content-Type"));
+        m_boundaryFound = true;
+        m_parser.setBoundary(m_boundary);
+        qDebug() << "MjpegStreamer: Multipart boundary:" << (m_boundary.isEmpty() ? "<none>" : m_boundary);
+    }
+
+    // Read straight into the stream buffer instead of through a temporary
+    qint64 available = m_reply->bytesAvailable();
+    while (available > 0) {
+        char *dest = m_buffer.reserve(available);
+        qint64 read = m_reply->read(dest, available);
+        if (read <= 0) {
+            break;
+        }
+        m_buffer.commit(read);
+        m_receivedBytes += read;
+        available = m_reply->bytesAvailable();
+    }
+    m_lastReceiveUs = RobotProtocol::timestampUs();
 
     if (!m_connected) {
         setConnected(true);
@@ -131,74 +374,94 @@ void MjpegStreamer::handleNetworkFinished()
 
 void MjpegStreamer::processBuffer()
 {
-    // Process multiple frames if available, but limit to prevent UI blocking
-    int framesProcessed = 0;
-    const int maxFramesPerCall = 3;
-
-    while (m_buffer.size() > 1000 && framesProcessed < maxFramesPerCall) {
-        // Look for JPEG start marker (0xFFD8)
-        int jpegStart = -1;
-        for (int i = 0; i < m_buffer.size() - 1; i++) {
-            if ((unsigned char)m_buffer[i] == 0xFF && (unsigned char)m_buffer[i + 1] == 0xD8) {
-                jpegStart = i;
-                break;
-            }
+    // Parsing is cheap and never rescans, so hand every complete frame to
+    // the decoder; it keeps only the newest if it falls behind
+    MjpegParser::Frame frame;
+    while (m_parser.next(m_buffer.data(), m_buffer.size(), frame)) {
+        FrameTiming timing;
+        timing.sequence = m_nextSequence++;
+        timing.receivedUs = m_lastReceiveUs;
+        timing.parsedUs = RobotProtocol::timestampUs();
+
+        const char *jpeg = m_buffer.data() + frame.offset;
+        if (m_measureEndToEnd) {
+            RobotProtocol::readCameraTimestamp(jpeg, static_cast<std::size_t>(frame.size), timing.cameraUs);
         }
 
-        if (jpegStart < 0) {
-            // Remove some data to prevent buffer from growing indefinitely
-            if (m_buffer.size() > 100000) {
-                m_buffer.remove(0, 50000);
-            }
-            break;
-        }
+        // Frames are views into the stream buffer; nothing is copied
+        JpegFrame jpegFrame = m_buffer.frame(frame.offset, frame.size);
+        m_recorder->append(jpegFrame, timing.receivedUs);
 
-        // Look for JPEG end marker (0xFFD9) after the start
-        int jpegEnd = -1;
-        for (int i = jpegStart + 2; i < m_buffer.size() - 1; i++) {
-            if ((unsigned char)m_buffer[i] == 0xFF && (unsigned char)m_buffer[i + 1] == 0xD9) {
-                jpegEnd = i + 2; // Include the end marker
-                break;
-            }
-        }
-
-        if (jpegEnd < 0) {
-            break; // Wait for more data
-        }
-
-        // Extract JPEG data
-        QByteArray jpegData = m_buffer.mid(jpegStart, jpegEnd - jpegStart);
+        // Sampled before submitting: what this frame finds still in the
+        // decoder, not counting itself
+        m_parsedFrames++;
+        m_queueDepthSum += m_decoder->queuedFrames();
+        m_decoder->submit(jpegFrame, timing);
+    }
 
-        // Try to create pixmap
-        QPixmap pixmap;
-        if (pixmap.loadFromData(jpegData, "JPEG")) {
-            m_latestFrame = pixmap;
-            emit newFrame(pixmap);
-            m_frameCount++;
+    // Drop everything the parser no longer needs
+    qsizetype consumed = m_parser.retainFrom();
+    if (consumed > 0) {
+        m_buffer.consume(consumed);
+        m_parser.discard(consumed);
+    }
+}
 
-            // Update image provider
-            if (g_imageProvider) {
-                g_imageProvider->updatePixmap(pixmap);
-            }
+void MjpegStreamer::onFrameDecoded(const QImage &image, const FrameTiming &timing)
+{
+    // A frame decoded after the stream was stopped is stale
+    if (!m_reply && !m_replay->isOpen()) {
+        return;
+    }
 
-            framesProcessed++;
+    FrameTiming &slot = m_inFlight[timing.sequence % IN_FLIGHT_FRAMES];
+    slot = timing;
+    slot.deliveredUs = RobotProtocol::timestampUs();
+
+    m_latestFrame = image;
+    m_latestSequence = timing.sequence;
+    {
+        QMutexLocker locker(&s_registryMutex);
+        auto it = s_registry.find(m_streamId);
+        if (it != s_registry.end() && it->streamer == this) {
+            it->latestFrame = image;
         }
+    }
+
+    // At max replay speed the next frame follows as soon as this one is done
+    m_replay->advance();
+    emit newFrame(image);
+    m_frameCount++;
+}
 
-        // Remove processed data
-        m_buffer.remove(0, jpegEnd);
+void MjpegStreamer::framePresented(quint64 sequence, quint64 presentedUs)
+{
+    // Frames replaced before a view drew them have already left the ring
+    FrameTiming &slot = m_inFlight[sequence % IN_FLIGHT_FRAMES];
+    if (slot.sequence != sequence || slot.presentedUs != 0) {
+        return;
     }
 
-    // Only emit imageChanged once per processBuffer call to reduce flicker
-    if (framesProcessed > 0) {
-        emit imageChanged();
+    slot.presentedUs = presentedUs;
+    m_timingStats.addFrame(slot);
+}
+
+void MjpegStreamer::setMeasureEndToEnd(bool enabled)
+{
+    if (m_measureEndToEnd != enabled) {
+        m_measureEndToEnd = enabled;
+        emit measureEndToEndChanged();
     }
 }
 
-QPixmap MjpegStreamer::extractFrame(const QByteArray &jpegData)
+double MjpegStreamer::endToEndLatency() const
+{
+    return m_timingStats.endToEnd().count() > 0 ? m_timingStats.endToEnd().mean() : -1.0;
+}
+
+double MjpegStreamer::endToEndJitter() const
 {
-    QPixmap pixmap;
-    pixmap.loadFromData(jpegData, "JPEG");
-    return pixmap;
+    return m_timingStats.endToEnd().count() > 0 ? m_timingStats.endToEnd().stddev() : -1.0;
 }
 
 void MjpegStreamer::setConnected(bool connected)
@@ -221,50 +484,57 @@ void MjpegStreamer::updateFrameRate()
 {
     m_frameRate = m_frameCount;
     m_frameCount = 0;
+
+    // Decode time over the last second, as a share of one core
+    const quint64 decodeTimeUs = m_decoder->decodeTimeUs();
+    m_decodeLoad = (decodeTimeUs - m_lastDecodeTimeUs) / 10000.0;
+    m_lastDecodeTimeUs = decodeTimeUs;
+
+    if (m_reply) {
+        StreamQualityController::Sample sample;
+        sample.receivedFrames = m_parsedFrames;
+        sample.droppedFrames = static_cast<int>(m_decoder->droppedFrames() - m_lastDroppedFrames);
+        sample.decodeQueueDepth = m_parsedFrames > 0 ? double(m_queueDepthSum) / m_parsedFrames : 0.0;
+        sample.pipelineLatencyMs = m_timingStats.pipeline().mean();
+        sample.receivedBytes = m_receivedBytes;
+        m_quality->addSample(sample);
+    }
+    m_parsedFrames = 0;
+    m_receivedBytes = 0;
+    m_queueDepthSum = 0;
+    m_lastDroppedFrames = m_decoder->droppedFrames();
+
     emit frameRateChanged();
-}
+    emit frameStatsChanged();
+    emit timingChanged();
 
-// Static function to get the image provider instance
-StreamImageProvider* MjpegStreamer::getImageProvider()
-{
-    if (!g_imageProvider) {
-        g_imageProvider = new StreamImageProvider();
+    if (m_replay->isOpen()) {
+        emit replayPositionChanged();
     }
-    return g_imageProvider;
 }
 
 // ============================================================================
 
-// StreamImageProvider implementation
 StreamImageProvider::StreamImageProvider()
-    : QQuickImageProvider(QQuickImageProvider::Pixmap)
+    : QQuickImageProvider(QQuickImageProvider::Image)
 {
 }
 
-QPixmap StreamImageProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+QImage StreamImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
-    QMutexLocker locker(&m_mutex);
-
-    if (m_currentPixmap.isNull()) {
-        // Return a placeholder image
-        QPixmap placeholder(640, 480);
-        placeholder.fill(Qt::darkGray);
-        return placeholder;
+    QImage image = MjpegStreamer::latestFrame(id);
+    if (image.isNull()) {
+        // Placeholder until the stream delivers its first frame
+        image = QImage(640, 480, QImage::Format_RGB32);
+        image.fill(Qt::darkGray);
     }
 
     if (size) {
-        *size = m_currentPixmap.size();
+        *size = image.size();
     }
 
-    if (requestedSize.isValid()) {
-        return m_currentPixmap.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    if (requestedSize.isValid() && requestedSize != image.size()) {
+        return image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
     }
-
-    return m_currentPixmap;
-}
-
-void StreamImageProvider::updatePixmap(const QPixmap &pixmap)
-{
-    QMutexLocker locker(&m_mutex);
-    m_currentPixmap = pixmap;
+    return image;
 }
@@ -5,22 +5,69 @@
 #include <QObject>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QPixmap>
+#include <QImage>
 #include <QTimer>
 #include <QMutex>
+#include <QHash>
 #include <QQuickImageProvider>
-#include <QQmlEngine>
-
-// Forward declaration
-class StreamImageProvider;
+#include "MjpegParser.h"
+#include "StreamBuffer.h"
+#include "FrameDecoder.h"
+#include "FrameTiming.h"
+#include "StreamRecorder.h"
+#include "ReplaySource.h"
+#include "StreamQualityController.h"
+#include <array>
 
 class MjpegStreamer : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString url READ url WRITE setUrl NOTIFY urlChanged)
+    Q_PROPERTY(QString streamId READ streamId WRITE setStreamId NOTIFY streamIdChanged)
     Q_PROPERTY(bool connected READ connected NOTIFY connectedChanged)
     Q_PROPERTY(QString status READ status NOTIFY statusChanged)
     Q_PROPERTY(int frameRate READ frameRate NOTIFY frameRateChanged)
+    Q_PROPERTY(int decodedFrames READ decodedFrames NOTIFY frameStatsChanged)
+    Q_PROPERTY(int droppedFrames READ droppedFrames NOTIFY frameStatsChanged)
+    Q_PROPERTY(int queuedFrames READ queuedFrames NOTIFY frameStatsChanged)
+    Q_PROPERTY(int decodeScale READ decodeScale NOTIFY frameStatsChanged)
+    Q_PROPERTY(double decodeLoad READ decodeLoad NOTIFY frameStatsChanged) // % of one core
+    Q_PROPERTY(double ingestBandwidth READ ingestBandwidth NOTIFY frameStatsChanged) // KB/s
+
+    // Lowers camera resolution and quality when the link or decoder can't keep up
+    Q_PROPERTY(bool adaptiveQuality READ adaptiveQuality WRITE setAdaptiveQuality NOTIFY qualityChanged)
+    Q_PROPERTY(int qualityLevel READ qualityLevel NOTIFY qualityChanged)
+    Q_PROPERTY(QString qualityDescription READ qualityDescription NOTIFY qualityChanged)
+
+    // Rolling per-stage latency over recently presented frames, in ms
+    Q_PROPERTY(double parseLatency READ parseLatency NOTIFY timingChanged)
+    Q_PROPERTY(double decodeQueueLatency READ decodeQueueLatency NOTIFY timingChanged)
+    Q_PROPERTY(double decodeLatency READ decodeLatency NOTIFY timingChanged)
+    Q_PROPERTY(double deliveryLatency READ deliveryLatency NOTIFY timingChanged)
+    Q_PROPERTY(double presentLatency READ presentLatency NOTIFY timingChanged)
+    Q_PROPERTY(double pipelineLatency READ pipelineLatency NOTIFY timingChanged)
+    Q_PROPERTY(double pipelineJitter READ pipelineJitter NOTIFY timingChanged)
+    Q_PROPERTY(double frameIntervalJitter READ frameIntervalJitter NOTIFY timingChanged)
+
+    // Camera capture to screen, from timestamps the mock robot embeds in
+    // each frame; -1 while no timestamped frames have been presented
+    Q_PROPERTY(bool measureEndToEnd READ measureEndToEnd WRITE setMeasureEndToEnd NOTIFY measureEndToEndChanged)
+    Q_PROPERTY(double endToEndLatency READ endToEndLatency NOTIFY timingChanged)
+    Q_PROPERTY(double endToEndJitter READ endToEndJitter NOTIFY timingChanged)
+
+    // Frames are recorded as received; see StreamRecorder
+    Q_PROPERTY(bool recording READ recording NOTIFY recordingChanged)
+    Q_PROPERTY(QString recordingPath READ recordingPath NOTIFY recordingChanged)
+    Q_PROPERTY(int recordedFrames READ recordedFrames NOTIFY frameStatsChanged)
+    Q_PROPERTY(double recordedMegabytes READ recordedMegabytes NOTIFY frameStatsChanged)
+    Q_PROPERTY(int recordingDroppedFrames READ recordingDroppedFrames NOTIFY frameStatsChanged)
+
+    // Replay of a recording, selected with a file:// url or replay()
+    Q_PROPERTY(bool replaying READ replaying NOTIFY replayChanged)
+    Q_PROPERTY(double replaySpeed READ replaySpeed WRITE setReplaySpeed NOTIFY replayChanged)
+    Q_PROPERTY(bool replayLoop READ replayLoop WRITE setReplayLoop NOTIFY replayChanged)
+    Q_PROPERTY(double replayDuration READ replayDuration NOTIFY replayChanged)
+    Q_PROPERTY(double replayPosition READ replayPosition NOTIFY replayPositionChanged)
 
 public:
     explicit MjpegStreamer(QObject *parent = nullptr);
@@ -29,41 +76,125 @@ public:
     QString url() const { return m_url; }
     void setUrl(const QString &url);
 
+    // Streams are registered by ID so other views can show them; the
+    // "camera" image provider serves image://camera/<streamId>
+    QString streamId() const { return m_streamId; }
+    void setStreamId(const QString &id);
+    static QImage latestFrame(const QString &id); // Safe from any thread
+
     bool connected() const { return m_connected; }
     QString status() const { return m_status; }
     int frameRate() const { return m_frameRate; }
+    int decodedFrames() const { return static_cast<int>(m_decoder->decodedFrames()); }
+    int droppedFrames() const { return static_cast<int>(m_decoder->droppedFrames()); }
+    int queuedFrames() const { return m_decoder->queuedFrames(); }
+    int decodeScale() const { return m_decoder->decodeScale(); }
+    double decodeLoad() const { return m_decodeLoad; }
+    double ingestBandwidth() const { return m_quality->bandwidth() / 1024.0; }
+
+    bool adaptiveQuality() const { return m_quality->isEnabled(); }
+    void setAdaptiveQuality(bool enabled);
+    int qualityLevel() const { return m_quality->level(); }
+    QString qualityDescription() const { return m_quality->levelDescription(); }
+
+    double parseLatency() const { return m_timingStats.parse().mean(); }
+    double decodeQueueLatency() const { return m_timingStats.decodeQueue().mean(); }
+    double decodeLatency() const { return m_timingStats.decode().mean(); }
+    double deliveryLatency() const { return m_timingStats.delivery().mean(); }
+    double presentLatency() const { return m_timingStats.present().mean(); }
+    double pipelineLatency() const { return m_timingStats.pipeline().mean(); }
+    double pipelineJitter() const { return m_timingStats.pipeline().stddev(); }
+    double frameIntervalJitter() const { return m_timingStats.frameInterval().stddev(); }
+
+    bool measureEndToEnd() const { return m_measureEndToEnd; }
+    void setMeasureEndToEnd(bool enabled);
+    double endToEndLatency() const;
+    double endToEndJitter() const;
+
+    bool recording() const { return m_recorder->isRecording(); }
+    QString recordingPath() const { return m_recorder->isRecording() ? m_recorder->path() : QString(); }
+    int recordedFrames() const { return static_cast<int>(m_recorder->recordedFrames()); }
+    double recordedMegabytes() const { return m_recorder->recordedBytes() / (1024.0 * 1024.0); }
+    int recordingDroppedFrames() const { return static_cast<int>(m_recorder->droppedFrames()); }
+
+    bool replaying() const { return m_replay->isOpen(); }
+    double replaySpeed() const { return m_replay->speed(); }
+    void setReplaySpeed(double speed);
+    bool replayLoop() const { return m_replay->loop(); }
+    void setReplayLoop(bool loop);
+    double replayDuration() const { return m_replay->durationUs() / 1000.0; }
+    double replayPosition() const { return m_replay->positionUs() / 1000.0; }
 
     Q_INVOKABLE void startStream();
     Q_INVOKABLE void stopStream();
     Q_INVOKABLE void reconnect();
 
-    // Static function to get the global image provider
-    static StreamImageProvider* getImageProvider();
+    // An empty path records to a timestamped file under the Movies folder.
+    // The files are opened in the background; a failure ends the recording
+    // and is shown in the status.
+    Q_INVOKABLE void startRecording(const QString &path = QString());
+    Q_INVOKABLE void stopRecording();
+
+    // Plays a recording through the same decode and display path; speed 1
+    // is real time, 0 is as fast as frames can be decoded
+    Q_INVOKABLE void replay(const QString &path);
+    Q_INVOKABLE void seek(double positionMs);
+
+    // Each view reports the size it displays the stream at (in device
+    // pixels); frames are decoded just large enough for the biggest one.
+    // A zero size unregisters the consumer.
+    Q_INVOKABLE void setConsumerSize(const QString &consumer, int width, int height);
+
+    // Most recent decoded frame, for views attached mid-stream
+    QImage latestFrame() const { return m_latestFrame; }
+    quint64 latestFrameSequence() const { return m_latestSequence; }
+
+public slots:
+    // Called by views once the frame is on screen, with the swap time
+    void framePresented(quint64 sequence, quint64 presentedUs);
 
 signals:
     void urlChanged();
+    void streamIdChanged();
     void connectedChanged();
     void statusChanged();
     void frameRateChanged();
-    void newFrame(const QPixmap &pixmap);
-    void imageChanged(); // Signal for QML Image to update
+    void frameStatsChanged();
+    void timingChanged();
+    void measureEndToEndChanged();
+    void recordingChanged();
+    void replayChanged();
+    void replayPositionChanged();
+    void qualityChanged();
+    void newFrame(const QImage &image);
 
 private slots:
     void handleNetworkData();
     void handleNetworkError(QNetworkReply::NetworkError error);
     void handleNetworkFinished();
     void updateFrameRate();
+    void onFrameDecoded(const QImage &image, const FrameTiming &timing);
+    void onReplayFrame(const JpegFrame &frame, quint64 timestampUs);
+    void onReplayFinished();
+    void onRecordingFailed(const QString &path, const QString &message);
+    void onRecordingWriteError(const QString &message);
 
 private:
     void setConnected(bool connected);
     void setStatus(const QString &status);
     void processBuffer();
-    QPixmap extractFrame(const QByteArray &jpegData);
+    void startReplay(const QString &path);
+    void resetPipeline();
 
     QNetworkAccessManager *m_networkManager;
+    FrameDecoder *m_decoder;
+    StreamRecorder *m_recorder;
+    ReplaySource *m_replay;
+    StreamQualityController *m_quality;
     QNetworkReply *m_reply;
-    QByteArray m_buffer;
+    StreamBuffer m_buffer;
     QString m_url;
+    QString m_streamId;
     bool m_connected;
     QString m_status;
 
@@ -71,26 +202,43 @@ private:
     QTimer *m_frameRateTimer;
     int m_frameCount;
     int m_frameRate;
+    quint64 m_lastDecodeTimeUs;
+    double m_decodeLoad;
+
+    // Inputs for the quality controller, per second
+    int m_parsedFrames;
+    qint64 m_receivedBytes;
+    quint64 m_lastDroppedFrames;
+    int m_queueDepthSum;
 
     // MJPEG boundary detection
     QByteArray m_boundary;
     bool m_boundaryFound;
+    MjpegParser m_parser;
+
+    // Display sizes by consumer, for choosing the decode scale
+    QHash<QString, QSize> m_consumerSizes;
 
     // Latest frame storage
-    QPixmap m_latestFrame;
+    QImage m_latestFrame;
+    quint64 m_latestSequence;
+
+    // Frame timing; delivered frames wait here until a view presents them
+    static const int IN_FLIGHT_FRAMES = 8;
+    std::array<FrameTiming, IN_FLIGHT_FRAMES> m_inFlight;
+    FrameTimingStats m_timingStats;
+    quint64 m_nextSequence;
+    quint64 m_lastReceiveUs;
+    bool m_measureEndToEnd;
 };
 
-// Custom image provider for QML
+// Serves the latest frame of a stream by ID, for views that want a plain
+// Image (snapshots, thumbnails); the live view uses VideoSurface
 class StreamImageProvider : public QQuickImageProvider
 {
 public:
     StreamImageProvider();
-    QPixmap requestPixmap(const QString &id, QSize *size, const QSize &requestedSize) override;
-    void updatePixmap(const QPixmap &pixmap);
-
-private:
-    QPixmap m_currentPixmap;
-    QMutex m_mutex;
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
 };
 
 #endif // MJPEGSTREAMER_H
@@ -0,0 +1,73 @@
+#include "MotorOutputStage.h"
+
+MotorOutputStage::MotorOutputStage()
+    : m_threshold(0)
+    , m_maxSlewPerTick(0)
+    , m_keepaliveInterval(0)
+    , m_left(0)
+    , m_right(0)
+    , m_lastSentMs(0)
+    , m_suppressedCommands(0)
+    , m_keepalivesSent(0)
+{
+}
+
+int MotorOutputStage::slew(int current, int target, int maxStep)
+{
+    if (maxStep <= 0 || target == 0) {
+        return target;
+    }
+
+    // Reversing drops to zero at once and accelerates from there
+    if (current != 0 && (current > 0) != (target > 0)) {
+        current = 0;
+    }
+
+    // Slowing down is immediate; only speeding up is limited
+    if (qAbs(target) <= qAbs(current)) {
+        return target;
+    }
+    return target > current ? qMin(target, current + maxStep) : qMax(target, current - maxStep);
+}
+
+bool MotorOutputStage::update(int targetLeft, int targetRight, int ticks, qint64 nowMs, int &left, int &right)
+{
+    const int maxStep = m_maxSlewPerTick * qMax(1, ticks);
+    const int nextLeft = slew(m_left, targetLeft, maxStep);
+    const int nextRight = slew(m_right, targetRight, maxStep);
+
+    bool send = false;
+    if (nextLeft != m_left || nextRight != m_right) {
+        const bool stop = nextLeft == 0 && nextRight == 0;
+        const bool significant = qAbs(nextLeft - m_left) >= m_threshold
+                                 || qAbs(nextRight - m_right) >= m_threshold;
+        if (stop || significant) {
+            send = true;
+        } else {
+            ++m_suppressedCommands;
+        }
+    }
+
+    if (!send && m_keepaliveInterval > 0 && (m_left != 0 || m_right != 0)
+        && nowMs - m_lastSentMs >= m_keepaliveInterval) {
+        // Refresh the robot with the newest shaped speeds, held back or not
+        send = true;
+        ++m_keepalivesSent;
+    }
+
+    if (!send) {
+        return false;
+    }
+
+    m_left = left = nextLeft;
+    m_right = right = nextRight;
+    m_lastSentMs = nowMs;
+    return true;
+}
+
+void MotorOutputStage::setOutput(int left, int right, qint64 nowMs)
+{
+    m_left = left;
+    m_right = right;
+    m_lastSentMs = nowMs;
+}
@@ -0,0 +1,53 @@
+#ifndef MOTOROUTPUTSTAGE_H
+#define MOTOROUTPUTSTAGE_H
+
+#include <QtGlobal>
+
+// Shapes the mixed motor speeds into the drive commands actually sent.
+// Changes smaller than a threshold are held back, acceleration is limited
+// to a maximum step per control tick, and a moving robot gets its command
+// repeated at a keepalive interval so one lost request cannot leave it on a
+// stale command for long. Slowing down and reversing through zero are not
+// slew limited, and a stop is always sent at once.
+class MotorOutputStage
+{
+public:
+    MotorOutputStage();
+
+    // Zero disables the respective stage
+    int threshold() const { return m_threshold; }
+    void setThreshold(int threshold) { m_threshold = qMax(0, threshold); }
+    int maxSlewPerTick() const { return m_maxSlewPerTick; }
+    void setMaxSlewPerTick(int step) { m_maxSlewPerTick = qMax(0, step); }
+    int keepaliveInterval() const { return m_keepaliveInterval; }
+    void setKeepaliveInterval(int ms) { m_keepaliveInterval = qMax(0, ms); }
+
+    // Takes the target speeds; ticks is how many control ticks the slew
+    // step may cover, which callers cap at their spacing between sends.
+    // Returns true with the speeds to send now, or false to send nothing.
+    bool update(int targetLeft, int targetRight, int ticks, qint64 nowMs, int &left, int &right);
+
+    // Records speeds sent outside update(), such as an emergency stop
+    void setOutput(int left, int right, qint64 nowMs);
+
+    // Ticks on which a changed command was held back by the threshold
+    quint64 suppressedCommands() const { return m_suppressedCommands; }
+    quint64 keepalivesSent() const { return m_keepalivesSent; }
+
+private:
+    static int slew(int current, int target, int maxStep);
+
+    int m_threshold;
+    int m_maxSlewPerTick;
+    int m_keepaliveInterval; // ms
+
+    // Last speeds sent and when
+    int m_left;
+    int m_right;
+    qint64 m_lastSentMs;
+
+    quint64 m_suppressedCommands;
+    quint64 m_keepalivesSent;
+};
+
+#endif // MOTOROUTPUTSTAGE_H
@@ -1,4 +1,5 @@
 #include "NetworkManager.h"
+#include <QCoreApplication>
 #include <QDebug>
 
 NetworkManager* NetworkManager::s_instance = nullptr;
@@ -13,214 +14,193 @@ NetworkManager* NetworkManager::instance()
 
 NetworkManager::NetworkManager(QObject *parent)
     : QObject(parent)
-    , m_networkManager(new QNetworkAccessManager(this))
-    , m_connectionTimeoutTimer(new QTimer(this))
+    , m_thread(new QThread(this))
+    , m_worker(new NetworkWorker(&m_queue, &m_drainScheduled, &m_stopMailbox))
+    , m_drainScheduled(false)
+    , m_binaryCommands(false)
+    , m_deadmanHeartbeat(false)
     , m_isConnected(false)
 {
-    // Setup connection timeout timer
-    m_connectionTimeoutTimer->setSingleShot(true);
-    m_connectionTimeoutTimer->setInterval(CONNECTION_TIMEOUT);
-    connect(m_connectionTimeoutTimer, &QTimer::timeout, this, &NetworkManager::onConnectionTimeout);
+    // Until the first sample arrives, use the estimator's defaults
+    LinkQualityEstimator defaults;
+    m_linkQuality.sendInterval = defaults.recommendedSendInterval();
+    m_linkQuality.speedStep = defaults.recommendedSpeedStep();
+
+    m_thread->setObjectName("NetworkManager I/O");
+    m_worker->moveToThread(m_thread);
+
+    connect(m_thread, &QThread::started, m_worker, &NetworkWorker::initialize);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+
+    // Results come back to the GUI thread through queued connections
+    connect(m_worker, &NetworkWorker::requestFinished, this, &NetworkManager::requestFinished,
+            Qt::QueuedConnection);
+    connect(m_worker, &NetworkWorker::connectionStatusChanged, this, &NetworkManager::onWorkerConnectionStatus,
+            Qt::QueuedConnection);
+    connect(m_worker, &NetworkWorker::connectionStatsChanged, this, &NetworkManager::onWorkerStats,
+            Qt::QueuedConnection);
+    connect(m_worker, &NetworkWorker::linkQualityChanged, this, &NetworkManager::onWorkerLinkQuality,
+            Qt::QueuedConnection);
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &NetworkManager::shutdown);
+    }
+
+    // Control traffic is latency critical; keep it ahead of UI work
+    m_thread->start(QThread::HighPriority);
+}
 
-    // Connect network manager signals
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, &NetworkManager::onNetworkReply);
+void NetworkManager::shutdown()
+{
+    m_thread->quit();
+    m_thread->wait();
 }
 
-void NetworkManager::sendPostRequest(const QString &url, const QByteArray &data,
-                                     const QString &contentType, QObject *requester)
+void NetworkManager::setHostUrl(const QString &url)
 {
-    if (url.isEmpty()) {
-        qDebug() << "NetworkManager: Empty URL provided";
-        if (requester) {
-            emit requestFinished(requester, false, "Empty URL");
-        }
+    QUrl parsed(url);
+    if (!parsed.isValid() || parsed.host().isEmpty()) {
+        qDebug() << "NetworkManager: Ignoring invalid host URL" << url;
         return;
     }
 
-    QNetworkRequest request{QUrl(url)};
-    request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
-
-    QNetworkReply *reply = m_networkManager->post(request, data);
-
-    // Track the request and its requester
-    if (requester) {
-        m_pendingRequests[reply] = requester;
-    }
+    QUrl host;
+    host.setScheme(parsed.scheme().isEmpty() ? QStringLiteral("http") : parsed.scheme());
+    host.setHost(parsed.host());
+    host.setPort(parsed.port());
 
-    // IMPORTANT: Connect the individual reply's finished signal
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        this->handleReplyFinished(reply);
-    });
+    if (m_hostUrl != host) {
+        m_hostUrl = host;
+        emit hostUrlChanged();
 
-    // Start/restart connection timeout timer only if we have pending requests
-    if (!m_pendingRequests.isEmpty()) {
-        m_connectionTimeoutTimer->start();
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker, host]() {
+            worker->setHostUrl(host);
+        }, Qt::QueuedConnection);
     }
-
-    qDebug() << "NetworkManager: Sending POST request to" << url << "with data:" << data;
 }
 
-void NetworkManager::handleReplyFinished(QNetworkReply* reply)
+void NetworkManager::prewarmConnection()
 {
-    qDebug() << "NetworkManager: handleReplyFinished() called - ENTRY POINT";
+    QMetaObject::invokeMethod(m_worker, &NetworkWorker::prewarmConnection, Qt::QueuedConnection);
+}
 
-    if (!reply) {
-        qDebug() << "NetworkManager: ERROR - No reply object in handleReplyFinished()";
+void NetworkManager::sendPostRequest(const QString &url, const QByteArray &data,
+                                     const QString &contentType, QObject *requester)
+{
+    if (url.isEmpty()) {
+        qDebug() << "NetworkManager: Empty URL provided";
+        if (requester) {
+            emit requestFinished(requester, false, "Empty URL");
+        }
         return;
     }
 
-    qDebug() << "NetworkManager: Processing reply for" << reply->url();
-    qDebug() << "NetworkManager: Reply finished:" << reply->isFinished();
-    qDebug() << "NetworkManager: Reply error code:" << reply->error();
-    qDebug() << "NetworkManager: Reply error string:" << reply->errorString();
-
-    // Get HTTP status code
-    int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    qDebug() << "NetworkManager: HTTP status code:" << httpStatus;
-
-    // Read all response data
-    QByteArray responseData = reply->readAll();
-    qDebug() << "NetworkManager: Response data size:" << responseData.size();
-    qDebug() << "NetworkManager: Response data:" << responseData;
+    NetworkCommand command;
+    command.url = url;
+    command.data = data;
+    command.contentType = contentType;
+    command.requester = requester;
+    enqueue(std::move(command));
+}
 
-    // Check if this reply is still in our pending requests
-    if (!m_pendingRequests.contains(reply)) {
-        qDebug() << "NetworkManager: Reply not in pending requests (likely timed out)";
-        reply->deleteLater();
+void NetworkManager::sendCommand(const QString &url, const RobotProtocol::Command &command,
+                                 QObject *requester, quint64 inputUs, bool overridesStop)
+{
+    NetworkCommand networkCommand;
+    if (!buildCommand(url, command, requester, networkCommand)) {
         return;
     }
+    networkCommand.inputUs = inputUs;
+    networkCommand.preemptible = command.type == RobotProtocol::CommandType::Drive;
+    networkCommand.overridesStop = networkCommand.preemptible && overridesStop;
 
-    // Stop connection timeout timer since we got a response
-    qDebug() << "NetworkManager: Stopping connection timeout timer";
-    m_connectionTimeoutTimer->stop();
-
-    // Get the requester for this reply
-    QObject *requester = m_pendingRequests.take(reply);
-    qDebug() << "NetworkManager: Removed request from pending list. Remaining:" << m_pendingRequests.size();
-
-    bool success = (reply->error() == QNetworkReply::NoError);
-    QString errorString;
-
-    if (!success) {
-        errorString = reply->errorString();
-        qDebug() << "NetworkManager: Request FAILED:" << errorString;
-        updateConnectionStatus(false);
-    } else {
-        qDebug() << "NetworkManager: Request SUCCESS";
-        updateConnectionStatus(true);
-    }
-
-    // Notify the requester if specified
-    if (requester) {
-        qDebug() << "NetworkManager: Emitting requestFinished for requester - success:" << success;
-        emit requestFinished(requester, success, errorString);
-    }
-
-    // Restart timeout timer if there are still pending requests
-    if (!m_pendingRequests.isEmpty()) {
-        qDebug() << "NetworkManager: Restarting timeout timer for remaining" << m_pendingRequests.size() << "requests";
-        m_connectionTimeoutTimer->start();
-    }
-
-    reply->deleteLater();
-    qDebug() << "NetworkManager: handleReplyFinished() completed";
+    enqueue(std::move(networkCommand));
 }
 
-// In NetworkManager.cpp, modify the onNetworkReply method:
-
-void NetworkManager::onNetworkReply()
+void NetworkManager::sendStop(const QString &url, QObject *requester)
 {
-    qDebug() << "NetworkManager: onNetworkReply() called - ENTRY POINT";
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) {
-        qDebug() << "NetworkManager: ERROR - No reply object in onNetworkReply()";
+    NetworkCommand networkCommand;
+    if (!buildCommand(url, RobotProtocol::Command::stop(), requester, networkCommand)) {
         return;
     }
 
-    qDebug() << "NetworkManager: Processing reply for" << reply->url();
-    qDebug() << "NetworkManager: Reply finished:" << reply->isFinished();
-    qDebug() << "NetworkManager: Reply running:" << reply->isRunning();
-    qDebug() << "NetworkManager: Reply error code:" << reply->error();
-    qDebug() << "NetworkManager: Reply error string:" << reply->errorString();
-
-    // Get HTTP status code
-    int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    qDebug() << "NetworkManager: HTTP status code:" << httpStatus;
-
-    // Read all response data
-    QByteArray responseData = reply->readAll();
-    qDebug() << "NetworkManager: Response data size:" << responseData.size();
-    qDebug() << "NetworkManager: Response data:" << responseData;
-
-    // Check if this reply is still in our pending requests
-    if (!m_pendingRequests.contains(reply)) {
-        qDebug() << "NetworkManager: Reply not in pending requests (likely timed out)";
-        reply->deleteLater();
-        return;
+    {
+        QMutexLocker locker(&m_stopMailbox.mutex);
+        // Only the newest stop matters; an undelivered one is simply replaced
+        m_stopMailbox.command = std::move(networkCommand);
+        m_stopMailbox.requestedUs = RobotProtocol::timestampUs();
+        m_stopMailbox.generation++;
+        m_stopMailbox.pending = true;
     }
 
-    // Stop connection timeout timer since we got a response
-    qDebug() << "NetworkManager: Stopping connection timeout timer";
-    m_connectionTimeoutTimer->stop();
+    QMetaObject::invokeMethod(m_worker, &NetworkWorker::sendPendingStop, Qt::QueuedConnection);
+}
 
-    // Get the requester for this reply
-    QObject *requester = m_pendingRequests.take(reply);
-    qDebug() << "NetworkManager: Removed request from pending list. Remaining:" << m_pendingRequests.size();
+bool NetworkManager::buildCommand(const QString &url, const RobotProtocol::Command &command,
+                                  QObject *requester, NetworkCommand &out)
+{
+    if (url.isEmpty()) {
+        qDebug() << "NetworkManager: Empty URL provided";
+        if (requester) {
+            emit requestFinished(requester, false, "Empty URL");
+        }
+        return false;
+    }
 
-    bool success = (reply->error() == QNetworkReply::NoError);
-    QString errorString;
+    out.url = url;
+    out.requester = requester;
 
-    if (!success) {
-        errorString = reply->errorString();
-        qDebug() << "NetworkManager: Request FAILED:" << errorString;
-        updateConnectionStatus(false);
+    if (m_binaryCommands) {
+        out.binary = true;
+        out.command = command;
     } else {
-        qDebug() << "NetworkManager: Request SUCCESS";
-        qDebug() << "NetworkManager: Response content type:"
-                 << reply->header(QNetworkRequest::ContentTypeHeader).toString();
-        updateConnectionStatus(true);
+        out.data = RobotProtocol::formatLegacy(command);
+        out.contentType = QStringLiteral("application/x-www-form-urlencoded");
     }
+    return true;
+}
 
-    // Notify the requester if specified
-    if (requester) {
-        qDebug() << "NetworkManager: Emitting requestFinished for requester - success:" << success;
-        emit requestFinished(requester, success, errorString);
-    } else {
-        qDebug() << "NetworkManager: No requester to notify";
+void NetworkManager::setBinaryCommands(bool binary)
+{
+    if (m_binaryCommands != binary) {
+        m_binaryCommands = binary;
+        emit binaryCommandsChanged();
     }
+}
 
-    // Restart timeout timer if there are still pending requests
-    if (!m_pendingRequests.isEmpty()) {
-        qDebug() << "NetworkManager: Restarting timeout timer for remaining" << m_pendingRequests.size() << "requests";
-        m_connectionTimeoutTimer->start();
-    } else {
-        qDebug() << "NetworkManager: No more pending requests";
-    }
+void NetworkManager::setDeadmanHeartbeat(bool enabled)
+{
+    if (m_deadmanHeartbeat != enabled) {
+        m_deadmanHeartbeat = enabled;
+        emit deadmanHeartbeatChanged();
 
-    reply->deleteLater();
-    qDebug() << "NetworkManager: onNetworkReply() completed";
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker, enabled]() {
+            worker->setHeartbeatEnabled(enabled);
+        }, Qt::QueuedConnection);
+    }
 }
 
-void NetworkManager::onConnectionTimeout()
+void NetworkManager::enqueue(NetworkCommand &&command)
 {
-    qDebug() << "NetworkManager: Connection timeout - clearing" << m_pendingRequests.size() << "pending requests";
-    updateConnectionStatus(false);
-
-    // Notify all requesters about the timeout and clear pending requests
-    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end(); ++it) {
-        QObject *requester = it.value();
+    QObject *requester = command.requester;
+    // Only this thread changes the generation, so no lock is needed to read it
+    command.stopGeneration = m_stopMailbox.generation;
+    if (!m_queue.push(std::move(command))) {
+        qDebug() << "NetworkManager: Send queue full, dropping request";
         if (requester) {
-            emit requestFinished(requester, false, "Connection timeout");
+            emit requestFinished(requester, false, "Send queue full");
         }
+        return;
     }
 
-    // Clear all pending requests - this is crucial!
-    m_pendingRequests.clear();
-
-    // Don't restart the timer since we have no pending requests
+    // Wake the worker once per batch of queued commands
+    if (!m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(m_worker, &NetworkWorker::drainQueue, Qt::QueuedConnection);
+    }
 }
 
-void NetworkManager::updateConnectionStatus(bool connected)
+void NetworkManager::onWorkerConnectionStatus(bool connected)
 {
     if (m_isConnected != connected) {
         m_isConnected = connected;
@@ -228,3 +208,15 @@ void NetworkManager::updateConnectionStatus(bool connected)
         qDebug() << "NetworkManager: Connection status changed to" << (connected ? "connected" : "disconnected");
     }
 }
+
+void NetworkManager::onWorkerStats(const NetworkStats &stats)
+{
+    m_stats = stats;
+    emit connectionStatsChanged();
+}
+
+void NetworkManager::onWorkerLinkQuality(const LinkQualitySnapshot &snapshot)
+{
+    m_linkQuality = snapshot;
+    emit linkQualityChanged();
+}
@@ -2,56 +2,148 @@
 #define NETWORKMANAGER_H
 
 #include <QObject>
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
-#include <QTimer>
+#include <QThread>
 #include <QUrl>
-#include <QHash>
+#include <atomic>
+#include "NetworkWorker.h"
 
+// GUI-thread facade for control networking. Requests are pushed onto a
+// lock-free queue and sent by a NetworkWorker on a dedicated I/O thread;
+// results and status come back through queued signals.
 class NetworkManager : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool isConnected READ isConnected NOTIFY connectionStatusChanged)
+    Q_PROPERTY(QString hostUrl READ hostUrl WRITE setHostUrl NOTIFY hostUrlChanged)
+    Q_PROPERTY(bool connectionWarm READ connectionWarm NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int connectionsOpened READ connectionsOpened NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int requestsSent READ requestsSent NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int warmRequests READ warmRequests NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int probesSent READ probesSent NOTIFY connectionStatsChanged)
+    Q_PROPERTY(double inputLatency READ inputLatency NOTIFY connectionStatsChanged)             // ms, input read to command sent
+    Q_PROPERTY(double inputLatencyJitter READ inputLatencyJitter NOTIFY connectionStatsChanged) // ms
+    Q_PROPERTY(double inputLatencyMax READ inputLatencyMax NOTIFY connectionStatsChanged)       // ms
+    Q_PROPERTY(int stopsAcknowledged READ stopsAcknowledged NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int stopRetries READ stopRetries NOTIFY connectionStatsChanged)
+    Q_PROPERTY(int preemptedCommands READ preemptedCommands NOTIFY connectionStatsChanged)
+    Q_PROPERTY(double stopLatency READ stopLatency NOTIFY connectionStatsChanged)       // ms, stop request to acknowledgement
+    Q_PROPERTY(double stopLatencyMax READ stopLatencyMax NOTIFY connectionStatsChanged) // ms
+    Q_PROPERTY(int linkQuality READ linkQuality NOTIFY linkQualityChanged)
+    Q_PROPERTY(double rttMs READ rttMs NOTIFY linkQualityChanged)
+    Q_PROPERTY(double jitterMs READ jitterMs NOTIFY linkQualityChanged)
+    Q_PROPERTY(double packetLoss READ packetLoss NOTIFY linkQualityChanged)
+    Q_PROPERTY(bool binaryCommands READ binaryCommands WRITE setBinaryCommands NOTIFY binaryCommandsChanged)
+    Q_PROPERTY(bool deadmanHeartbeat READ deadmanHeartbeat WRITE setDeadmanHeartbeat NOTIFY deadmanHeartbeatChanged)
 
 public:
     static NetworkManager* instance();
 
-    // Network request methods
+    // Network request methods. Never blocks; the request is queued for the
+    // network thread.
     void sendPostRequest(const QString &url, const QByteArray &data,
                          const QString &contentType = "application/x-www-form-urlencoded",
                          QObject *requester = nullptr);
 
+    // Sends a drive, stop or servo command in the configured wire format.
+    // inputUs is when the input that produced it was read, for latency stats.
+    // overridesStop marks a drive command that comes from input given after
+    // the last emergency stop.
+    void sendCommand(const QString &url, const RobotProtocol::Command &command,
+                     QObject *requester = nullptr, quint64 inputUs = 0, bool overridesStop = false);
+
+    // Emergency stop. Skips the command queue, discards drive commands still
+    // waiting in it and is retried until the robot acknowledges it. Only a
+    // drive command sent with overridesStop cancels the retries; others are
+    // dropped until the stop is acknowledged.
+    void sendStop(const QString &url, QObject *requester = nullptr);
+
     bool isConnected() const { return m_isConnected; }
 
+    // Send commands as sequenced binary packets instead of the legacy form
+    // bodies. Off by default; requires firmware that understands the format.
+    bool binaryCommands() const { return m_binaryCommands; }
+    void setBinaryCommands(bool binary);
+
+    // Heartbeat on /heartbeat at a fixed rate, for a dead-man timer on the
+    // robot that stops the motors when it goes missing. Off by default;
+    // requires firmware that serves the endpoint.
+    bool deadmanHeartbeat() const { return m_deadmanHeartbeat; }
+    void setDeadmanHeartbeat(bool enabled);
+
+    // Robot host that is pre-connected and kept alive. Only scheme, host and
+    // port are used; any path is ignored so controllers can pass endpoint URLs.
+    QString hostUrl() const { return m_hostUrl.toString(); }
+    void setHostUrl(const QString &url);
+
+    // Connection reuse statistics
+    bool connectionWarm() const { return m_stats.connectionWarm; }
+    int connectionsOpened() const { return m_stats.connectionsOpened; }
+    int requestsSent() const { return m_stats.requestsSent; }
+    int warmRequests() const { return m_stats.warmRequests; }
+    int probesSent() const { return m_stats.probesSent; }
+    double inputLatency() const { return m_stats.inputLatencyMs; }
+    double inputLatencyJitter() const { return m_stats.inputLatencyJitterMs; }
+    double inputLatencyMax() const { return m_stats.inputLatencyMaxMs; }
+    int stopsAcknowledged() const { return m_stats.stopsAcknowledged; }
+    int stopRetries() const { return m_stats.stopRetries; }
+    int preemptedCommands() const { return m_stats.preemptedCommands; }
+    double stopLatency() const { return m_stats.stopLatencyMs; }
+    double stopLatencyMax() const { return m_stats.stopLatencyMaxMs; }
+
+    // Link quality, estimated from probe and command round trips
+    int linkQuality() const { return m_linkQuality.score; }
+    bool linkMeasured() const { return m_linkQuality.hasSamples; }
+    double rttMs() const { return m_linkQuality.rttMs; }
+    double jitterMs() const { return m_linkQuality.jitterMs; }
+    double packetLoss() const { return m_linkQuality.lossRate * 100.0; }
+    int recommendedSendInterval() const { return m_linkQuality.sendInterval; }
+    int recommendedSpeedStep() const { return m_linkQuality.speedStep; }
+
+public slots:
+    void prewarmConnection();
+
 signals:
     void connectionStatusChanged();
+    void hostUrlChanged();
+    void connectionStatsChanged();
+    void linkQualityChanged();
+    void binaryCommandsChanged();
+    void deadmanHeartbeatChanged();
     void requestFinished(QObject *requester, bool success, const QString &errorString = QString());
 
 private slots:
-    void onNetworkReply();
-    void onConnectionTimeout();
-    void handleReplyFinished(QNetworkReply* reply);
+    void onWorkerConnectionStatus(bool connected);
+    void onWorkerStats(const NetworkStats &stats);
+    void onWorkerLinkQuality(const LinkQualitySnapshot &snapshot);
+    void shutdown();
 
 private:
     explicit NetworkManager(QObject *parent = nullptr);
+
+    void enqueue(NetworkCommand &&command);
+    bool buildCommand(const QString &url, const RobotProtocol::Command &command,
+                      QObject *requester, NetworkCommand &out);
     ~NetworkManager() = default;
 
     // Singleton - prevent copying
     NetworkManager(const NetworkManager&) = delete;
     NetworkManager& operator=(const NetworkManager&) = delete;
 
-    void updateConnectionStatus(bool connected);
-
     static NetworkManager* s_instance;
-    QNetworkAccessManager *m_networkManager;
-    QTimer *m_connectionTimeoutTimer;
-    bool m_isConnected;
 
-    // Track pending requests and their requesters
-    QHash<QNetworkReply*, QObject*> m_pendingRequests;
+    QThread *m_thread;
+    NetworkWorker *m_worker;
+    NetworkWorker::CommandQueue m_queue;
+    std::atomic<bool> m_drainScheduled;
+    StopMailbox m_stopMailbox;
+    bool m_binaryCommands;
+    bool m_deadmanHeartbeat;
 
-    static const int CONNECTION_TIMEOUT = 5000; // ms - increased from 3000 to 5000 for better reliability
+    // Last state published by the worker
+    bool m_isConnected;
+    QUrl m_hostUrl;
+    NetworkStats m_stats;
+    LinkQualitySnapshot m_linkQuality;
 };
 
 #endif // NETWORKMANAGER_H
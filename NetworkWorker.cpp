@@ -0,0 +1,536 @@
+#include "NetworkWorker.h"
+#include <QDebug>
+
+NetworkWorker::NetworkWorker(CommandQueue *queue, std::atomic<bool> *drainScheduled, StopMailbox *stopMailbox,
+                             QObject *parent)
+    : QObject(parent)
+    , m_queue(queue)
+    , m_drainScheduled(drainScheduled)
+    , m_stopMailbox(stopMailbox)
+    , m_networkManager(nullptr)
+    , m_connectionTimeoutTimer(nullptr)
+    , m_isConnected(false)
+    , m_keepAliveTimer(nullptr)
+    , m_reconnectTimer(nullptr)
+    , m_probeReply(nullptr)
+    , m_probeSentAt(0)
+    , m_stopGeneration(0)
+    , m_stopActive(false)
+    , m_stopRequestedUs(0)
+    , m_stopSentAt(0)
+    , m_stopFailures(0)
+    , m_stopReply(nullptr)
+    , m_stopRetryTimer(nullptr)
+    , m_heartbeatTimer(nullptr)
+    , m_heartbeatReply(nullptr)
+    , m_nextSequence(1)
+{
+}
+
+void NetworkWorker::initialize()
+{
+    // Created here rather than in the constructor so that they belong to
+    // the worker thread
+    m_networkManager = new QNetworkAccessManager(this);
+    m_connectionTimeoutTimer = new QTimer(this);
+    m_keepAliveTimer = new QTimer(this);
+    m_reconnectTimer = new QTimer(this);
+    m_stopRetryTimer = new QTimer(this);
+    m_heartbeatTimer = new QTimer(this);
+
+    m_clock.start();
+
+    // Setup connection timeout timer
+    m_connectionTimeoutTimer->setSingleShot(true);
+    m_connectionTimeoutTimer->setInterval(CONNECTION_TIMEOUT);
+    connect(m_connectionTimeoutTimer, &QTimer::timeout, this, &NetworkWorker::onConnectionTimeout);
+
+    // Probe the robot whenever the link has been idle, so the keep-alive
+    // connection is not closed by the robot's HTTP server
+    m_keepAliveTimer->setInterval(KEEPALIVE_INTERVAL);
+    connect(m_keepAliveTimer, &QTimer::timeout, this, &NetworkWorker::sendKeepAliveProbe);
+
+    m_reconnectTimer->setSingleShot(true);
+    m_reconnectTimer->setInterval(RECONNECT_INTERVAL);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &NetworkWorker::prewarmConnection);
+
+    m_stopRetryTimer->setSingleShot(true);
+    m_stopRetryTimer->setInterval(STOP_RETRY_INTERVAL);
+    connect(m_stopRetryTimer, &QTimer::timeout, this, &NetworkWorker::sendStopAttempt);
+
+    // The robot's dead-man timer measures the gaps, so keep them even
+    m_heartbeatTimer->setTimerType(Qt::PreciseTimer);
+    m_heartbeatTimer->setInterval(HEARTBEAT_INTERVAL);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &NetworkWorker::sendHeartbeat);
+
+    publishLinkQuality();
+}
+
+void NetworkWorker::drainQueue()
+{
+    // Clear the flag first so commands pushed while draining schedule
+    // another pass instead of being left in the queue
+    m_drainScheduled->store(false, std::memory_order_release);
+
+    // A stop requested after this drain was scheduled still goes first
+    sendPendingStop();
+
+    bool preempted = false;
+
+    NetworkCommand command;
+    while (m_queue->pop(command)) {
+        if (command.preemptible) {
+            // Queued after a stop that hasn't been picked up yet
+            if (static_cast<qint32>(command.stopGeneration - m_stopGeneration) > 0) {
+                sendPendingStop();
+            }
+            if (static_cast<qint32>(command.stopGeneration - m_stopGeneration) < 0) {
+                // Queued before the latest stop; sending it would undo the stop
+                m_stats.preemptedCommands++;
+                preempted = true;
+                continue;
+            }
+            if (m_stopActive) {
+                if (!command.overridesStop) {
+                    // Nothing new from the user; the stop stands until acknowledged
+                    m_stats.preemptedCommands++;
+                    preempted = true;
+                    continue;
+                }
+                // Driving again after the stop; don't let a retry stop the robot
+                abandonStop();
+            }
+        }
+        sendPostRequest(command);
+    }
+
+    if (preempted) {
+        emit connectionStatsChanged(m_stats);
+    }
+}
+
+void NetworkWorker::sendPendingStop()
+{
+    NetworkCommand command;
+    quint64 requestedUs;
+    {
+        QMutexLocker locker(&m_stopMailbox->mutex);
+        if (!m_stopMailbox->pending) {
+            return;
+        }
+        command = std::move(m_stopMailbox->command);
+        requestedUs = m_stopMailbox->requestedUs;
+        m_stopGeneration = m_stopMailbox->generation;
+        m_stopMailbox->pending = false;
+    }
+
+    // Latency runs from the first stop the robot hasn't acknowledged yet
+    if (!m_stopActive) {
+        m_stopRequestedUs = requestedUs;
+        m_stopFailures = 0;
+    }
+    m_stopCommand = std::move(command);
+    m_stopActive = true;
+
+    // Don't wait for an attempt that's already in flight
+    m_stopRetryTimer->stop();
+    sendStopAttempt();
+}
+
+void NetworkWorker::sendStopAttempt()
+{
+    if (!m_stopActive) {
+        return;
+    }
+
+    QNetworkRequest request{QUrl(m_stopCommand.url)};
+    // Ahead of any other request waiting for a connection
+    request.setPriority(QNetworkRequest::HighPriority);
+    request.setTransferTimeout(STOP_ACK_TIMEOUT);
+
+    QNetworkReply *reply;
+    if (m_stopCommand.binary) {
+        // Every attempt gets a fresh sequence number, so drive commands still
+        // in flight are rejected as stale if they arrive after the stop
+        RobotProtocol::Packet packet;
+        RobotProtocol::encode(m_stopCommand.command, m_nextSequence++, RobotProtocol::timestampUs(), packet);
+
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/octet-stream"));
+        reply = m_networkManager->post(request, QByteArray(packet.data(), static_cast<qsizetype>(packet.size())));
+    } else {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, m_stopCommand.contentType);
+        reply = m_networkManager->post(request, m_stopCommand.data);
+    }
+
+    // An older attempt may still answer; only the newest one counts
+    m_stopReply = reply;
+    m_stopSentAt = m_clock.elapsed();
+    m_stats.requestsSent++;
+    emit connectionStatsChanged(m_stats);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        this->handleStopFinished(reply);
+    });
+
+    qDebug() << "NetworkWorker: Sending emergency stop to" << m_stopCommand.url;
+}
+
+void NetworkWorker::handleStopFinished(QNetworkReply* reply)
+{
+    reply->readAll();
+    reply->deleteLater();
+
+    if (reply != m_stopReply) {
+        return;
+    }
+    m_stopReply = nullptr;
+
+    if (reply->error() == QNetworkReply::NoError) {
+        const double latencyMs = (RobotProtocol::timestampUs() - m_stopRequestedUs) / 1000.0;
+        m_stopLatency.add(latencyMs);
+        m_stopActive = false;
+
+        m_stats.stopsAcknowledged++;
+        m_stats.stopLatencyMs = latencyMs;
+        m_stats.stopLatencyMaxMs = m_stopLatency.max();
+        emit connectionStatsChanged(m_stats);
+
+        recordRoundTrip(m_stopSentAt);
+        updateConnectionStatus(true);
+        setConnectionWarm(true);
+
+        qDebug() << "NetworkWorker: Emergency stop acknowledged after" << latencyMs << "ms";
+        if (m_stopCommand.requester) {
+            emit requestFinished(m_stopCommand.requester, true, QString());
+        }
+        return;
+    }
+
+    qDebug() << "NetworkWorker: Emergency stop attempt failed:" << reply->errorString() << "- retrying";
+    m_stats.stopRetries++;
+    emit connectionStatsChanged(m_stats);
+    recordLoss();
+
+    // Report the first failure only; the retries carry on regardless
+    if (m_stopFailures++ == 0 && m_stopCommand.requester) {
+        emit requestFinished(m_stopCommand.requester, false, reply->errorString());
+    }
+    m_stopRetryTimer->start();
+}
+
+void NetworkWorker::abandonStop()
+{
+    qDebug() << "NetworkWorker: Emergency stop superseded by a new drive command";
+    m_stopActive = false;
+    m_stopRetryTimer->stop();
+
+    if (m_stopReply) {
+        QNetworkReply *reply = m_stopReply;
+        m_stopReply = nullptr;
+        reply->abort();
+    }
+}
+
+void NetworkWorker::setHeartbeatEnabled(bool enabled)
+{
+    if (enabled) {
+        m_heartbeatTimer->start();
+    } else {
+        m_heartbeatTimer->stop();
+    }
+}
+
+void NetworkWorker::sendHeartbeat()
+{
+    // A heartbeat stuck behind a stalled connection must not be followed by
+    // a queue of late ones; the robot is meant to notice the gap
+    if (m_hostUrl.isEmpty() || m_heartbeatReply) {
+        return;
+    }
+
+    QUrl url(m_hostUrl);
+    url.setPath(QStringLiteral("/heartbeat"));
+
+    QNetworkRequest request(url);
+    request.setTransferTimeout(HEARTBEAT_INTERVAL * 2);
+
+    m_heartbeatReply = m_networkManager->get(request);
+    m_stats.heartbeatsSent++;
+
+    // Heartbeats keep the connection alive too
+    if (m_keepAliveTimer->isActive()) {
+        m_keepAliveTimer->start();
+    }
+
+    QNetworkReply *reply = m_heartbeatReply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        if (reply == m_heartbeatReply) {
+            m_heartbeatReply = nullptr;
+        }
+        reply->readAll();
+        reply->deleteLater();
+    });
+}
+
+void NetworkWorker::setHostUrl(const QUrl &url)
+{
+    if (m_hostUrl != url) {
+        m_hostUrl = url;
+
+        // The old keep-alive connection belongs to a different host
+        setConnectionWarm(false);
+        prewarmConnection();
+    }
+}
+
+void NetworkWorker::prewarmConnection()
+{
+    if (m_hostUrl.isEmpty()) {
+        return;
+    }
+
+    m_reconnectTimer->stop();
+
+    // Open the TCP connection ahead of the first command, then confirm it
+    // with a probe so the connection is known to be usable
+    if (m_hostUrl.scheme() == QLatin1String("https")) {
+        m_networkManager->connectToHostEncrypted(m_hostUrl.host(), m_hostUrl.port(443));
+    } else {
+        m_networkManager->connectToHost(m_hostUrl.host(), m_hostUrl.port(80));
+    }
+    m_stats.connectionsOpened++;
+    emit connectionStatsChanged(m_stats);
+
+    qDebug() << "NetworkWorker: Pre-connecting to" << m_hostUrl.toString();
+
+    sendKeepAliveProbe();
+    m_keepAliveTimer->start();
+}
+
+void NetworkWorker::sendKeepAliveProbe()
+{
+    if (m_hostUrl.isEmpty() || m_probeReply) {
+        return;
+    }
+
+    QNetworkRequest request(m_hostUrl);
+    request.setRawHeader("Connection", "keep-alive");
+    request.setTransferTimeout(CONNECTION_TIMEOUT);
+
+    m_probeReply = m_networkManager->head(request);
+    m_probeSentAt = m_clock.elapsed();
+    m_stats.probesSent++;
+    emit connectionStatsChanged(m_stats);
+
+    QNetworkReply *reply = m_probeReply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        this->handleProbeFinished(reply);
+    });
+}
+
+void NetworkWorker::handleProbeFinished(QNetworkReply* reply)
+{
+    if (reply == m_probeReply) {
+        m_probeReply = nullptr;
+    }
+
+    // Any HTTP response, even 404, proves the connection is alive
+    bool gotResponse = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid();
+    if (gotResponse) {
+        recordRoundTrip(m_probeSentAt);
+        setConnectionWarm(true);
+        updateConnectionStatus(true);
+    } else {
+        qDebug() << "NetworkWorker: Keep-alive probe failed:" << reply->errorString();
+        recordLoss();
+        setConnectionWarm(false);
+        updateConnectionStatus(false);
+        scheduleReconnect();
+    }
+
+    reply->deleteLater();
+}
+
+void NetworkWorker::sendPostRequest(const NetworkCommand &command)
+{
+    QNetworkRequest request{QUrl(command.url)};
+    QNetworkReply *reply;
+
+    if (command.binary) {
+        // Stamp as late as possible so the robot sees the true send time
+        RobotProtocol::Packet packet;
+        RobotProtocol::encode(command.command, m_nextSequence++, RobotProtocol::timestampUs(), packet);
+
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/octet-stream"));
+        reply = m_networkManager->post(request, QByteArray(packet.data(), static_cast<qsizetype>(packet.size())));
+    } else {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, command.contentType);
+        reply = m_networkManager->post(request, command.data);
+    }
+
+    m_requestSentAt[reply] = m_clock.elapsed();
+
+    if (command.inputUs != 0) {
+        m_inputLatency.add((RobotProtocol::timestampUs() - command.inputUs) / 1000.0);
+        m_stats.inputLatencyMs = m_inputLatency.mean();
+        m_stats.inputLatencyJitterMs = m_inputLatency.stddev();
+        m_stats.inputLatencyMaxMs = m_inputLatency.max();
+    }
+
+    m_stats.requestsSent++;
+    if (m_stats.connectionWarm) {
+        m_stats.warmRequests++;
+    }
+    emit connectionStatsChanged(m_stats);
+
+    // Real traffic keeps the connection alive, so postpone the next probe
+    if (m_keepAliveTimer->isActive()) {
+        m_keepAliveTimer->start();
+    }
+
+    // Track the request and its requester
+    if (command.requester) {
+        m_pendingRequests[reply] = command.requester;
+    }
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        this->handleReplyFinished(reply);
+    });
+
+    // Start/restart connection timeout timer only if we have pending requests
+    if (!m_pendingRequests.isEmpty()) {
+        m_connectionTimeoutTimer->start();
+    }
+
+    qDebug() << "NetworkWorker: Sending POST request to" << command.url << "with data:"
+             << (command.binary ? RobotProtocol::describe(command.command).toUtf8() : command.data);
+}
+
+void NetworkWorker::handleReplyFinished(QNetworkReply* reply)
+{
+    if (!reply) {
+        qDebug() << "NetworkWorker: ERROR - No reply object in handleReplyFinished()";
+        return;
+    }
+
+    qDebug() << "NetworkWorker: Reply for" << reply->url()
+             << "HTTP status:" << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()
+             << "error:" << reply->error();
+
+    // Drain the response body so the connection can be reused
+    reply->readAll();
+
+    // Check if this reply is still in our pending requests
+    if (!m_pendingRequests.contains(reply)) {
+        qDebug() << "NetworkWorker: Reply not in pending requests (likely timed out)";
+        m_requestSentAt.remove(reply);
+        reply->deleteLater();
+        return;
+    }
+
+    // Stop connection timeout timer since we got a response
+    m_connectionTimeoutTimer->stop();
+
+    // Get the requester for this reply
+    QObject *requester = m_pendingRequests.take(reply);
+    qint64 sentAt = m_requestSentAt.take(reply);
+
+    bool success = (reply->error() == QNetworkReply::NoError);
+    QString errorString;
+
+    if (!success) {
+        errorString = reply->errorString();
+        qDebug() << "NetworkWorker: Request FAILED:" << errorString;
+        recordLoss();
+        updateConnectionStatus(false);
+        setConnectionWarm(false);
+        scheduleReconnect();
+    } else {
+        recordRoundTrip(sentAt);
+        updateConnectionStatus(true);
+        setConnectionWarm(true);
+    }
+
+    // Notify the requester if specified
+    if (requester) {
+        emit requestFinished(requester, success, errorString);
+    }
+
+    // Restart timeout timer if there are still pending requests
+    if (!m_pendingRequests.isEmpty()) {
+        m_connectionTimeoutTimer->start();
+    }
+
+    reply->deleteLater();
+}
+
+void NetworkWorker::onConnectionTimeout()
+{
+    qDebug() << "NetworkWorker: Connection timeout - clearing" << m_pendingRequests.size() << "pending requests";
+    updateConnectionStatus(false);
+    setConnectionWarm(false);
+    scheduleReconnect();
+
+    // Notify all requesters about the timeout and clear pending requests
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end(); ++it) {
+        m_linkQuality.addLoss();
+        QObject *requester = it.value();
+        if (requester) {
+            emit requestFinished(requester, false, "Connection timeout");
+        }
+    }
+
+    // Clear all pending requests - this is crucial!
+    m_pendingRequests.clear();
+    m_requestSentAt.clear();
+    publishLinkQuality();
+}
+
+void NetworkWorker::updateConnectionStatus(bool connected)
+{
+    if (m_isConnected != connected) {
+        m_isConnected = connected;
+        emit connectionStatusChanged(connected);
+        qDebug() << "NetworkWorker: Connection status changed to" << (connected ? "connected" : "disconnected");
+    }
+}
+
+void NetworkWorker::setConnectionWarm(bool warm)
+{
+    if (m_stats.connectionWarm != warm) {
+        m_stats.connectionWarm = warm;
+        emit connectionStatsChanged(m_stats);
+    }
+}
+
+void NetworkWorker::scheduleReconnect()
+{
+    if (!m_hostUrl.isEmpty() && !m_reconnectTimer->isActive()) {
+        m_reconnectTimer->start();
+    }
+}
+
+void NetworkWorker::recordRoundTrip(qint64 sentAt)
+{
+    m_linkQuality.addRttSample(static_cast<double>(m_clock.elapsed() - sentAt));
+    publishLinkQuality();
+}
+
+void NetworkWorker::recordLoss()
+{
+    m_linkQuality.addLoss();
+    publishLinkQuality();
+}
+
+void NetworkWorker::publishLinkQuality()
+{
+    LinkQualitySnapshot snapshot;
+    snapshot.score = m_linkQuality.score();
+    snapshot.hasSamples = m_linkQuality.hasSamples();
+    snapshot.rttMs = m_linkQuality.rttMs();
+    snapshot.jitterMs = m_linkQuality.jitterMs();
+    snapshot.lossRate = m_linkQuality.lossRate();
+    snapshot.sendInterval = m_linkQuality.recommendedSendInterval();
+    snapshot.speedStep = m_linkQuality.recommendedSpeedStep();
+    emit linkQualityChanged(snapshot);
+}
@@ -0,0 +1,185 @@
+#ifndef NETWORKWORKER_H
+#define NETWORKWORKER_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrl>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <atomic>
+#include "LinkQualityEstimator.h"
+#include "LockFreeQueue.h"
+#include "RobotProtocol.h"
+#include "RollingStats.h"
+
+// A control request handed from the GUI thread to the network thread.
+// Binary commands carry the command itself and are sequenced, timestamped
+// and encoded by the worker at send time.
+struct NetworkCommand {
+    QString url;
+    QByteArray data;
+    QString contentType;
+    QObject *requester = nullptr;
+    bool binary = false;
+    RobotProtocol::Command command;
+    quint64 inputUs = 0; // When the input behind this command was read; 0 if unknown
+    bool preemptible = false;   // Drive command that a later stop makes obsolete
+    bool overridesStop = false; // Driven by input given after the last stop
+    quint32 stopGeneration = 0; // Stops requested before this command was queued
+};
+
+// Single-slot mailbox for emergency stops. Stops bypass the command queue so
+// they never wait behind drive commands; every stop bumps the generation, and
+// the worker discards drive commands stamped with an older one. Only the GUI
+// thread writes, always under the mutex.
+struct StopMailbox {
+    QMutex mutex;
+    NetworkCommand command;
+    quint64 requestedUs = 0;
+    quint32 generation = 0;
+    bool pending = false;
+};
+
+// Connection reuse statistics
+struct NetworkStats {
+    bool connectionWarm = false;
+    int connectionsOpened = 0;
+    int requestsSent = 0;
+    int warmRequests = 0;
+    int probesSent = 0;
+
+    // From reading a hardware input to posting the command it produced
+    double inputLatencyMs = 0.0;
+    double inputLatencyJitterMs = 0.0;
+    double inputLatencyMaxMs = 0.0;
+
+    // Emergency stops, from the stop request to the robot's acknowledgement
+    int stopsAcknowledged = 0;
+    int stopRetries = 0;
+    int preemptedCommands = 0;
+    double stopLatencyMs = 0.0;
+    double stopLatencyMaxMs = 0.0;
+
+    int heartbeatsSent = 0;
+};
+
+// Link quality as published to the GUI thread
+struct LinkQualitySnapshot {
+    int score = 0;
+    bool hasSamples = false; // Nothing measured yet; the score means nothing
+    double rttMs = 0.0;
+    double jitterMs = 0.0;
+    double lossRate = 0.0;
+    int sendInterval = 0;
+    int speedStep = 1;
+};
+
+Q_DECLARE_METATYPE(NetworkStats)
+Q_DECLARE_METATYPE(LinkQualitySnapshot)
+
+// Owns the QNetworkAccessManager and all control traffic. Lives on
+// NetworkManager's I/O thread so replies and timeouts are handled on time
+// regardless of how busy the GUI thread is.
+class NetworkWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    using CommandQueue = LockFreeQueue<NetworkCommand, 256>;
+
+    NetworkWorker(CommandQueue *queue, std::atomic<bool> *drainScheduled, StopMailbox *stopMailbox,
+                  QObject *parent = nullptr);
+
+public slots:
+    // Must run on the worker thread before anything else
+    void initialize();
+    void drainQueue();
+    void setHostUrl(const QUrl &url);
+    void prewarmConnection();
+    // Sends the stop waiting in the mailbox, if any, and retries it until
+    // the robot acknowledges it
+    void sendPendingStop();
+    // Fixed-rate heartbeat for the robot's dead-man timer
+    void setHeartbeatEnabled(bool enabled);
+
+signals:
+    void requestFinished(QObject *requester, bool success, const QString &errorString);
+    void connectionStatusChanged(bool connected);
+    void connectionStatsChanged(const NetworkStats &stats);
+    void linkQualityChanged(const LinkQualitySnapshot &snapshot);
+
+private slots:
+    void onConnectionTimeout();
+    void handleReplyFinished(QNetworkReply* reply);
+    void sendKeepAliveProbe();
+    void handleProbeFinished(QNetworkReply* reply);
+    void sendStopAttempt();
+    void handleStopFinished(QNetworkReply* reply);
+    void sendHeartbeat();
+
+private:
+    void sendPostRequest(const NetworkCommand &command);
+    void updateConnectionStatus(bool connected);
+    void setConnectionWarm(bool warm);
+    void scheduleReconnect();
+    void recordRoundTrip(qint64 sentAt);
+    void recordLoss();
+    void publishLinkQuality();
+    void abandonStop();
+
+    CommandQueue *m_queue;
+    std::atomic<bool> *m_drainScheduled;
+    StopMailbox *m_stopMailbox;
+
+    QNetworkAccessManager *m_networkManager;
+    QTimer *m_connectionTimeoutTimer;
+    bool m_isConnected;
+
+    // Connection pre-warming and keep-alive
+    QUrl m_hostUrl;
+    QTimer *m_keepAliveTimer;
+    QTimer *m_reconnectTimer;
+    QNetworkReply *m_probeReply;
+    qint64 m_probeSentAt;
+    NetworkStats m_stats;
+    RollingStats m_inputLatency;
+
+    // Emergency stop being delivered; retried until acknowledged
+    NetworkCommand m_stopCommand;
+    quint32 m_stopGeneration; // Of the last stop taken from the mailbox
+    bool m_stopActive;
+    quint64 m_stopRequestedUs;
+    qint64 m_stopSentAt;
+    int m_stopFailures;
+    QNetworkReply *m_stopReply;
+    QTimer *m_stopRetryTimer;
+    RollingStats m_stopLatency;
+
+    // Dead-man heartbeat
+    QTimer *m_heartbeatTimer;
+    QNetworkReply *m_heartbeatReply;
+
+    // Sequence numbers for binary commands, shared by all controllers
+    quint32 m_nextSequence;
+
+    // Link quality estimation
+    QElapsedTimer m_clock;
+    LinkQualityEstimator m_linkQuality;
+
+    // Track pending requests, their requesters and when they were sent
+    QHash<QNetworkReply*, QObject*> m_pendingRequests;
+    QHash<QNetworkReply*, qint64> m_requestSentAt;
+
+    static const int CONNECTION_TIMEOUT = 5000; // ms - increased from 3000 to 5000 for better reliability
+    static const int KEEPALIVE_INTERVAL = 2000; // ms - idle time before a probe is sent
+    static const int RECONNECT_INTERVAL = 1000; // ms
+    static const int STOP_ACK_TIMEOUT = 250;    // ms - a stop attempt without a reply by then is retried
+    static const int STOP_RETRY_INTERVAL = 50;  // ms - pause after a failed stop attempt
+    static const int HEARTBEAT_INTERVAL = 100;  // ms - the robot stops after a few missed heartbeats
+};
+
+#endif // NETWORKWORKER_H
@@ -0,0 +1,175 @@
+#include "PathFollower.h"
+#include <QVariantMap>
+#include <QtMath>
+#include <cmath>
+
+namespace {
+
+double wrapAngle(double angle)
+{
+    return std::remainder(angle, 2.0 * M_PI);
+}
+
+} // namespace
+
+PathFollower::PathFollower()
+    : m_count(0)
+    , m_active(false)
+    , m_segment(0)
+    , m_along(0.0)
+    , m_crossTrack(0.0)
+    , m_mode(PurePursuit)
+    , m_lookahead(40.0)
+    , m_cruiseSpeed(120)
+    , m_stanleyGain(0.05)
+    , m_trackWidth(30.0)
+    , m_goalTolerance(10.0)
+{
+}
+
+bool PathFollower::setRoute(const QVariantList &route)
+{
+    clear();
+
+    int count = 0;
+    for (const QVariant &point : route) {
+        const QVariantMap node = point.toMap();
+        const double x = node.value("x").toDouble();
+        const double y = node.value("y").toDouble();
+
+        // Joined A* legs repeat the node where they meet
+        double distance = 0.0;
+        if (count > 0) {
+            const Waypoint &last = m_waypoints[count - 1];
+            const double step = std::hypot(x - last.x, y - last.y);
+            if (step < 1e-6) {
+                continue;
+            }
+            distance = last.distance + step;
+        }
+
+        if (count == MAX_WAYPOINTS) {
+            return false;
+        }
+        m_waypoints[count++] = Waypoint{x, y, distance};
+    }
+
+    if (count < 2) {
+        return false;
+    }
+
+    m_count = count;
+    m_active = true;
+    return true;
+}
+
+void PathFollower::clear()
+{
+    m_count = 0;
+    m_active = false;
+    m_segment = 0;
+    m_along = 0.0;
+    m_crossTrack = 0.0;
+}
+
+double PathFollower::remainingDistance() const
+{
+    return m_count > 0 ? m_waypoints[m_count - 1].distance - m_along : 0.0;
+}
+
+bool PathFollower::update(const RobotPose &pose, int &speed, int &turn)
+{
+    speed = 0;
+    turn = 0;
+    if (!m_active) {
+        return false;
+    }
+
+    project(pose);
+
+    const Waypoint &goal = m_waypoints[m_count - 1];
+    const double toGoal = std::hypot(goal.x - pose.x, goal.y - pose.y);
+    if (m_segment == m_count - 2 && toGoal <= m_goalTolerance) {
+        m_active = false;
+        return false;
+    }
+
+    // Both modes produce the angle to steer towards, relative to the heading
+    double aim;
+    if (m_mode == Stanley) {
+        const Waypoint &a = m_waypoints[m_segment];
+        const Waypoint &b = m_waypoints[m_segment + 1];
+        const double pathHeading = std::atan2(b.y - a.y, b.x - a.x);
+        // Cruise speed is roughly constant, so the usual speed term of the
+        // cross-track correction is folded into the gain
+        aim = wrapAngle(pathHeading - pose.heading) + std::atan(-m_stanleyGain * m_crossTrack);
+    } else {
+        double targetX, targetY;
+        pointAt(m_along + m_lookahead, targetX, targetY);
+        aim = std::atan2(targetY - pose.y, targetX - pose.x) - pose.heading;
+    }
+    aim = wrapAngle(aim);
+
+    if (std::abs(aim) > TURN_IN_PLACE_ANGLE) {
+        // Far off course; arcing round would swing wide of the route
+        turn = aim > 0 ? TURN_IN_PLACE_SPEED : -TURN_IN_PLACE_SPEED;
+        return true;
+    }
+
+    // Curvature of the arc that reaches the aim point one lookahead away.
+    // The motor mixing drives (1 ± 0.8 * turn / 50) * speed, a curvature of
+    // 1.6 * turn / (50 * trackWidth), which gives the turn command.
+    const double curvature = 2.0 * std::sin(aim) / m_lookahead;
+    const double turnCommand = curvature * m_trackWidth * 50.0 / 1.6;
+    turn = qBound(-50, static_cast<int>(std::lround(turnCommand)), 50);
+
+    // Slow down for sharp turns and over the last stretch to the goal
+    double scale = 1.0 - 0.5 * std::abs(turn) / 50.0;
+    scale *= qMin(1.0, remainingDistance() / (2.0 * m_lookahead));
+    speed = qMax(MIN_DRIVE_SPEED, static_cast<int>(m_cruiseSpeed * scale));
+    return true;
+}
+
+void PathFollower::project(const RobotPose &pose)
+{
+    // Nearest point on the current and the next few segments
+    const int last = qMin(m_segment + SEARCH_SEGMENTS, m_count - 1);
+    double bestDistance = -1.0;
+    for (int i = m_segment; i < last; ++i) {
+        const Waypoint &a = m_waypoints[i];
+        const Waypoint &b = m_waypoints[i + 1];
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double length = b.distance - a.distance;
+
+        const double t = qBound(0.0, ((pose.x - a.x) * dx + (pose.y - a.y) * dy) / (length * length), 1.0);
+        const double offX = pose.x - (a.x + t * dx);
+        const double offY = pose.y - (a.y + t * dy);
+        const double distance = offX * offX + offY * offY;
+
+        if (bestDistance < 0.0 || distance < bestDistance) {
+            bestDistance = distance;
+            m_segment = i;
+            m_along = a.distance + t * length;
+            m_crossTrack = (dx * (pose.y - a.y) - dy * (pose.x - a.x)) / length;
+        }
+    }
+}
+
+void PathFollower::pointAt(double distance, double &x, double &y) const
+{
+    for (int i = m_segment; i < m_count - 1; ++i) {
+        const Waypoint &a = m_waypoints[i];
+        const Waypoint &b = m_waypoints[i + 1];
+        if (distance <= b.distance) {
+            const double t = (distance - a.distance) / (b.distance - a.distance);
+            x = a.x + t * (b.x - a.x);
+            y = a.y + t * (b.y - a.y);
+            return;
+        }
+    }
+
+    // Past the end of the route: aim at the goal
+    x = m_waypoints[m_count - 1].x;
+    y = m_waypoints[m_count - 1].y;
+}
@@ -0,0 +1,86 @@
+#ifndef PATHFOLLOWER_H
+#define PATHFOLLOWER_H
+
+#include <QVariantList>
+#include <array>
+#include "RobotPose.h"
+
+// Steers the robot along a route from PathfindingEngine. update() runs once
+// per control tick on the current pose estimate and returns speed and turn
+// in the units of the manual controls (-255..255, -50..50), so the result
+// goes through CarController's normal motor mixing. Waypoints are copied
+// into a fixed array when the route is set; update() never allocates.
+class PathFollower
+{
+public:
+    enum Mode {
+        PurePursuit, // Aims at the point a lookahead distance along the route
+        Stanley      // Path heading error plus a cross-track correction
+    };
+
+    PathFollower();
+
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode) { m_mode = mode; }
+    double lookahead() const { return m_lookahead; }
+    void setLookahead(double distance) { m_lookahead = qMax(1.0, distance); }
+    int cruiseSpeed() const { return m_cruiseSpeed; }
+    void setCruiseSpeed(int speed) { m_cruiseSpeed = qBound(0, speed, 255); }
+    double stanleyGain() const { return m_stanleyGain; }
+    void setStanleyGain(double gain) { m_stanleyGain = qMax(0.0, gain); }
+    // Wheel track in map units; converts path curvature into a turn command
+    double trackWidth() const { return m_trackWidth; }
+    void setTrackWidth(double width) { m_trackWidth = qMax(1.0, width); }
+    double goalTolerance() const { return m_goalTolerance; }
+    void setGoalTolerance(double distance) { m_goalTolerance = qMax(1.0, distance); }
+
+    // Takes a list of maps with x and y, as returned by PathfindingEngine.
+    // Repeated points are skipped. Returns false if fewer than two distinct
+    // points remain or the route has more than MAX_WAYPOINTS.
+    bool setRoute(const QVariantList &route);
+    void clear();
+
+    bool isActive() const { return m_active; }
+    double crossTrackError() const { return m_crossTrack; } // Positive right of the route
+    double remainingDistance() const;
+
+    // Returns the commands for this tick, or false with both zero once the
+    // goal has been reached or when there is no route
+    bool update(const RobotPose &pose, int &speed, int &turn);
+
+    static const int MAX_WAYPOINTS = 256;
+
+private:
+    struct Waypoint {
+        double x;
+        double y;
+        double distance; // Along the route from the first waypoint
+    };
+
+    void project(const RobotPose &pose);
+    void pointAt(double distance, double &x, double &y) const;
+
+    std::array<Waypoint, MAX_WAYPOINTS> m_waypoints;
+    int m_count;
+    bool m_active;
+
+    // Where the robot is on the route. The segment only moves forward, so a
+    // route that passes the same spot twice is followed in order.
+    int m_segment;
+    double m_along;
+    double m_crossTrack;
+
+    Mode m_mode;
+    double m_lookahead;     // map units
+    int m_cruiseSpeed;
+    double m_stanleyGain;   // per map unit of cross-track error
+    double m_trackWidth;    // map units
+    double m_goalTolerance; // map units
+
+    static const int SEARCH_SEGMENTS = 3;   // Segments ahead searched for the robot's position
+    static const int MIN_DRIVE_SPEED = 20;  // Above the turn-on-spot band of the motor mixing
+    static constexpr double TURN_IN_PLACE_ANGLE = 1.05; // rad, ~60°; turn on the spot beyond this
+    static const int TURN_IN_PLACE_SPEED = 25; // turn units
+};
+
+#endif // PATHFOLLOWER_H
@@ -0,0 +1,130 @@
+#include "PoseEstimator.h"
+#include <QDebug>
+#include "CarController.h"
+
+PoseEstimator::PoseEstimator(QObject *parent)
+    : QObject(parent)
+    , m_thread(new QThread(this))
+    , m_integrator(new PoseIntegrator(&m_commandedSpeeds, &m_encoderQueue, &m_snapshot))
+    , m_commandedSpeeds(PoseIntegrator::packSpeeds(0, 0))
+    , m_usingEncoders(false)
+{
+    m_thread->setObjectName("PoseEstimator");
+    m_integrator->moveToThread(m_thread);
+
+    connect(m_thread, &QThread::started, m_integrator, &PoseIntegrator::start);
+    connect(m_thread, &QThread::finished, m_integrator, &QObject::deleteLater);
+    connect(m_integrator, &PoseIntegrator::poseUpdated, this, &PoseEstimator::onPoseUpdated,
+            Qt::QueuedConnection);
+
+    // Integration steps must not be skipped when the GUI is busy
+    m_thread->start(QThread::HighPriority);
+}
+
+PoseEstimator::~PoseEstimator()
+{
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void PoseEstimator::attach(CarController *car)
+{
+    connect(car, &CarController::commandIssued, this, &PoseEstimator::onCommandIssued);
+    car->setPoseEstimator(this);
+}
+
+void PoseEstimator::setTrackWidth(double width)
+{
+    if (width > 0.0 && m_model.trackWidth != width) {
+        m_model.trackWidth = width;
+        applyModel();
+    }
+}
+
+void PoseEstimator::setSpeedScale(double scale)
+{
+    if (scale > 0.0 && m_model.speedScale != scale) {
+        m_model.speedScale = scale;
+        applyModel();
+    }
+}
+
+void PoseEstimator::setMotorDeadband(int deadband)
+{
+    deadband = qBound(0, deadband, 254);
+    if (m_model.deadband != deadband) {
+        m_model.deadband = deadband;
+        applyModel();
+    }
+}
+
+void PoseEstimator::setMotorResponseTime(int ms)
+{
+    const double timeConstant = qMax(0, ms) / 1000.0;
+    if (m_model.timeConstant != timeConstant) {
+        m_model.timeConstant = timeConstant;
+        applyModel();
+    }
+}
+
+void PoseEstimator::applyModel()
+{
+    emit modelChanged();
+
+    QMetaObject::invokeMethod(m_integrator, [integrator = m_integrator, model = m_model]() {
+        integrator->setModel(model);
+    }, Qt::QueuedConnection);
+}
+
+bool PoseEstimator::currentPose(RobotPose &pose, quint64 &updatedUs) const
+{
+    QMutexLocker locker(&m_snapshot.mutex);
+    pose = m_snapshot.pose;
+    updatedUs = m_snapshot.updatedUs;
+    return m_snapshot.placed;
+}
+
+void PoseEstimator::addWheelTravel(double left, double right)
+{
+    WheelTravel travel;
+    travel.left = left;
+    travel.right = right;
+    if (!m_encoderQueue.push(travel)) {
+        qDebug() << "PoseEstimator: Encoder queue full, dropping wheel travel";
+    }
+}
+
+void PoseEstimator::reset(double x, double y, double heading)
+{
+    RobotPose pose;
+    pose.x = x;
+    pose.y = y;
+    pose.heading = heading;
+
+    qDebug() << "PoseEstimator: Pose reset to" << x << y << "heading" << heading;
+
+    // Shown at once; the integrator carries on from here
+    m_pose = pose;
+    emit poseChanged();
+
+    QMetaObject::invokeMethod(m_integrator, [integrator = m_integrator, pose]() {
+        integrator->reset(pose);
+    }, Qt::QueuedConnection);
+}
+
+void PoseEstimator::onCommandIssued(const RobotProtocol::Command &command)
+{
+    if (command.type == RobotProtocol::CommandType::Drive) {
+        m_commandedSpeeds.store(PoseIntegrator::packSpeeds(command.values[0], command.values[1]),
+                                std::memory_order_relaxed);
+    } else if (command.type == RobotProtocol::CommandType::Stop) {
+        m_commandedSpeeds.store(PoseIntegrator::packSpeeds(0, 0), std::memory_order_relaxed);
+    }
+}
+
+void PoseEstimator::onPoseUpdated(const RobotPose &pose, bool usingEncoders)
+{
+    m_pose = pose;
+    m_usingEncoders = usingEncoders;
+    emit poseChanged();
+}
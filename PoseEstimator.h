@@ -0,0 +1,86 @@
+#ifndef POSEESTIMATOR_H
+#define POSEESTIMATOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QPointF>
+#include <atomic>
+#include "PoseIntegrator.h"
+#include "RobotProtocol.h"
+
+class CarController;
+
+// GUI-thread facade for dead reckoning. A PoseIntegrator on a dedicated
+// thread integrates the drive commands CarController sends, or encoder
+// travel when telemetry provides it; the pose comes back here at display
+// rate for the map. Positions are map units, as drawn by
+// TopographicalMapView, and the heading is in radians (see RobotPose).
+class PoseEstimator : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QPointF position READ position NOTIFY poseChanged)
+    Q_PROPERTY(double heading READ heading NOTIFY poseChanged)
+    Q_PROPERTY(bool usingEncoders READ usingEncoders NOTIFY poseChanged)
+
+    // Drive model calibration
+    Q_PROPERTY(double trackWidth READ trackWidth WRITE setTrackWidth NOTIFY modelChanged)             // map units
+    Q_PROPERTY(double speedScale READ speedScale WRITE setSpeedScale NOTIFY modelChanged)             // map units/s per motor unit
+    Q_PROPERTY(int motorDeadband READ motorDeadband WRITE setMotorDeadband NOTIFY modelChanged)
+    Q_PROPERTY(int motorResponseTime READ motorResponseTime WRITE setMotorResponseTime NOTIFY modelChanged) // ms
+
+public:
+    explicit PoseEstimator(QObject *parent = nullptr);
+    ~PoseEstimator();
+
+    // Tracks the car's drive commands and becomes its pose source for
+    // route following
+    void attach(CarController *car);
+
+    QPointF position() const { return QPointF(m_pose.x, m_pose.y); }
+    double heading() const { return m_pose.heading; }
+    bool usingEncoders() const { return m_usingEncoders; }
+
+    double trackWidth() const { return m_model.trackWidth; }
+    void setTrackWidth(double width);
+    double speedScale() const { return m_model.speedScale; }
+    void setSpeedScale(double scale);
+    int motorDeadband() const { return m_model.deadband; }
+    void setMotorDeadband(int deadband);
+    int motorResponseTime() const { return qRound(m_model.timeConstant * 1000.0); }
+    void setMotorResponseTime(int ms);
+
+    // Latest integrated pose, newer than position(), and the
+    // RobotProtocol::timestampUs() it was integrated at. False until the
+    // robot has been placed with reset(). Callable from any thread.
+    bool currentPose(RobotPose &pose, quint64 &updatedUs) const;
+
+    // Encoder telemetry: wheel travel in map units since the previous call.
+    // Calls must all come from one thread.
+    void addWheelTravel(double left, double right);
+
+    // Places the robot, e.g. at its start position before a match
+    Q_INVOKABLE void reset(double x, double y, double heading);
+
+signals:
+    void poseChanged();
+    void modelChanged();
+
+private slots:
+    void onCommandIssued(const RobotProtocol::Command &command);
+    void onPoseUpdated(const RobotPose &pose, bool usingEncoders);
+
+private:
+    void applyModel();
+
+    QThread *m_thread;
+    PoseIntegrator *m_integrator;
+    std::atomic<quint64> m_commandedSpeeds;
+    WheelTravelQueue m_encoderQueue;
+    mutable PoseSnapshot m_snapshot;
+
+    DriveModel m_model;
+    RobotPose m_pose;
+    bool m_usingEncoders;
+};
+
+#endif // POSEESTIMATOR_H
@@ -0,0 +1,132 @@
+#include "PoseIntegrator.h"
+#include <QtMath>
+#include <cmath>
+#include "RobotProtocol.h"
+
+PoseIntegrator::PoseIntegrator(std::atomic<quint64> *commandedSpeeds, WheelTravelQueue *encoderQueue,
+                               PoseSnapshot *snapshot, QObject *parent)
+    : QObject(parent)
+    , m_commandedSpeeds(commandedSpeeds)
+    , m_encoderQueue(encoderQueue)
+    , m_snapshot(snapshot)
+    , m_timer(nullptr)
+    , m_lastStepNs(0)
+    , m_lastEncoderNs(-1)
+    , m_leftVelocity(0.0)
+    , m_rightVelocity(0.0)
+    , m_stepsSincePublish(0)
+    , m_publishedEncoders(false)
+{
+}
+
+quint64 PoseIntegrator::packSpeeds(int left, int right)
+{
+    return (static_cast<quint64>(static_cast<quint32>(left)) << 32) | static_cast<quint32>(right);
+}
+
+void PoseIntegrator::start()
+{
+    // Created here so that it belongs to the worker thread
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(1000 / INTEGRATION_RATE);
+    connect(m_timer, &QTimer::timeout, this, &PoseIntegrator::step);
+
+    m_clock.start();
+    m_lastStepNs = m_clock.nsecsElapsed();
+    m_timer->start();
+}
+
+void PoseIntegrator::setModel(const DriveModel &model)
+{
+    m_model = model;
+}
+
+void PoseIntegrator::reset(const RobotPose &pose)
+{
+    m_pose = pose;
+    {
+        QMutexLocker locker(&m_snapshot->mutex);
+        m_snapshot->pose = m_pose;
+        m_snapshot->placed = true;
+        m_snapshot->updatedUs = RobotProtocol::timestampUs();
+    }
+    publish(m_publishedEncoders);
+}
+
+void PoseIntegrator::step()
+{
+    // Integrate over the time actually elapsed; timer ticks are not exact
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    const double dt = qMin(nowNs - m_lastStepNs, MAX_STEP * 1000000LL) / 1e9;
+    m_lastStepNs = nowNs;
+
+    WheelTravel travel;
+    bool encoderTravel = false;
+    while (m_encoderQueue->pop(travel)) {
+        integrate(travel.left, travel.right);
+        encoderTravel = true;
+    }
+    if (encoderTravel) {
+        m_lastEncoderNs = nowNs;
+    }
+    const bool usingEncoders = m_lastEncoderNs >= 0 && nowNs - m_lastEncoderNs < ENCODER_TIMEOUT * 1000000LL;
+
+    // The motor model keeps running while encoders are used, so falling
+    // back to it doesn't start from a standstill
+    const quint64 speeds = m_commandedSpeeds->load(std::memory_order_relaxed);
+    const double targetLeft = wheelSpeed(static_cast<qint32>(speeds >> 32));
+    const double targetRight = wheelSpeed(static_cast<qint32>(speeds & 0xffffffffu));
+    const double response = m_model.timeConstant > 0.0 ? 1.0 - std::exp(-dt / m_model.timeConstant) : 1.0;
+    m_leftVelocity += response * (targetLeft - m_leftVelocity);
+    m_rightVelocity += response * (targetRight - m_rightVelocity);
+
+    if (!usingEncoders) {
+        integrate(m_leftVelocity * dt, m_rightVelocity * dt);
+    }
+
+    {
+        QMutexLocker locker(&m_snapshot->mutex);
+        m_snapshot->pose = m_pose;
+        m_snapshot->updatedUs = RobotProtocol::timestampUs();
+    }
+
+    if (++m_stepsSincePublish >= INTEGRATION_RATE / DISPLAY_RATE) {
+        m_stepsSincePublish = 0;
+        publish(usingEncoders);
+    }
+}
+
+double PoseIntegrator::wheelSpeed(int motorSpeed) const
+{
+    const int magnitude = qAbs(motorSpeed);
+    if (magnitude <= m_model.deadband) {
+        return 0.0;
+    }
+    const double speed = (magnitude - m_model.deadband) * m_model.speedScale;
+    return motorSpeed < 0 ? -speed : speed;
+}
+
+void PoseIntegrator::integrate(double left, double right)
+{
+    // Advance at the mean heading over the step; the error against the true
+    // arc is negligible at the integration rate
+    const double distance = (left + right) / 2.0;
+    const double turn = (left - right) / m_model.trackWidth;
+    const double heading = m_pose.heading + turn / 2.0;
+    m_pose.x += distance * std::cos(heading);
+    m_pose.y += distance * std::sin(heading);
+    m_pose.heading = std::remainder(m_pose.heading + turn, 2.0 * M_PI);
+}
+
+void PoseIntegrator::publish(bool usingEncoders)
+{
+    // A parked robot doesn't need the map redrawn
+    if (m_pose.x == m_publishedPose.x && m_pose.y == m_publishedPose.y
+        && m_pose.heading == m_publishedPose.heading && usingEncoders == m_publishedEncoders) {
+        return;
+    }
+    m_publishedPose = m_pose;
+    m_publishedEncoders = usingEncoders;
+    emit poseUpdated(m_pose, usingEncoders);
+}
@@ -0,0 +1,98 @@
+#ifndef POSEINTEGRATOR_H
+#define POSEINTEGRATOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMetaType>
+#include <atomic>
+#include "RobotPose.h"
+#include "SpscQueue.h"
+
+Q_DECLARE_METATYPE(RobotPose)
+
+// Calibrated differential-drive model, in map units
+struct DriveModel {
+    double trackWidth = 30.0;   // Effective distance between the wheels
+    double speedScale = 0.8;    // Wheel speed per motor speed unit above the deadband, per second
+    int deadband = 25;          // Motor speeds up to this don't turn the wheels
+    double timeConstant = 0.15; // s, motor response to a speed change
+};
+
+Q_DECLARE_METATYPE(DriveModel)
+
+// Wheel travel reported by encoders since the previous sample, in map units
+struct WheelTravel {
+    double left = 0.0;
+    double right = 0.0;
+};
+
+using WheelTravelQueue = SpscQueue<WheelTravel, 256>;
+
+// Latest pose, for readers that can't wait for the next publish
+struct PoseSnapshot {
+    QMutex mutex;
+    RobotPose pose;
+    bool placed = false;  // Set by the first reset(); before it the pose means nothing
+    quint64 updatedUs = 0; // RobotProtocol::timestampUs() of the integration step
+};
+
+// Dead-reckons the robot's pose at a fixed high rate on PoseEstimator's
+// thread. Encoder travel is integrated when it is arriving; otherwise the
+// commanded motor speeds are run through the drive model. Every few steps
+// the pose is published at display rate.
+class PoseIntegrator : public QObject
+{
+    Q_OBJECT
+
+public:
+    // commandedSpeeds holds the left speed in the high and the right speed
+    // in the low 32 bits
+    PoseIntegrator(std::atomic<quint64> *commandedSpeeds, WheelTravelQueue *encoderQueue,
+                   PoseSnapshot *snapshot, QObject *parent = nullptr);
+
+    static quint64 packSpeeds(int left, int right);
+
+public slots:
+    // Must run on the worker thread before anything else
+    void start();
+    void setModel(const DriveModel &model);
+    void reset(const RobotPose &pose);
+
+signals:
+    void poseUpdated(const RobotPose &pose, bool usingEncoders);
+
+private slots:
+    void step();
+
+private:
+    double wheelSpeed(int motorSpeed) const;
+    void integrate(double left, double right);
+    void publish(bool usingEncoders);
+
+    std::atomic<quint64> *m_commandedSpeeds;
+    WheelTravelQueue *m_encoderQueue;
+    PoseSnapshot *m_snapshot;
+
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastStepNs;
+    qint64 m_lastEncoderNs; // -1 until encoder travel arrives
+
+    DriveModel m_model;
+    RobotPose m_pose;
+    double m_leftVelocity;  // Modelled wheel speeds, map units/s
+    double m_rightVelocity;
+
+    int m_stepsSincePublish;
+    RobotPose m_publishedPose;
+    bool m_publishedEncoders;
+
+    static const int INTEGRATION_RATE = 500; // Hz
+    static const int DISPLAY_RATE = 30;      // Hz
+    static const int ENCODER_TIMEOUT = 250;  // ms - back to the model when encoders go quiet
+    static const int MAX_STEP = 50;          // ms - longer gaps (a stalled thread) aren't extrapolated
+};
+
+#endif // POSEINTEGRATOR_H
@@ -0,0 +1,308 @@
+#include "ReplaySource.h"
+#include <QDebug>
+#include <QFile>
+#include "MjpegParser.h"
+#include "RobotProtocol.h"
+
+struct ReplaySource::Mapping {
+    QFile file;
+    uchar *data = nullptr;
+    qint64 size = 0;
+
+    ~Mapping()
+    {
+        if (data) {
+            file.unmap(data);
+        }
+    }
+
+    bool map(const QString &path)
+    {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly) || file.size() <= 0) {
+            return false;
+        }
+        size = file.size();
+        data = file.map(0, size);
+        return data != nullptr;
+    }
+
+    const char *bytes() const { return reinterpret_cast<const char *>(data); }
+};
+
+ReplaySource::ReplaySource(QObject *parent)
+    : QObject(parent)
+    , m_records(nullptr)
+    , m_frameCount(0)
+    , m_firstTimestampUs(0)
+    , m_timer(new QTimer(this))
+    , m_nextFrame(0)
+    , m_speed(1.0)
+    , m_loop(false)
+    , m_playing(false)
+    , m_waitingForConsumer(false)
+    , m_anchorUs(0)
+    , m_anchorFrame(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ReplaySource::emitNextFrame);
+}
+
+bool ReplaySource::open(const QString &path)
+{
+    close();
+
+    auto mapping = std::make_shared<Mapping>();
+    if (!mapping->map(path)) {
+        qDebug() << "ReplaySource: Cannot map" << path << mapping->file.errorString();
+        return false;
+    }
+    m_mapping = mapping;
+
+    if (!loadIndex(RecordingFormat::indexPathFor(path))) {
+        qDebug() << "ReplaySource: No usable index for" << path << "- scanning frames";
+        scanFrames();
+    }
+
+    if (m_frameCount == 0) {
+        qDebug() << "ReplaySource: No frames in" << path;
+        close();
+        return false;
+    }
+
+    m_firstTimestampUs = record(0).timestampUs;
+    buildSeekTable();
+
+    qDebug() << "ReplaySource: Opened" << path << "with" << m_frameCount << "frames,"
+             << durationUs() / 1000 << "ms";
+    return true;
+}
+
+void ReplaySource::close()
+{
+    pause();
+    m_mapping.reset();
+    m_indexMapping.reset();
+    m_records = nullptr;
+    m_scannedRecords.clear();
+    m_seekTable.clear();
+    m_frameCount = 0;
+    m_nextFrame = 0;
+}
+
+bool ReplaySource::loadIndex(const QString &indexPath)
+{
+    if (!QFile::exists(indexPath)) {
+        return false;
+    }
+
+    auto mapping = std::make_shared<Mapping>();
+    RecordingFormat::IndexHeader header;
+    if (!mapping->map(indexPath)
+        || !RecordingFormat::readHeader(mapping->bytes(), mapping->size, header)) {
+        return false;
+    }
+
+    m_indexMapping = mapping;
+    m_records = mapping->bytes() + RecordingFormat::INDEX_HEADER_SIZE;
+
+    // A recording cut short may end in a partial record or point past the
+    // data that made it to disk; stop at the first such record
+    const qsizetype records = (mapping->size - RecordingFormat::INDEX_HEADER_SIZE)
+                              / RecordingFormat::INDEX_RECORD_SIZE;
+    m_frameCount = 0;
+    while (m_frameCount < records) {
+        RecordingFormat::IndexRecord entry = record(m_frameCount);
+        if (entry.size == 0 || entry.offset + entry.size > static_cast<quint64>(m_mapping->size)) {
+            break;
+        }
+        m_frameCount++;
+    }
+    return m_frameCount > 0;
+}
+
+void ReplaySource::scanFrames()
+{
+    m_indexMapping.reset();
+    m_records = nullptr;
+    m_scannedRecords.clear();
+
+    // Raw JPEGs back to back, exactly as MjpegStreamer parses a boundaryless stream
+    MjpegParser parser;
+    parser.setBoundary(QByteArray());
+    MjpegParser::Frame frame;
+    quint64 timestamp = 0;
+    while (parser.next(m_mapping->bytes(), m_mapping->size, frame)) {
+        RecordingFormat::IndexRecord entry;
+        entry.offset = static_cast<quint64>(frame.offset);
+        entry.size = static_cast<quint32>(frame.size);
+        entry.timestampUs = timestamp;
+        m_scannedRecords.push_back(entry);
+        timestamp += SCANNED_FRAME_INTERVAL_US;
+    }
+    m_frameCount = static_cast<qsizetype>(m_scannedRecords.size());
+}
+
+void ReplaySource::buildSeekTable()
+{
+    m_seekTable.clear();
+    m_seekTable.reserve(static_cast<size_t>(durationUs() / SEEK_BUCKET_US + 1));
+
+    for (qsizetype i = 0; i < m_frameCount; ++i) {
+        const quint64 bucket = relativeTime(i) / SEEK_BUCKET_US;
+        while (m_seekTable.size() <= bucket) {
+            m_seekTable.push_back(i);
+        }
+    }
+}
+
+RecordingFormat::IndexRecord ReplaySource::record(qsizetype index) const
+{
+    if (m_records) {
+        return RecordingFormat::readRecord(m_records + index * RecordingFormat::INDEX_RECORD_SIZE);
+    }
+    return m_scannedRecords[static_cast<size_t>(index)];
+}
+
+quint64 ReplaySource::relativeTime(qsizetype index) const
+{
+    const quint64 timestamp = record(index).timestampUs;
+    return timestamp > m_firstTimestampUs ? timestamp - m_firstTimestampUs : 0;
+}
+
+quint64 ReplaySource::durationUs() const
+{
+    return m_frameCount > 0 ? relativeTime(m_frameCount - 1) : 0;
+}
+
+quint64 ReplaySource::positionUs() const
+{
+    if (m_frameCount == 0) {
+        return 0;
+    }
+    return relativeTime(qBound<qsizetype>(0, m_nextFrame - 1, m_frameCount - 1));
+}
+
+void ReplaySource::setSpeed(double speed)
+{
+    m_speed = qMax(0.0, speed);
+    if (m_playing) {
+        m_timer->stop();
+        anchorClock();
+        scheduleNext();
+    }
+}
+
+void ReplaySource::play()
+{
+    if (!isOpen() || m_playing) {
+        return;
+    }
+    m_playing = true;
+    anchorClock();
+    scheduleNext();
+}
+
+void ReplaySource::pause()
+{
+    m_playing = false;
+    m_waitingForConsumer = false;
+    m_timer->stop();
+}
+
+void ReplaySource::seek(quint64 positionUs)
+{
+    if (m_frameCount == 0) {
+        return;
+    }
+
+    // The bucket gives the first frame at or after its start; only the
+    // frames inside that bucket need checking
+    const size_t bucket = qMin(static_cast<size_t>(positionUs / SEEK_BUCKET_US), m_seekTable.size() - 1);
+    qsizetype frame = m_seekTable[bucket];
+    while (frame + 1 < m_frameCount && relativeTime(frame + 1) <= positionUs) {
+        frame++;
+    }
+    if (frame > 0 && relativeTime(frame) > positionUs) {
+        frame--;
+    }
+
+    m_nextFrame = frame;
+    if (m_playing) {
+        m_timer->stop();
+        m_waitingForConsumer = false;
+        anchorClock();
+        scheduleNext();
+    }
+}
+
+void ReplaySource::advance()
+{
+    if (m_playing && m_speed <= 0.0 && m_waitingForConsumer) {
+        m_waitingForConsumer = false;
+        m_timer->start(0);
+    }
+}
+
+void ReplaySource::anchorClock()
+{
+    m_anchorUs = RobotProtocol::timestampUs();
+    m_anchorFrame = qMin(m_nextFrame, m_frameCount - 1);
+}
+
+void ReplaySource::scheduleNext()
+{
+    if (!m_playing) {
+        return;
+    }
+
+    if (m_speed <= 0.0 || m_nextFrame >= m_frameCount) {
+        m_timer->start(0);
+        return;
+    }
+
+    const double offsetUs = (relativeTime(m_nextFrame) - relativeTime(m_anchorFrame)) / m_speed;
+    const quint64 dueUs = m_anchorUs + static_cast<quint64>(offsetUs);
+    const quint64 nowUs = RobotProtocol::timestampUs();
+    m_timer->start(dueUs > nowUs ? static_cast<int>((dueUs - nowUs) / 1000) : 0);
+}
+
+void ReplaySource::emitNextFrame()
+{
+    if (!m_playing || !m_mapping) {
+        return;
+    }
+
+    if (m_nextFrame >= m_frameCount) {
+        if (!m_loop) {
+            pause();
+            emit finished();
+            return;
+        }
+        m_nextFrame = 0;
+        anchorClock();
+    }
+
+    const RecordingFormat::IndexRecord entry = record(m_nextFrame);
+    m_nextFrame++;
+
+    // The frame shares ownership of the mapping, so it stays valid even if
+    // the replay is closed while the frame is still being decoded
+    JpegFrame frame;
+    frame.storage = m_mapping;
+    frame.data = m_mapping->bytes() + entry.offset;
+    frame.size = static_cast<qsizetype>(entry.size);
+    emit frameReady(frame, entry.timestampUs);
+
+    if (m_speed <= 0.0) {
+        // Wait for the consumer, but don't stall forever on a frame that
+        // never comes back (e.g. one that fails to decode)
+        m_waitingForConsumer = true;
+        m_timer->start(STALL_TIMEOUT);
+    } else if (m_nextFrame < m_frameCount) {
+        scheduleNext();
+    } else {
+        m_timer->start(0);
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QObject>
+#include <QTimer>
+#include <memory>
+#include <vector>
+#include "StreamBuffer.h"
+#include "StreamRecorder.h"
+
+// Plays back a camera recording (see RecordingFormat) from memory-mapped
+// files. Frames handed out are views into the mapping, which stays alive for
+// as long as any frame references it, so playback copies nothing. Frame
+// positions come from the .idx file; recordings without one are scanned once
+// with MjpegParser and played at a nominal frame rate.
+//
+// Seeking is O(1): a table with the first frame of every 100 ms of the
+// recording narrows the search to a handful of index records.
+class ReplaySource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReplaySource(QObject *parent = nullptr);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_mapping != nullptr; }
+
+    // 1.0 is real time; 0 plays as fast as frames are consumed (call
+    // advance() after each one)
+    void setSpeed(double speed);
+    double speed() const { return m_speed; }
+
+    void setLoop(bool loop) { m_loop = loop; }
+    bool loop() const { return m_loop; }
+
+    void play();
+    void pause();
+    bool isPlaying() const { return m_playing; }
+
+    // Jumps to the last frame at or before positionUs (from the start)
+    void seek(quint64 positionUs);
+
+    // At max speed, the previous frame has been consumed
+    void advance();
+
+    quint64 durationUs() const;
+    quint64 positionUs() const;
+    int frameCount() const { return static_cast<int>(m_frameCount); }
+
+signals:
+    // timestampUs is the receive time the frame was recorded with
+    void frameReady(const JpegFrame &frame, quint64 timestampUs);
+    void finished();
+
+private slots:
+    void emitNextFrame();
+
+private:
+    struct Mapping;
+
+    RecordingFormat::IndexRecord record(qsizetype index) const;
+    quint64 relativeTime(qsizetype index) const;
+    bool loadIndex(const QString &indexPath);
+    void scanFrames();
+    void buildSeekTable();
+    void scheduleNext();
+    void anchorClock();
+
+    std::shared_ptr<Mapping> m_mapping;      // The .mjpg file
+    std::shared_ptr<Mapping> m_indexMapping; // The .idx file, if present
+    const char *m_records;                   // First index record in m_indexMapping
+    std::vector<RecordingFormat::IndexRecord> m_scannedRecords;
+    qsizetype m_frameCount;
+    quint64 m_firstTimestampUs;
+
+    std::vector<qsizetype> m_seekTable; // First frame of each SEEK_BUCKET_US
+
+    QTimer *m_timer;
+    qsizetype m_nextFrame;
+    double m_speed;
+    bool m_loop;
+    bool m_playing;
+    bool m_waitingForConsumer;
+
+    // Wall-clock anchor: frame m_anchorFrame is due at m_anchorUs
+    quint64 m_anchorUs;
+    qsizetype m_anchorFrame;
+
+    static constexpr quint64 SEEK_BUCKET_US = 100000;
+    static constexpr quint64 SCANNED_FRAME_INTERVAL_US = 33333; // 30 fps without an index
+    static const int STALL_TIMEOUT = 100; // ms - max speed moves on if a frame is never consumed
+};
+
+#endif // REPLAYSOURCE_H
@@ -0,0 +1,13 @@
+#ifndef ROBOTPOSE_H
+#define ROBOTPOSE_H
+
+// Robot position on the field map. x and y are map units as drawn by
+// TopographicalMapView (y pointing down); heading is in radians from +x
+// towards +y, so turning right increases it.
+struct RobotPose {
+    double x = 0.0;
+    double y = 0.0;
+    double heading = 0.0;
+};
+
+#endif // ROBOTPOSE_H
@@ -0,0 +1,209 @@
+#include "RobotProtocol.h"
+#include <QStringList>
+#include <chrono>
+#include <cstring>
+
+namespace RobotProtocol {
+
+namespace {
+
+const char *const SERVO_NAMES[ServoCount] = { "base", "shoulder", "elbow", "wrist", "gripper" };
+const char CAMERA_TIMESTAMP_TAG[4] = { 'R', 'C', 'T', 'S' };
+
+}
+
+void writeLe(char *out, quint64 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+quint64 readLe(const char *in, int bytes)
+{
+    quint64 value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<quint64>(static_cast<quint8>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+Command Command::drive(int left, int right)
+{
+    Command command;
+    command.type = CommandType::Drive;
+    command.values[0] = static_cast<qint16>(left);
+    command.values[1] = static_cast<qint16>(right);
+    return command;
+}
+
+Command Command::stop()
+{
+    Command command;
+    command.type = CommandType::Stop;
+    return command;
+}
+
+Command Command::servos()
+{
+    Command command;
+    command.type = CommandType::Servo;
+    return command;
+}
+
+void Command::setServo(int servo, int angle)
+{
+    if (servo < 0 || servo >= ServoCount) {
+        return;
+    }
+    type = CommandType::Servo;
+    mask |= static_cast<quint8>(1u << servo);
+    values[servo] = static_cast<qint16>(angle);
+}
+
+int servoIndex(const QString &name)
+{
+    for (int i = 0; i < ServoCount; ++i) {
+        if (name.compare(QLatin1String(SERVO_NAMES[i]), Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *servoName(int servo)
+{
+    return (servo >= 0 && servo < ServoCount) ? SERVO_NAMES[servo] : "";
+}
+
+quint64 timestampUs()
+{
+    using namespace std::chrono;
+    return static_cast<quint64>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+quint16 crc16(const char *data, std::size_t size)
+{
+    quint16 crc = 0xFFFF;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc ^= static_cast<quint16>(static_cast<quint8>(data[i])) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? static_cast<quint16>((crc << 1) ^ 0x1021) : static_cast<quint16>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void encode(const Command &command, quint32 sequence, quint64 timestamp, Packet &out)
+{
+    char *p = out.data();
+    p[0] = static_cast<char>(PACKET_MAGIC);
+    p[1] = static_cast<char>(PACKET_VERSION);
+    p[2] = static_cast<char>(command.type);
+    p[3] = static_cast<char>(command.mask);
+    writeLe(p + 4, sequence, 4);
+    writeLe(p + 8, timestamp, 8);
+    for (std::size_t i = 0; i < VALUE_COUNT; ++i) {
+        writeLe(p + 16 + 2 * i, static_cast<quint16>(command.values[i]), 2);
+    }
+    writeLe(p + 26, crc16(p, 26), 2);
+}
+
+bool decode(const char *data, std::size_t size, Command &command, PacketHeader &header)
+{
+    if (size < PACKET_SIZE
+        || static_cast<quint8>(data[0]) != PACKET_MAGIC
+        || static_cast<quint8>(data[1]) != PACKET_VERSION) {
+        return false;
+    }
+
+    if (crc16(data, 26) != static_cast<quint16>(readLe(data + 26, 2))) {
+        return false;
+    }
+
+    quint8 type = static_cast<quint8>(data[2]);
+    if (type < static_cast<quint8>(CommandType::Drive) || type > static_cast<quint8>(CommandType::Stop)) {
+        return false;
+    }
+
+    command.type = static_cast<CommandType>(type);
+    command.mask = static_cast<quint8>(data[3]);
+    header.sequence = static_cast<quint32>(readLe(data + 4, 4));
+    header.timestampUs = readLe(data + 8, 8);
+    for (std::size_t i = 0; i < VALUE_COUNT; ++i) {
+        command.values[i] = static_cast<qint16>(readLe(data + 16 + 2 * i, 2));
+    }
+    return true;
+}
+
+QByteArray formatLegacy(const Command &command)
+{
+    if (command.type == CommandType::Servo) {
+        QByteArray body;
+        for (int i = 0; i < ServoCount; ++i) {
+            if (command.hasServo(i)) {
+                if (!body.isEmpty()) {
+                    body += '&';
+                }
+                body += SERVO_NAMES[i];
+                body += '=';
+                body += QByteArray::number(command.values[i]);
+            }
+        }
+        return body;
+    }
+
+    // The firmware reads the "plain" argument for both drive and stop
+    return "plain=" + QByteArray::number(command.values[0]) + ' ' + QByteArray::number(command.values[1]);
+}
+
+QString describe(const Command &command)
+{
+    if (command.type == CommandType::Servo) {
+        return QString::fromLatin1(formatLegacy(command));
+    }
+    return QString("%1 %2").arg(command.values[0]).arg(command.values[1]);
+}
+
+QByteArray cameraTimestampSegment(quint64 timestampUs)
+{
+    QByteArray segment(CAMERA_TIMESTAMP_SEGMENT_SIZE, Qt::Uninitialized);
+    char *p = segment.data();
+    p[0] = static_cast<char>(0xFF);
+    p[1] = static_cast<char>(0xFE);
+    p[2] = 0;
+    p[3] = static_cast<char>(CAMERA_TIMESTAMP_SEGMENT_SIZE - 2);
+    memcpy(p + 4, CAMERA_TIMESTAMP_TAG, 4);
+    writeLe(p + 8, timestampUs, 8);
+    return segment;
+}
+
+bool readCameraTimestamp(const char *jpeg, std::size_t size, quint64 &timestampUs)
+{
+    const uchar *data = reinterpret_cast<const uchar *>(jpeg);
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    // Walk the marker segments up to the start of scan
+    std::size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        const uchar marker = data[pos + 1];
+        if (marker == 0xDA || marker == 0xD9) {
+            break;
+        }
+        const std::size_t length = (std::size_t(data[pos + 2]) << 8) | data[pos + 3];
+        if (length < 2 || pos + 2 + length > size) {
+            break;
+        }
+        if (marker == 0xFE && length == CAMERA_TIMESTAMP_SEGMENT_SIZE - 2
+            && memcmp(jpeg + pos + 4, CAMERA_TIMESTAMP_TAG, 4) == 0) {
+            timestampUs = readLe(jpeg + pos + 8, 8);
+            return true;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+} // namespace RobotProtocol
@@ -0,0 +1,117 @@
+#ifndef ROBOTPROTOCOL_H
+#define ROBOTPROTOCOL_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <array>
+#include <cstddef>
+
+// Command format shared by the drive and arm controllers. A command is a
+// small value type; it is either formatted as the legacy form body the
+// current ESP32 firmware parses, or encoded into a fixed 28-byte packet:
+//
+//   offset  size  field
+//        0     1  magic (0xA5)
+//        1     1  version (1)
+//        2     1  type (CommandType)
+//        3     1  mask - for servo commands, which servos are set
+//        4     4  sequence number, increasing per sent command
+//        8     8  sender timestamp, monotonic microseconds
+//       16    10  five int16 values (drive: left, right; servo: by index)
+//       26     2  CRC-16/CCITT-FALSE over bytes 0-25
+//
+// All fields are little-endian. The robot drops packets whose sequence
+// number is not newer than the last one it applied.
+//
+// Camera frames from the mock robot carry the capture time in a JPEG COM
+// segment right after SOI, so the GUI can measure glass-to-glass latency:
+//
+//   FF FE 00 0E "RCTS" <8-byte little-endian timestamp, microseconds>
+namespace RobotProtocol {
+
+enum class CommandType : quint8 {
+    Drive = 1,
+    Servo = 2,
+    Stop = 3
+};
+
+enum Servo {
+    Base = 0,
+    Shoulder,
+    Elbow,
+    Wrist,
+    Gripper,
+    ServoCount
+};
+
+constexpr quint8 PACKET_MAGIC = 0xA5;
+constexpr quint8 PACKET_VERSION = 1;
+constexpr std::size_t PACKET_SIZE = 28;
+constexpr std::size_t VALUE_COUNT = 5;
+
+using Packet = std::array<char, PACKET_SIZE>;
+
+struct Command {
+    CommandType type = CommandType::Drive;
+    quint8 mask = 0;
+    std::array<qint16, VALUE_COUNT> values{};
+
+    static Command drive(int left, int right);
+    static Command stop();
+    static Command servos(); // Empty servo command; add servos with setServo
+
+    void setServo(int servo, int angle);
+    bool hasServo(int servo) const { return mask & (1u << servo); }
+    bool isEmpty() const { return type == CommandType::Servo && mask == 0; }
+
+    bool operator==(const Command &other) const
+    {
+        return type == other.type && mask == other.mask && values == other.values;
+    }
+    bool operator!=(const Command &other) const { return !(*this == other); }
+};
+
+struct PacketHeader {
+    quint32 sequence = 0;
+    quint64 timestampUs = 0;
+};
+
+// Servo name as used in the legacy form body, or -1 if unknown
+int servoIndex(const QString &name);
+const char *servoName(int servo);
+
+// Monotonic clock shared by all processes on the host
+quint64 timestampUs();
+
+quint16 crc16(const char *data, std::size_t size);
+
+// Little-endian integer fields of 1 to 8 bytes, for the packet and the
+// recording formats
+void writeLe(char *out, quint64 value, int bytes);
+quint64 readLe(const char *in, int bytes);
+
+// Writes the packet into out; never allocates
+void encode(const Command &command, quint32 sequence, quint64 timestampUs, Packet &out);
+
+// Returns false if the packet is malformed or fails the checksum
+bool decode(const char *data, std::size_t size, Command &command, PacketHeader &header);
+
+// Legacy "plain=L R" and "base=90&shoulder=90" form bodies
+QByteArray formatLegacy(const Command &command);
+
+// Human-readable form for logs and the commandSent signals
+QString describe(const Command &command);
+
+constexpr std::size_t CAMERA_TIMESTAMP_SEGMENT_SIZE = 16;
+
+// COM segment carrying a camera capture timestamp; insert after SOI
+QByteArray cameraTimestampSegment(quint64 timestampUs);
+
+// Finds a camera timestamp among the segments before the image data.
+// Returns false for frames without one.
+bool readCameraTimestamp(const char *jpeg, std::size_t size, quint64 &timestampUs);
+
+} // namespace RobotProtocol
+
+#endif // ROBOTPROTOCOL_H
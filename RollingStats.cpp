@@ -0,0 +1,60 @@
+#include "RollingStats.h"
+#include <QtGlobal>
+#include <cmath>
+
+RollingStats::RollingStats()
+    : m_samples{}
+    , m_next(0)
+    , m_count(0)
+{
+}
+
+void RollingStats::add(double value)
+{
+    m_samples[m_next] = value;
+    m_next = (m_next + 1) % WINDOW;
+    if (m_count < WINDOW) {
+        m_count++;
+    }
+}
+
+void RollingStats::reset()
+{
+    m_next = 0;
+    m_count = 0;
+}
+
+double RollingStats::mean() const
+{
+    if (m_count == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < m_count; ++i) {
+        sum += m_samples[i];
+    }
+    return sum / m_count;
+}
+
+double RollingStats::stddev() const
+{
+    if (m_count < 2) {
+        return 0.0;
+    }
+    const double average = mean();
+    double sum = 0.0;
+    for (int i = 0; i < m_count; ++i) {
+        const double delta = m_samples[i] - average;
+        sum += delta * delta;
+    }
+    return std::sqrt(sum / (m_count - 1));
+}
+
+double RollingStats::max() const
+{
+    double result = 0.0;
+    for (int i = 0; i < m_count; ++i) {
+        result = qMax(result, m_samples[i]);
+    }
+    return result;
+}
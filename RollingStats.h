@@ -0,0 +1,28 @@
+#ifndef ROLLINGSTATS_H
+#define ROLLINGSTATS_H
+
+#include <array>
+
+// Mean, standard deviation and maximum over the most recent samples
+class RollingStats
+{
+public:
+    RollingStats();
+
+    void add(double value);
+    void reset();
+
+    int count() const { return m_count; }
+    double mean() const;
+    double stddev() const;
+    double max() const;
+
+private:
+    static const int WINDOW = 120; // Samples kept, e.g. ~4 s of 30 fps video
+
+    std::array<double, WINDOW> m_samples;
+    int m_next;
+    int m_count;
+};
+
+#endif // ROLLINGSTATS_H
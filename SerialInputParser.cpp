@@ -0,0 +1,185 @@
+#include "SerialInputParser.h"
+#include <cstring>
+#include "RobotProtocol.h"
+
+SerialInputParser::SerialInputParser()
+    : m_frameLength(0)
+    , m_asciiSamples(0)
+    , m_binarySamples(0)
+    , m_malformedLines(0)
+    , m_crcErrors(0)
+{
+    resetLine();
+}
+
+void SerialInputParser::reset()
+{
+    resetLine();
+    m_frameLength = 0;
+}
+
+void SerialInputParser::resetLine()
+{
+    m_field = 0;
+    m_value = 0;
+    m_speed = 0;
+    m_digits = 0;
+    m_lineLength = 0;
+    m_negative = false;
+    m_fieldEnded = false;
+    m_lineBad = false;
+}
+
+bool SerialInputParser::lineHasContent() const
+{
+    return m_lineBad || m_field > 0 || m_digits > 0 || m_negative;
+}
+
+bool SerialInputParser::next(const char *&data, const char *end, Sample &sample)
+{
+    while (data < end) {
+        const unsigned char byte = static_cast<unsigned char>(*data++);
+
+        if (m_frameLength > 0) {
+            if (m_frameLength == 1 && byte != SYNC_BYTE_2) {
+                // A stray sync byte; this one may start a frame or a line
+                m_frameLength = 0;
+                if (byte == SYNC_BYTE_1) {
+                    m_frame[m_frameLength++] = byte;
+                } else if (pushAscii(static_cast<char>(byte), sample)) {
+                    return true;
+                }
+                continue;
+            }
+
+            m_frame[m_frameLength++] = byte;
+            if (m_frameLength == FRAME_SIZE && finishFrame(sample)) {
+                return true;
+            }
+            continue;
+        }
+
+        if (byte == SYNC_BYTE_1) {
+            // A line cut short by a frame is lost; binary leftovers are not a line
+            if (m_lineLength > 0 && lineHasContent()) {
+                ++m_malformedLines;
+            }
+            resetLine();
+            m_frame[m_frameLength++] = byte;
+            continue;
+        }
+
+        if (pushAscii(static_cast<char>(byte), sample)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SerialInputParser::pushAscii(char byte, Sample &sample)
+{
+    if (byte == '\n') {
+        const bool complete = !m_lineBad && m_field == 1 && m_digits > 0;
+        if (complete) {
+            sample.speed = m_speed;
+            sample.turn = m_negative ? -m_value : m_value;
+            sample.binary = false;
+            ++m_asciiSamples;
+        } else if (lineHasContent()) {
+            ++m_malformedLines;
+        }
+        resetLine();
+        return complete;
+    }
+
+    if (m_lineBad) {
+        return false;
+    }
+
+    if (++m_lineLength > MAX_LINE_LENGTH) {
+        m_lineBad = true;
+        return false;
+    }
+
+    if (byte >= '0' && byte <= '9') {
+        if (m_fieldEnded || ++m_digits > MAX_DIGITS) {
+            m_lineBad = true;
+        } else {
+            m_value = m_value * 10 + (byte - '0');
+        }
+    } else if (byte == '-') {
+        if (m_digits > 0 || m_negative) {
+            m_lineBad = true;
+        } else {
+            m_negative = true;
+        }
+    } else if (byte == ',') {
+        if (m_field != 0 || m_digits == 0) {
+            m_lineBad = true;
+        } else {
+            m_speed = m_negative ? -m_value : m_value;
+            m_field = 1;
+            m_value = 0;
+            m_digits = 0;
+            m_negative = false;
+            m_fieldEnded = false;
+        }
+    } else if (byte == ' ' || byte == '\t' || byte == '\r') {
+        if (m_digits > 0) {
+            m_fieldEnded = true;
+        }
+    } else {
+        m_lineBad = true;
+    }
+    return false;
+}
+
+bool SerialInputParser::finishFrame(Sample &sample)
+{
+    const quint16 crc = static_cast<quint16>(m_frame[6] | (m_frame[7] << 8));
+    if (RobotProtocol::crc16(reinterpret_cast<const char *>(m_frame), FRAME_SIZE - 2) == crc) {
+        sample.speed = static_cast<qint16>(m_frame[2] | (m_frame[3] << 8));
+        sample.turn = static_cast<qint16>(m_frame[4] | (m_frame[5] << 8));
+        sample.binary = true;
+        m_frameLength = 0;
+        ++m_binarySamples;
+        return true;
+    }
+
+    ++m_crcErrors;
+
+    // Keep whatever follows the next sync pair; a corrupted byte in one frame
+    // must not swallow the start of the one after it
+    int start = 1;
+    for (;;) {
+        while (start < FRAME_SIZE && m_frame[start] != SYNC_BYTE_1) {
+            ++start;
+        }
+        if (start + 1 >= FRAME_SIZE || m_frame[start + 1] == SYNC_BYTE_2) {
+            break;
+        }
+        ++start;
+    }
+
+    m_frameLength = FRAME_SIZE - start;
+    if (m_frameLength > 0) {
+        std::memmove(m_frame, m_frame + start, m_frameLength);
+    } else {
+        // Still inside binary data; skip it rather than read it as a line
+        m_lineBad = true;
+    }
+    return false;
+}
+
+void SerialInputParser::encodeFrame(qint16 speed, qint16 turn, char *out)
+{
+    out[0] = static_cast<char>(SYNC_BYTE_1);
+    out[1] = static_cast<char>(SYNC_BYTE_2);
+    out[2] = static_cast<char>(speed & 0xFF);
+    out[3] = static_cast<char>((speed >> 8) & 0xFF);
+    out[4] = static_cast<char>(turn & 0xFF);
+    out[5] = static_cast<char>((turn >> 8) & 0xFF);
+    const quint16 crc = RobotProtocol::crc16(out, FRAME_SIZE - 2);
+    out[6] = static_cast<char>(crc & 0xFF);
+    out[7] = static_cast<char>(crc >> 8);
+}
@@ -0,0 +1,81 @@
+#ifndef SERIALINPUTPARSER_H
+#define SERIALINPUTPARSER_H
+
+#include <QtGlobal>
+
+// Incremental parser for the hardware controller's serial stream.
+//
+// Two encodings are accepted on the same port and may be mixed:
+//
+//   ASCII   "speed,turn\n", e.g. "-120,15\r\n"
+//   Binary  8-byte frames, all fields little-endian:
+//             0      sync 0xAA
+//             1      sync 0x55
+//             2..3   speed (int16)
+//             4..5   turn (int16)
+//             6..7   CRC-16/CCITT-FALSE over bytes 0..5
+//
+// The sync byte is outside the ASCII range, so it also ends any partial
+// line. A frame that fails its CRC is rescanned from the next sync byte
+// instead of being dropped whole, so one corrupted byte costs at most one
+// sample. The parser works on the caller's bytes in place and never
+// allocates; range checking is left to the caller.
+class SerialInputParser
+{
+public:
+    struct Sample {
+        int speed = 0;
+        int turn = 0;
+        bool binary = false;
+    };
+
+    SerialInputParser();
+
+    void reset();
+
+    // Consumes bytes from [data, end) until a sample completes. Returns true
+    // with data advanced past the sample; call again until it returns false.
+    bool next(const char *&data, const char *end, Sample &sample);
+
+    // Writes one binary frame of FRAME_SIZE bytes to out
+    static void encodeFrame(qint16 speed, qint16 turn, char *out);
+
+    quint64 asciiSamples() const { return m_asciiSamples; }
+    quint64 binarySamples() const { return m_binarySamples; }
+    quint64 malformedLines() const { return m_malformedLines; }
+    quint64 crcErrors() const { return m_crcErrors; }
+
+    static const int FRAME_SIZE = 8;
+    static const quint8 SYNC_BYTE_1 = 0xAA;
+    static const quint8 SYNC_BYTE_2 = 0x55;
+
+private:
+    bool pushAscii(char byte, Sample &sample);
+    bool finishFrame(Sample &sample);
+    void resetLine();
+    bool lineHasContent() const;
+
+    // ASCII line state
+    int m_field;         // 0 = speed, 1 = turn
+    int m_value;
+    int m_speed;
+    int m_digits;
+    int m_lineLength;
+    bool m_negative;
+    bool m_fieldEnded;   // Whitespace seen after the field's digits
+    bool m_lineBad;      // Discard up to the next newline
+
+    // Binary frame state; m_frameLength == 0 means reading ASCII
+    unsigned char m_frame[FRAME_SIZE];
+    int m_frameLength;
+
+    quint64 m_asciiSamples;
+    quint64 m_binarySamples;
+    quint64 m_malformedLines;
+    quint64 m_crcErrors;
+
+    static const int MAX_LINE_LENGTH = 32;
+    static const int MAX_DIGITS = 6;
+};
+
+#endif // SERIALINPUTPARSER_H
@@ -0,0 +1,185 @@
+#include "SerialInputWorker.h"
+#include <QDebug>
+#include <QtSerialPort/QSerialPortInfo>
+#include "DeviceWatcher.h"
+#include "RobotProtocol.h"
+
+SerialInputWorker::SerialInputWorker(InputSampleQueue *queue, QObject *parent)
+    : QObject(parent)
+    , m_queue(queue)
+    , m_serialPort(nullptr)
+    , m_overflowing(false)
+    , m_active(false)
+    , m_retryTimer(nullptr)
+    , m_backoff(MIN_BACKOFF)
+    , m_deviceWatcher(nullptr)
+{
+}
+
+void SerialInputWorker::open()
+{
+    if (!m_serialPort) {
+        // Created here so the port, timers and notifiers belong to this thread
+        m_serialPort = new QSerialPort(this);
+        connect(m_serialPort, &QSerialPort::readyRead, this, &SerialInputWorker::readSamples);
+        connect(m_serialPort, &QSerialPort::errorOccurred, this, &SerialInputWorker::onPortError);
+
+        m_retryTimer = new QTimer(this);
+        m_retryTimer->setSingleShot(true);
+        connect(m_retryTimer, &QTimer::timeout, this, &SerialInputWorker::tryOpen);
+
+        m_deviceWatcher = new DeviceWatcher(this);
+        connect(m_deviceWatcher, &DeviceWatcher::devicesChanged, this, &SerialInputWorker::onDevicesChanged);
+        if (!m_deviceWatcher->start(QStringLiteral("/dev"), {"ttyACM", "ttyUSB"})) {
+            qDebug() << "SerialInputWorker: No hot-plug notifications, polling for the controller";
+        }
+    }
+
+    m_active = true;
+    m_backoff = MIN_BACKOFF;
+    tryOpen();
+}
+
+void SerialInputWorker::close()
+{
+    m_active = false;
+    if (m_retryTimer) {
+        m_retryTimer->stop();
+    }
+    if (m_serialPort && m_serialPort->isOpen()) {
+        m_serialPort->close();
+        emit portStatusChanged(false, QString());
+    }
+}
+
+void SerialInputWorker::onDevicesChanged()
+{
+    if (m_active && !m_serialPort->isOpen()) {
+        // A controller may just have been plugged in; look now rather than
+        // at the end of a long backoff
+        m_backoff = MIN_BACKOFF;
+        tryOpen();
+    }
+}
+
+QString SerialInputWorker::findArduinoPort() const
+{
+    const auto ports = QSerialPortInfo::availablePorts();
+
+    for (const QSerialPortInfo &port : ports) {
+        // Genuine Arduino Uno (ATmega16U2 USB chip)
+        bool isGenuineArduino = (port.vendorIdentifier() == 0x2341 && port.productIdentifier() == 0x0043);
+
+        // CH340/CH341 clone (wch.cn)
+        bool isCH340Clone = (port.vendorIdentifier() == 0x1A86 && port.productIdentifier() == 0x7523);
+
+        if (isGenuineArduino || isCH340Clone) {
+            return port.portName();
+        }
+    }
+    return QString();
+}
+
+void SerialInputWorker::tryOpen()
+{
+    if (!m_active || m_serialPort->isOpen()) {
+        return;
+    }
+
+    const QString arduinoPortName = findArduinoPort();
+    if (arduinoPortName.isEmpty()) {
+        retryWithBackoff();
+        return;
+    }
+
+    m_serialPort->setPortName(arduinoPortName);
+    m_serialPort->setBaudRate(QSerialPort::Baud115200); // Must match the Arduino's baud rate!
+    m_serialPort->setDataBits(QSerialPort::Data8);
+    m_serialPort->setParity(QSerialPort::NoParity);
+    m_serialPort->setStopBits(QSerialPort::OneStop);
+    m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
+
+    if (m_serialPort->open(QIODevice::ReadOnly)) {
+        qDebug() << "SerialInputWorker: Successfully connected to Arduino on port" << arduinoPortName;
+        m_parser.reset();
+        m_backoff = MIN_BACKOFF;
+        emit portStatusChanged(true, arduinoPortName);
+    } else {
+        qDebug() << "SerialInputWorker: Failed to open serial port" << arduinoPortName
+                 << "Error:" << m_serialPort->errorString();
+        retryWithBackoff();
+    }
+}
+
+void SerialInputWorker::onPortError(QSerialPort::SerialPortError error)
+{
+    // Unplugging shows up as a resource error on the open port
+    if (error == QSerialPort::ResourceError && m_serialPort->isOpen()) {
+        qDebug() << "SerialInputWorker: Lost serial port" << m_serialPort->portName()
+                 << "Error:" << m_serialPort->errorString();
+        portLost();
+    }
+}
+
+void SerialInputWorker::portLost()
+{
+    m_serialPort->close();
+    m_parser.reset();
+    emit portStatusChanged(false, QString());
+
+    if (m_active) {
+        m_backoff = MIN_BACKOFF;
+        retryWithBackoff();
+    }
+}
+
+void SerialInputWorker::retryWithBackoff()
+{
+    scheduleRetry(m_backoff);
+
+    // With hot-plug events the timer is only a safety net, so it can back
+    // off much further than when it is the only way to notice the device
+    const int maxBackoff = m_deviceWatcher->isWatching() ? WATCHED_MAX_BACKOFF : MAX_BACKOFF;
+    m_backoff = qMin(m_backoff * 2, maxBackoff);
+}
+
+void SerialInputWorker::scheduleRetry(int delay)
+{
+    if (m_active) {
+        m_retryTimer->start(delay);
+    }
+}
+
+void SerialInputWorker::readSamples()
+{
+    char buffer[READ_CHUNK];
+    SerialInputParser::Sample parsed;
+    qint64 count;
+
+    while ((count = m_serialPort->read(buffer, sizeof(buffer))) > 0) {
+        // Everything in one read arrived together; stamp it once
+        const quint64 receivedUs = RobotProtocol::timestampUs();
+        const char *data = buffer;
+        const char *end = buffer + count;
+
+        while (m_parser.next(data, end, parsed)) {
+            if (parsed.speed < -255 || parsed.speed > 255 ||
+                parsed.turn < -50 || parsed.turn > 50) {
+                qDebug() << "SerialInputWorker: Invalid range - Speed:" << parsed.speed << "(valid: -255 to 255)"
+                         << "Turn:" << parsed.turn << "(valid: -50 to 50)";
+                continue;
+            }
+
+            InputSample sample;
+            sample.speed = parsed.speed;
+            sample.turn = parsed.turn;
+            sample.receivedUs = receivedUs;
+
+            const bool pushed = m_queue->push(sample);
+            if (!pushed && !m_overflowing) {
+                qDebug() << "SerialInputWorker: Sample queue full, dropping input until the control tick catches up";
+            }
+            m_overflowing = !pushed;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef SERIALINPUTWORKER_H
+#define SERIALINPUTWORKER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QtSerialPort/QSerialPort>
+#include "InputSample.h"
+#include "SerialInputParser.h"
+
+class DeviceWatcher;
+
+// Owns the hardware controller's serial port. Lives on CarController's
+// serial thread so samples are read and timestamped on arrival no matter
+// how busy the GUI thread is; they reach the control tick through a
+// single-producer/single-consumer queue.
+//
+// The controller may be plugged in at any time. On Linux new tty devices
+// are noticed through a DeviceWatcher on /dev; elsewhere, or if inotify is
+// not available, ports are polled. A port that fails to open or disappears is
+// retried with exponential backoff.
+class SerialInputWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SerialInputWorker(InputSampleQueue *queue, QObject *parent = nullptr);
+
+public slots:
+    // Starts looking for the Arduino; must run on the worker thread
+    void open();
+    void close();
+
+signals:
+    void portStatusChanged(bool open, const QString &portName);
+
+private slots:
+    void readSamples();
+    void tryOpen();
+    void onPortError(QSerialPort::SerialPortError error);
+    void onDevicesChanged();
+
+private:
+    QString findArduinoPort() const;
+    void scheduleRetry(int delay);
+    void retryWithBackoff();
+    void portLost();
+
+    InputSampleQueue *m_queue;
+    QSerialPort *m_serialPort;
+    SerialInputParser m_parser;
+    bool m_overflowing;
+    bool m_active;
+
+    // Discovery and reconnects
+    QTimer *m_retryTimer;
+    int m_backoff; // ms, next retry delay
+    DeviceWatcher *m_deviceWatcher;
+
+    static const int READ_CHUNK = 256;          // bytes per read() from the port
+    static const int MIN_BACKOFF = 250;         // ms
+    static const int MAX_BACKOFF = 5000;        // ms - also the polling interval
+    static const int WATCHED_MAX_BACKOFF = 30000; // ms - with hot-plug events
+};
+
+#endif // SERIALINPUTWORKER_H
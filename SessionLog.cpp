@@ -0,0 +1,195 @@
+#include "SessionLog.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QStandardPaths>
+#include <cstring>
+#include "ArmController.h"
+#include "CarController.h"
+
+namespace SessionLogFormat {
+
+using RobotProtocol::readLe;
+using RobotProtocol::writeLe;
+
+void writeHeader(const Header &header, char *out)
+{
+    memcpy(out, MAGIC, 8);
+    writeLe(out + 8, VERSION, 4);
+    writeLe(out + 12, RECORD_SIZE, 4);
+    writeLe(out + 16, header.wallClockStartMs, 8);
+    writeLe(out + 24, header.startUs, 8);
+}
+
+void writeRecord(const Record &record, char *out)
+{
+    writeLe(out, record.timeUs, 8);
+    out[8] = static_cast<char>(record.source);
+    out[9] = static_cast<char>(record.kind);
+    out[10] = static_cast<char>(record.command.type);
+    out[11] = static_cast<char>(record.command.mask);
+    for (std::size_t i = 0; i < RobotProtocol::VALUE_COUNT; ++i) {
+        writeLe(out + 12 + 2 * i, static_cast<quint16>(record.command.values[i]), 2);
+    }
+    writeLe(out + 22, 0, 2);
+}
+
+bool readHeader(const char *data, qsizetype size, Header &header)
+{
+    if (size < HEADER_SIZE || memcmp(data, MAGIC, 8) != 0
+        || readLe(data + 8, 4) != VERSION
+        || readLe(data + 12, 4) != static_cast<quint64>(RECORD_SIZE)) {
+        return false;
+    }
+    header.wallClockStartMs = readLe(data + 16, 8);
+    header.startUs = readLe(data + 24, 8);
+    return true;
+}
+
+bool readRecord(const char *data, Record &record)
+{
+    const quint8 source = static_cast<quint8>(data[8]);
+    const quint8 kind = static_cast<quint8>(data[9]);
+    if (source < quint8(Source::Car) || source > quint8(Source::Arm)
+        || kind < quint8(Kind::Input) || kind > quint8(Kind::Command)) {
+        return false;
+    }
+
+    record.timeUs = readLe(data, 8);
+    record.source = static_cast<Source>(source);
+    record.kind = static_cast<Kind>(kind);
+    record.command.type = static_cast<RobotProtocol::CommandType>(data[10]);
+    record.command.mask = static_cast<quint8>(data[11]);
+    for (std::size_t i = 0; i < RobotProtocol::VALUE_COUNT; ++i) {
+        record.command.values[i] = static_cast<qint16>(readLe(data + 12 + 2 * i, 2));
+    }
+    return true;
+}
+
+} // namespace SessionLogFormat
+
+using namespace SessionLogFormat;
+
+SessionRecorder::SessionRecorder(QObject *parent)
+    : QObject(parent)
+    , m_flushTimer(new QTimer(this))
+    , m_startUs(0)
+    , m_recordedEvents(0)
+{
+    m_flushTimer->setInterval(FLUSH_INTERVAL);
+    connect(m_flushTimer, &QTimer::timeout, this, &SessionRecorder::flush);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+void SessionRecorder::attach(CarController *car)
+{
+    auto recordInput = [this, car]() {
+        RobotProtocol::Command input;
+        input.values[0] = static_cast<qint16>(car->speedValue());
+        input.values[1] = static_cast<qint16>(car->turnValue());
+        append(Source::Car, Kind::Input, input);
+    };
+    connect(car, &CarController::speedValueChanged, this, recordInput);
+    connect(car, &CarController::turnValueChanged, this, recordInput);
+    connect(car, &CarController::commandIssued, this, [this](const RobotProtocol::Command &command) {
+        append(Source::Car, Kind::Command, command);
+    });
+}
+
+void SessionRecorder::attach(ArmController *arm)
+{
+    auto recordServo = [this](int servo, int angle) {
+        RobotProtocol::Command input = RobotProtocol::Command::servos();
+        input.setServo(servo, angle);
+        append(Source::Arm, Kind::Input, input);
+    };
+    connect(arm, &ArmController::baseAngleChanged, this, [=]() { recordServo(RobotProtocol::Base, arm->baseAngle()); });
+    connect(arm, &ArmController::shoulderAngleChanged, this, [=]() { recordServo(RobotProtocol::Shoulder, arm->shoulderAngle()); });
+    connect(arm, &ArmController::elbowAngleChanged, this, [=]() { recordServo(RobotProtocol::Elbow, arm->elbowAngle()); });
+    connect(arm, &ArmController::wristAngleChanged, this, [=]() { recordServo(RobotProtocol::Wrist, arm->wristAngle()); });
+    connect(arm, &ArmController::gripperAngleChanged, this, [=]() { recordServo(RobotProtocol::Gripper, arm->gripperAngle()); });
+    connect(arm, &ArmController::commandIssued, this, [this](const RobotProtocol::Command &command) {
+        append(Source::Arm, Kind::Command, command);
+    });
+}
+
+bool SessionRecorder::start(const QString &path)
+{
+    stop();
+
+    QString target = path;
+    if (target.isEmpty()) {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation));
+        dir.mkpath("RC_GUI");
+        target = dir.filePath("RC_GUI/session-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".rcs");
+    }
+
+    m_file.setFileName(target);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "SessionRecorder: Cannot open" << target << m_file.errorString();
+        return false;
+    }
+
+    Header header;
+    header.wallClockStartMs = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch());
+    header.startUs = RobotProtocol::timestampUs();
+    m_startUs = header.startUs;
+
+    char bytes[HEADER_SIZE];
+    writeHeader(header, bytes);
+    m_buffer.clear();
+    m_buffer.append(bytes, HEADER_SIZE);
+    m_recordedEvents = 0;
+    m_flushTimer->start();
+
+    qDebug() << "SessionRecorder: Recording to" << target;
+    emit recordingChanged();
+    emit recordedEventsChanged();
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_flushTimer->stop();
+    flush();
+    m_file.close();
+    qDebug() << "SessionRecorder: Recorded" << m_recordedEvents << "events to" << m_file.fileName();
+    emit recordingChanged();
+}
+
+void SessionRecorder::append(Source source, Kind kind, const RobotProtocol::Command &command)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    Record record;
+    record.timeUs = RobotProtocol::timestampUs() - m_startUs;
+    record.source = source;
+    record.kind = kind;
+    record.command = command;
+
+    char bytes[RECORD_SIZE];
+    writeRecord(record, bytes);
+    m_buffer.append(bytes, RECORD_SIZE);
+    m_recordedEvents++;
+}
+
+void SessionRecorder::flush()
+{
+    if (m_buffer.isEmpty()) {
+        return;
+    }
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        qDebug() << "SessionRecorder: Write failed:" << m_file.errorString();
+    }
+    m_buffer.resize(0); // Keeps the capacity for the next batch
+    emit recordedEventsChanged();
+}
@@ -0,0 +1,109 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include "RobotProtocol.h"
+
+class CarController;
+class ArmController;
+
+// On-disk layout of a control session log: a 32-byte header followed by
+// one 24-byte record per input sample or outgoing command. All fields are
+// little-endian:
+//
+//   header  0  8  magic "RCSESS01"
+//           8  4  version (1)
+//          12  4  record size (24)
+//          16  8  wall-clock start time, ms since epoch
+//          24  8  monotonic start time, us (RobotProtocol::timestampUs)
+//
+//   record  0  8  time since the start, us
+//           8  1  source (Source)
+//           9  1  kind (Kind)
+//          10  1  command type (RobotProtocol::CommandType), commands only
+//          11  1  servo mask, arm records only
+//          12 10  five int16 values: car input speed, turn; drive command
+//                 left, right; servo angles by index
+//          22  2  reserved (0)
+namespace SessionLogFormat {
+
+constexpr char MAGIC[8] = { 'R', 'C', 'S', 'E', 'S', 'S', '0', '1' };
+constexpr quint32 VERSION = 1;
+constexpr qsizetype HEADER_SIZE = 32;
+constexpr qsizetype RECORD_SIZE = 24;
+
+enum class Source : quint8 {
+    Car = 1,
+    Arm = 2
+};
+
+enum class Kind : quint8 {
+    Input = 1,
+    Command = 2
+};
+
+struct Header {
+    quint64 wallClockStartMs = 0;
+    quint64 startUs = 0;
+};
+
+struct Record {
+    quint64 timeUs = 0;
+    Source source = Source::Car;
+    Kind kind = Kind::Input;
+    RobotProtocol::Command command; // Input records use mask and values only
+};
+
+void writeHeader(const Header &header, char *out);
+void writeRecord(const Record &record, char *out);
+bool readHeader(const char *data, qsizetype size, Header &header);
+bool readRecord(const char *data, Record &record);
+
+} // namespace SessionLogFormat
+
+// Records every input sample and outgoing command of the attached
+// controllers. That is at most a few kilobytes a second, so records are
+// collected in memory and written every FLUSH_INTERVAL ms on the GUI thread.
+class SessionRecorder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool recording READ isRecording NOTIFY recordingChanged)
+    Q_PROPERTY(QString path READ path NOTIFY recordingChanged)
+    Q_PROPERTY(int recordedEvents READ recordedEvents NOTIFY recordedEventsChanged)
+
+public:
+    explicit SessionRecorder(QObject *parent = nullptr);
+    ~SessionRecorder();
+
+    void attach(CarController *car);
+    void attach(ArmController *arm);
+
+    // Empty path records to Documents/RC_GUI/session-<date>-<time>.rcs
+    Q_INVOKABLE bool start(const QString &path = QString());
+    Q_INVOKABLE void stop();
+
+    bool isRecording() const { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+    int recordedEvents() const { return m_recordedEvents; }
+
+signals:
+    void recordingChanged();
+    void recordedEventsChanged();
+
+private:
+    void append(SessionLogFormat::Source source, SessionLogFormat::Kind kind,
+                const RobotProtocol::Command &command);
+    void flush();
+
+    QFile m_file;
+    QByteArray m_buffer;
+    QTimer *m_flushTimer;
+    quint64 m_startUs;
+    int m_recordedEvents;
+
+    static const int FLUSH_INTERVAL = 500; // ms
+};
+
+#endif // SESSIONLOG_H
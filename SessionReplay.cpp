@@ -0,0 +1,245 @@
+#include "SessionReplay.h"
+#include <QDebug>
+#include <QFile>
+#include <limits>
+#include "ArmController.h"
+#include "CarController.h"
+
+using namespace SessionLogFormat;
+
+SessionReplay::SessionReplay(QObject *parent)
+    : QObject(parent)
+    , m_car(nullptr)
+    , m_arm(nullptr)
+    , m_next(0)
+    , m_playing(false)
+    , m_speed(1.0)
+    , m_timer(new QTimer(this))
+    , m_anchorUs(0)
+    , m_recordedCommands(0)
+    , m_replayedCommands(0)
+    , m_eventsSinceProgress(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &SessionReplay::playDue);
+}
+
+void SessionReplay::setControllers(CarController *car, ArmController *arm)
+{
+    m_car = car;
+    m_arm = arm;
+
+    // Count what the controllers send while replaying
+    auto countCommand = [this]() {
+        if (m_playing) {
+            m_replayedCommands++;
+        }
+    };
+    if (m_car) {
+        connect(m_car, &CarController::commandIssued, this, countCommand);
+    }
+    if (m_arm) {
+        connect(m_arm, &ArmController::commandIssued, this, countCommand);
+    }
+}
+
+bool SessionReplay::start(const QString &path)
+{
+    stop();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "SessionReplay: Cannot open" << path << file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+
+    Header header;
+    if (!readHeader(data.constData(), data.size(), header)) {
+        qDebug() << "SessionReplay: Not a session log:" << path;
+        return false;
+    }
+
+    m_records.clear();
+    m_records.reserve(static_cast<std::size_t>((data.size() - HEADER_SIZE) / RECORD_SIZE));
+    m_recordedCommands = 0;
+    for (qsizetype offset = HEADER_SIZE; offset + RECORD_SIZE <= data.size(); offset += RECORD_SIZE) {
+        Record record;
+        if (readRecord(data.constData() + offset, record)) {
+            if (record.kind == Kind::Command) {
+                m_recordedCommands++;
+            }
+            m_records.push_back(record);
+        }
+    }
+
+    if (m_records.empty()) {
+        qDebug() << "SessionReplay: No events in" << path;
+        return false;
+    }
+
+    m_next = 0;
+    m_replayedCommands = 0;
+    m_eventsSinceProgress = 0;
+    m_playing = true;
+    // Leading idle time before the first event is skipped
+    reanchor(m_records.front().timeUs);
+
+    qDebug() << "SessionReplay: Replaying" << m_records.size() << "events from" << path
+             << "at" << (m_speed > 0 ? QString::number(m_speed) + "x" : QStringLiteral("max speed"));
+    emit playingChanged();
+    emit progressChanged();
+
+    scheduleNext();
+    return true;
+}
+
+void SessionReplay::stop()
+{
+    if (!m_playing) {
+        return;
+    }
+    m_timer->stop();
+    m_playing = false;
+    emit playingChanged();
+}
+
+void SessionReplay::setSpeed(double speed)
+{
+    speed = qMax(0.0, speed);
+    if (m_speed == speed) {
+        return;
+    }
+
+    // Continue from the current position at the new pace
+    const quint64 position = m_playing ? currentTimeUs() : 0;
+    m_speed = speed;
+    if (m_playing) {
+        reanchor(position);
+        scheduleNext();
+    }
+    emit speedChanged();
+}
+
+int SessionReplay::duration() const
+{
+    if (m_records.empty()) {
+        return 0;
+    }
+    return static_cast<int>((m_records.back().timeUs - m_records.front().timeUs) / 1000);
+}
+
+int SessionReplay::position() const
+{
+    if (m_records.empty()) {
+        return 0;
+    }
+    const std::size_t last = qMin(m_next, m_records.size() - 1);
+    return static_cast<int>((m_records[last].timeUs - m_records.front().timeUs) / 1000);
+}
+
+quint64 SessionReplay::currentTimeUs() const
+{
+    if (m_speed <= 0) {
+        // At max speed the position is simply the next event
+        return m_next < m_records.size() ? m_records[m_next].timeUs : m_records.back().timeUs;
+    }
+    return m_anchorUs + static_cast<quint64>(m_clock.nsecsElapsed() / 1000.0 * m_speed);
+}
+
+void SessionReplay::reanchor(quint64 timeUs)
+{
+    m_anchorUs = timeUs;
+    m_clock.start();
+}
+
+void SessionReplay::scheduleNext()
+{
+    if (m_next >= m_records.size()) {
+        finish();
+        return;
+    }
+
+    if (m_speed <= 0) {
+        // Yield to the event loop between batches so network replies and
+        // the UI keep up
+        m_timer->start(0);
+        return;
+    }
+
+    const quint64 due = m_records[m_next].timeUs;
+    const quint64 now = currentTimeUs();
+    const qint64 waitMs = due > now ? static_cast<qint64>((due - now) / m_speed / 1000.0) : 0;
+    m_timer->start(static_cast<int>(qMin<qint64>(waitMs, std::numeric_limits<int>::max())));
+}
+
+void SessionReplay::playDue()
+{
+    if (!m_playing) {
+        return;
+    }
+
+    const bool maxSpeed = m_speed <= 0;
+    const quint64 now = currentTimeUs();
+    int played = 0;
+
+    while (m_next < m_records.size()) {
+        const Record &record = m_records[m_next];
+        if (maxSpeed ? played >= MAX_BATCH : record.timeUs > now) {
+            break;
+        }
+        apply(record);
+        m_next++;
+        played++;
+
+        if (++m_eventsSinceProgress >= PROGRESS_INTERVAL) {
+            m_eventsSinceProgress = 0;
+            emit progressChanged();
+        }
+    }
+
+    scheduleNext();
+}
+
+void SessionReplay::apply(const Record &record)
+{
+    if (record.source == Source::Car && m_car) {
+        if (record.kind == Kind::Input) {
+            m_car->setSpeedValue(record.command.values[0]);
+            m_car->setTurnValue(record.command.values[1]);
+            if (m_speed <= 0) {
+                m_car->stepControl();
+            }
+        } else if (record.command.type == RobotProtocol::CommandType::Stop) {
+            // The stop button is an input in its own right
+            m_car->stopCar();
+        }
+    } else if (record.source == Source::Arm && m_arm && record.kind == Kind::Input) {
+        static void (ArmController::*const MOVES[RobotProtocol::ServoCount])(int) = {
+            &ArmController::moveBase,
+            &ArmController::moveShoulder,
+            &ArmController::moveElbow,
+            &ArmController::moveWrist,
+            &ArmController::moveGripper
+        };
+        for (int servo = 0; servo < RobotProtocol::ServoCount; ++servo) {
+            if (record.command.hasServo(servo)) {
+                (m_arm->*MOVES[servo])(record.command.values[servo]);
+            }
+        }
+    }
+}
+
+void SessionReplay::finish()
+{
+    const double elapsedMs = m_clock.nsecsElapsed() / 1e6;
+    qDebug() << "SessionReplay: Finished" << m_records.size() << "events;"
+             << "commands recorded" << m_recordedCommands << "replayed" << m_replayedCommands
+             << "in" << QString::number(elapsedMs, 'f', 1) << "ms";
+
+    m_playing = false;
+    emit progressChanged();
+    emit playingChanged();
+    emit finished();
+}
@@ -0,0 +1,89 @@
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <vector>
+#include "SessionLog.h"
+
+class CarController;
+class ArmController;
+
+// Pushes a recorded session's inputs back through the controllers, so the
+// same workload can be run against the mock robot again and again. Inputs
+// go through the controllers' public API exactly as the UI would drive
+// them; recorded commands are not resent but counted, so the command rate
+// of the replay can be compared with the recording.
+//
+// speed 1 replays in real time. speed 0 replays as fast as possible, and
+// runs a car control step after every input instead of waiting for its
+// control tick (see CarController::stepControl()). Every recorded input
+// then gets its own pass through the output stage. The stage shapes it as
+// it would live: small changes are held back by the threshold and large
+// ones are slew limited.
+class SessionReplay : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool playing READ isPlaying NOTIFY playingChanged)
+    Q_PROPERTY(double speed READ speed WRITE setSpeed NOTIFY speedChanged)
+    Q_PROPERTY(int duration READ duration NOTIFY playingChanged)    // ms
+    Q_PROPERTY(int position READ position NOTIFY progressChanged)   // ms
+    Q_PROPERTY(int recordedCommands READ recordedCommands NOTIFY progressChanged)
+    Q_PROPERTY(int replayedCommands READ replayedCommands NOTIFY progressChanged)
+
+public:
+    explicit SessionReplay(QObject *parent = nullptr);
+
+    void setControllers(CarController *car, ArmController *arm);
+
+    Q_INVOKABLE bool start(const QString &path);
+    Q_INVOKABLE void stop();
+
+    bool isPlaying() const { return m_playing; }
+    double speed() const { return m_speed; }
+    void setSpeed(double speed);
+    int duration() const;
+    int position() const;
+    int recordedCommands() const { return m_recordedCommands; }
+    int replayedCommands() const { return m_replayedCommands; }
+
+signals:
+    void playingChanged();
+    void speedChanged();
+    void progressChanged();
+    void finished();
+
+private slots:
+    void playDue();
+
+private:
+    void apply(const SessionLogFormat::Record &record);
+    void scheduleNext();
+    void finish();
+    quint64 currentTimeUs() const;
+    void reanchor(quint64 timeUs);
+
+    CarController *m_car;
+    ArmController *m_arm;
+
+    std::vector<SessionLogFormat::Record> m_records;
+    std::size_t m_next;
+    bool m_playing;
+    double m_speed;
+
+    // Real-time pacing: record time t is due when m_clock reaches
+    // (t - m_anchorUs) / m_speed
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    quint64 m_anchorUs;
+
+    int m_recordedCommands;
+    int m_replayedCommands;
+    int m_eventsSinceProgress;
+
+    static const int MAX_BATCH = 256;       // Events per pass at max speed before yielding
+    static const int PROGRESS_INTERVAL = 64; // Events between progress updates
+};
+
+#endif // SESSIONREPLAY_H
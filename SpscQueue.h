@@ -0,0 +1,67 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded wait-free queue for exactly one producer thread and one consumer
+// thread. Each side owns one index and only reads the other's, so push and
+// pop are a load, a store and no read-modify-write.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() = default;
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Returns false without blocking if the queue is full.
+    bool push(T value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) {
+                return false;
+            }
+        }
+
+        m_slots[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false without blocking if the queue is empty.
+    bool pop(T &value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+
+        value = std::move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> m_slots;
+
+    // Each side's index shares a cache line with its cached copy of the
+    // other side's index, so the sides rarely touch each other's lines
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    std::size_t m_cachedTail = 0;
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_cachedHead = 0;
+};
+
+#endif // SPSCQUEUE_H
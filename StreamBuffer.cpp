@@ -0,0 +1,72 @@
+#include "StreamBuffer.h"
+#include <cstring>
+
+StreamBuffer::StreamBuffer()
+    : m_begin(0)
+    , m_end(0)
+{
+}
+
+const char *StreamBuffer::data() const
+{
+    return m_chunk ? m_chunk->bytes.get() + m_begin : nullptr;
+}
+
+void StreamBuffer::clear()
+{
+    // Frames sliced from the current chunk may still be queued for recording
+    // or decoding, so the next stream must not be written over it. It is
+    // retired like a full chunk and reused only once they are done with it.
+    if (m_chunk && static_cast<int>(m_pool.size()) < MAX_POOLED_CHUNKS) {
+        m_pool.push_back(m_chunk);
+    }
+    m_chunk.reset();
+    m_begin = 0;
+    m_end = 0;
+}
+
+char *StreamBuffer::reserve(qsizetype minFree)
+{
+    if (m_chunk && m_chunk->capacity - m_end >= minFree) {
+        return m_chunk->bytes.get() + m_end;
+    }
+
+    // Move the unconsumed tail (at most one partial frame) to a fresh chunk.
+    // The old chunk is left untouched for any frames still referencing it.
+    const qsizetype live = size();
+    std::shared_ptr<Chunk> next = acquireChunk(qMax(CHUNK_SIZE, live + minFree));
+    if (live > 0) {
+        std::memcpy(next->bytes.get(), m_chunk->bytes.get() + m_begin, static_cast<size_t>(live));
+    }
+
+    if (m_chunk && static_cast<int>(m_pool.size()) < MAX_POOLED_CHUNKS) {
+        m_pool.push_back(m_chunk);
+    }
+
+    m_chunk = std::move(next);
+    m_begin = 0;
+    m_end = live;
+    return m_chunk->bytes.get() + m_end;
+}
+
+std::shared_ptr<StreamBuffer::Chunk> StreamBuffer::acquireChunk(qsizetype capacity)
+{
+    for (auto it = m_pool.begin(); it != m_pool.end(); ++it) {
+        // Only the pool holds it, so no frame can still be reading from it
+        if (it->use_count() == 1 && (*it)->capacity >= capacity) {
+            std::shared_ptr<Chunk> chunk = std::move(*it);
+            m_pool.erase(it);
+            return chunk;
+        }
+    }
+    return std::make_shared<Chunk>(capacity);
+}
+
+JpegFrame StreamBuffer::frame(qsizetype offset, qsizetype size) const
+{
+    JpegFrame frame;
+    frame.storage = m_chunk;
+    frame.data = data() + offset;
+    frame.size = size;
+    return frame;
+}
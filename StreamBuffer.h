@@ -0,0 +1,68 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <QtGlobal>
+#include <memory>
+#include <vector>
+
+// A complete JPEG inside stream storage. Holding the frame keeps the storage
+// alive, so frames can be handed on (to a decoder, a recorder) without
+// copying the bytes.
+struct JpegFrame {
+    std::shared_ptr<const void> storage;
+    const char *data = nullptr;
+    qsizetype size = 0;
+
+    bool isNull() const { return !data || size <= 0; }
+    const uchar *bytes() const { return reinterpret_cast<const uchar *>(data); }
+};
+
+// Receive buffer for the camera stream, made of large reference-counted
+// chunks. Network data is read straight into the free tail of the current
+// chunk, and complete frames are sliced out as JpegFrame views. Consuming
+// data only moves a start offset. Bytes are copied only when a chunk fills
+// up, and then only the unfinished frame at its end moves to the next chunk.
+class StreamBuffer
+{
+public:
+    StreamBuffer();
+
+    // Unconsumed bytes; offsets passed to frame() and consume() are relative
+    // to data()
+    const char *data() const;
+    qsizetype size() const { return m_end - m_begin; }
+
+    // Returns space for at least minFree bytes at the end of the buffer;
+    // call commit() with the number actually written
+    char *reserve(qsizetype minFree);
+    void commit(qsizetype count) { m_end += count; }
+
+    void consume(qsizetype count) { m_begin += qMin(count, size()); }
+    // Drops all data; the next reserve() starts a fresh chunk
+    void clear();
+
+    JpegFrame frame(qsizetype offset, qsizetype size) const;
+
+    static constexpr qsizetype CHUNK_SIZE = 1024 * 1024;
+
+private:
+    struct Chunk {
+        explicit Chunk(qsizetype capacity)
+            : bytes(new char[static_cast<size_t>(capacity)]), capacity(capacity) {}
+        std::unique_ptr<char[]> bytes;
+        qsizetype capacity;
+    };
+
+    std::shared_ptr<Chunk> acquireChunk(qsizetype capacity);
+
+    std::shared_ptr<Chunk> m_chunk;
+    qsizetype m_begin;
+    qsizetype m_end;
+
+    // Retired chunks, reused once no frame references them any more
+    std::vector<std::shared_ptr<Chunk>> m_pool;
+
+    static const int MAX_POOLED_CHUNKS = 4;
+};
+
+#endif // STREAMBUFFER_H
@@ -0,0 +1,176 @@
+#include "StreamQualityController.h"
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QUrlQuery>
+#include <QDebug>
+
+// Best to worst; resolution goes down first where it saves the most bytes
+// and decode time, quality fills the steps in between
+const StreamQualityController::Level StreamQualityController::LEVELS[] = {
+    { 8, 640, 480, 12 },  // VGA
+    { 8, 640, 480, 20 },
+    { 7, 480, 320, 20 },  // HVGA
+    { 6, 400, 296, 25 },  // CIF
+    { 5, 320, 240, 30 },  // QVGA
+    { 5, 320, 240, 40 },
+    { 1, 160, 120, 40 },  // QQVGA
+};
+
+StreamQualityController::StreamQualityController(QNetworkAccessManager *network, QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+    , m_enabled(false)
+    , m_level(0)
+    , m_pressureSeconds(0)
+    , m_headroomSeconds(0)
+    , m_cooldownSeconds(0)
+    , m_peakFrameRate(0)
+    , m_bandwidth(0)
+{
+}
+
+int StreamQualityController::levelCount()
+{
+    return static_cast<int>(sizeof(LEVELS) / sizeof(LEVELS[0]));
+}
+
+QString StreamQualityController::levelDescription() const
+{
+    const Level &level = LEVELS[m_level];
+    return QString("%1x%2 q%3").arg(level.width).arg(level.height).arg(level.quality);
+}
+
+void StreamQualityController::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    reset();
+    if (m_enabled) {
+        apply();
+    }
+}
+
+void StreamQualityController::setStreamUrl(const QUrl &streamUrl)
+{
+    m_controlUrl = QUrl();
+    if (streamUrl.isLocalFile() || streamUrl.host().isEmpty()) {
+        return;
+    }
+    m_controlUrl.setScheme(streamUrl.scheme());
+    m_controlUrl.setHost(streamUrl.host());
+    // The stock ESP32-CAM firmware streams on port 81 and takes control
+    // requests on the default port
+    if (streamUrl.port() != 81) {
+        m_controlUrl.setPort(streamUrl.port());
+    }
+    m_controlUrl.setPath("/control");
+}
+
+void StreamQualityController::reset()
+{
+    m_pressureSeconds = 0;
+    m_headroomSeconds = 0;
+    m_cooldownSeconds = COOLDOWN_SECONDS;
+    m_peakFrameRate = 0;
+}
+
+void StreamQualityController::apply()
+{
+    if (!m_enabled) {
+        return;
+    }
+    sendControl("framesize", LEVELS[m_level].framesize);
+    sendControl("quality", LEVELS[m_level].quality);
+}
+
+void StreamQualityController::addSample(const Sample &sample)
+{
+    m_bandwidth = sample.receivedBytes;
+
+    if (!m_enabled) {
+        return;
+    }
+
+    if (m_cooldownSeconds > 0) {
+        m_cooldownSeconds--;
+        return;
+    }
+
+    m_peakFrameRate = qMax(m_peakFrameRate, sample.receivedFrames);
+
+    if (underPressure(sample)) {
+        m_headroomSeconds = 0;
+        if (++m_pressureSeconds >= PRESSURE_SECONDS && m_level + 1 < levelCount()) {
+            setLevel(m_level + 1);
+        }
+    } else if (hasHeadroom(sample)) {
+        m_pressureSeconds = 0;
+        if (++m_headroomSeconds >= HEADROOM_SECONDS && m_level > 0) {
+            setLevel(m_level - 1);
+        }
+    } else {
+        m_pressureSeconds = 0;
+        m_headroomSeconds = 0;
+    }
+}
+
+bool StreamQualityController::underPressure(const Sample &sample) const
+{
+    if (sample.receivedFrames == 0) {
+        return false; // Nothing arriving is a connection problem, not a quality one
+    }
+
+    const double dropRatio = double(sample.droppedFrames) / sample.receivedFrames;
+
+    // Wi-Fi can't carry the current frame size: frames arrive well below
+    // the rate the camera delivered at this level before
+    const bool ingestFalling = m_peakFrameRate >= 5 && sample.receivedFrames < m_peakFrameRate * 0.7;
+
+    return dropRatio > MAX_DROP_RATIO
+           || sample.decodeQueueDepth > MAX_QUEUE_DEPTH
+           || sample.pipelineLatencyMs > TARGET_LATENCY_MS
+           || ingestFalling;
+}
+
+bool StreamQualityController::hasHeadroom(const Sample &sample) const
+{
+    return sample.receivedFrames > 0
+           && sample.droppedFrames == 0
+           && sample.decodeQueueDepth < MAX_QUEUE_DEPTH / 2
+           && sample.pipelineLatencyMs < TARGET_LATENCY_MS / 2;
+}
+
+void StreamQualityController::setLevel(int level)
+{
+    qDebug() << "StreamQualityController: Level" << m_level << "->" << level
+             << "(" << LEVELS[level].width << "x" << LEVELS[level].height
+             << "quality" << LEVELS[level].quality << ")";
+
+    m_level = level;
+    reset();
+    apply();
+    emit levelChanged();
+}
+
+void StreamQualityController::sendControl(const QByteArray &variable, int value)
+{
+    if (!m_controlUrl.isValid() || m_controlUrl.isEmpty()) {
+        return;
+    }
+
+    QUrl url = m_controlUrl;
+    QUrlQuery query;
+    query.addQueryItem("var", QString::fromLatin1(variable));
+    query.addQueryItem("val", QString::number(value));
+    url.setQuery(query);
+
+    QNetworkReply *reply = m_network->get(QNetworkRequest(url));
+    connect(reply, &QNetworkReply::finished, reply, [reply, variable]() {
+        if (reply->error() != QNetworkReply::NoError) {
+            qDebug() << "StreamQualityController: Setting" << variable << "failed:" << reply->errorString();
+        }
+        reply->deleteLater();
+    });
+}
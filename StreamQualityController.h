@@ -0,0 +1,84 @@
+#ifndef STREAMQUALITYCONTROLLER_H
+#define STREAMQUALITYCONTROLLER_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QUrl>
+
+// Adapts the camera's resolution and JPEG quality to what the link and the
+// decoder can sustain, through the ESP32-CAM control endpoint
+// (/control?var=framesize|quality&val=N on the stream's host). It is fed
+// one sample per second; sustained pressure (frames dropped before
+// decoding, a decode backlog, rising latency, or fewer frames arriving than
+// the camera managed before) steps down one level, and a long enough stretch
+// of headroom steps back up. Stepping up waits longer than stepping down so
+// the stream doesn't oscillate.
+class StreamQualityController : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Sample {
+        int receivedFrames = 0;      // Frames parsed in the last second
+        int droppedFrames = 0;       // Replaced before decoding
+        double decodeQueueDepth = 0; // Mean frames still waiting or decoding when a frame arrives
+        double pipelineLatencyMs = 0;
+        qint64 receivedBytes = 0;
+    };
+
+    explicit StreamQualityController(QNetworkAccessManager *network, QObject *parent = nullptr);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // Control endpoint host; taken from the stream url
+    void setStreamUrl(const QUrl &streamUrl);
+
+    int level() const { return m_level; }
+    static int levelCount();
+    QString levelDescription() const;
+    qint64 bandwidth() const { return m_bandwidth; } // Bytes/s over the last sample
+
+    // Sends the current level to the camera, e.g. after reconnecting
+    void apply();
+    void reset();
+
+    void addSample(const Sample &sample);
+
+signals:
+    void levelChanged();
+
+private:
+    struct Level {
+        int framesize;   // esp32-camera framesize_t
+        int width;
+        int height;
+        int quality;     // 10 (best) - 63
+    };
+
+    bool underPressure(const Sample &sample) const;
+    bool hasHeadroom(const Sample &sample) const;
+    void setLevel(int level);
+    void sendControl(const QByteArray &variable, int value);
+
+    static const Level LEVELS[];
+
+    QNetworkAccessManager *m_network;
+    QUrl m_controlUrl;
+    bool m_enabled;
+    int m_level;
+    int m_pressureSeconds;
+    int m_headroomSeconds;
+    int m_cooldownSeconds;
+    int m_peakFrameRate; // Best receive rate seen at the current level
+    qint64 m_bandwidth;
+
+    static const int PRESSURE_SECONDS = 2;   // Sustained pressure before stepping down
+    static const int HEADROOM_SECONDS = 8;   // Sustained headroom before stepping up
+    static const int COOLDOWN_SECONDS = 3;   // Let the camera settle after a change
+    static constexpr double MAX_DROP_RATIO = 0.15;
+    static constexpr double MAX_QUEUE_DEPTH = 1.0;     // Frames found ahead of a new one; above 1 the decoder falls behind
+    static constexpr double TARGET_LATENCY_MS = 120.0;
+};
+
+#endif // STREAMQUALITYCONTROLLER_H
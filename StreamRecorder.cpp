@@ -0,0 +1,276 @@
+#include "StreamRecorder.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
+#include <cstring>
+#include "RobotProtocol.h"
+
+namespace RecordingFormat {
+
+using RobotProtocol::readLe;
+using RobotProtocol::writeLe;
+
+void writeHeader(const IndexHeader &header, char *out)
+{
+    memcpy(out, INDEX_MAGIC, 8);
+    writeLe(out + 8, INDEX_VERSION, 4);
+    writeLe(out + 12, INDEX_RECORD_SIZE, 4);
+    writeLe(out + 16, header.wallClockStartMs, 8);
+    writeLe(out + 24, header.startUs, 8);
+}
+
+void writeRecord(const IndexRecord &record, char *out)
+{
+    writeLe(out, record.offset, 8);
+    writeLe(out + 8, record.size, 4);
+    writeLe(out + 12, 0, 4);
+    writeLe(out + 16, record.timestampUs, 8);
+}
+
+bool readHeader(const char *data, qsizetype size, IndexHeader &header)
+{
+    if (size < INDEX_HEADER_SIZE || memcmp(data, INDEX_MAGIC, 8) != 0
+        || readLe(data + 8, 4) != INDEX_VERSION
+        || readLe(data + 12, 4) != static_cast<quint64>(INDEX_RECORD_SIZE)) {
+        return false;
+    }
+    header.wallClockStartMs = readLe(data + 16, 8);
+    header.startUs = readLe(data + 24, 8);
+    return true;
+}
+
+IndexRecord readRecord(const char *data)
+{
+    IndexRecord record;
+    record.offset = readLe(data, 8);
+    record.size = static_cast<quint32>(readLe(data + 8, 4));
+    record.timestampUs = readLe(data + 16, 8);
+    return record;
+}
+
+QString indexPathFor(const QString &recordingPath)
+{
+    QFileInfo info(recordingPath);
+    return info.path() + '/' + info.completeBaseName() + ".idx";
+}
+
+} // namespace RecordingFormat
+
+StreamRecorder::StreamRecorder(QObject *parent)
+    : QObject(parent)
+    , m_fileOffset(0)
+    , m_fileGeneration(0)
+    , m_generation(0)
+    , m_recording(false)
+    , m_pendingBytes(0)
+    , m_scheduled(false)
+    , m_recordedFrames(0)
+    , m_recordedBytes(0)
+    , m_droppedFrames(0)
+{
+    m_thread.setObjectName("StreamRecorder");
+    m_context.moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+}
+
+StreamRecorder::~StreamRecorder()
+{
+    stop();
+
+    // Shutting down: wait for the files to be complete, then for the thread
+    QMetaObject::invokeMethod(&m_context, []() {}, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void StreamRecorder::start(const QString &path)
+{
+    stop();
+
+    m_path = path;
+    m_generation++;
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    m_recording.store(true, std::memory_order_release);
+
+    // Queued behind the close of any previous recording
+    QMetaObject::invokeMethod(&m_context, [this, path, generation = m_generation]() {
+        openFiles(path, generation);
+    }, Qt::QueuedConnection);
+}
+
+void StreamRecorder::openFiles(const QString &path, quint32 generation)
+{
+    m_file.setFileName(path);
+    m_indexFile.setFileName(RecordingFormat::indexPathFor(path));
+    QDir().mkpath(QFileInfo(path).path());
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || !m_indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        const QString message = m_file.isOpen() ? m_indexFile.errorString() : m_file.errorString();
+        qDebug() << "StreamRecorder: Cannot open" << path << message;
+        m_file.close();
+        m_indexFile.close();
+
+        // Back on the owning thread, unless a newer recording has been
+        // started meanwhile
+        QMetaObject::invokeMethod(this, [this, generation]() {
+            if (m_generation == generation) {
+                m_recording.store(false, std::memory_order_release);
+            }
+        }, Qt::QueuedConnection);
+        emit recordingFailed(path, message);
+        return;
+    }
+
+    RecordingFormat::IndexHeader header;
+    header.wallClockStartMs = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch());
+    header.startUs = RobotProtocol::timestampUs();
+    char headerBytes[RecordingFormat::INDEX_HEADER_SIZE];
+    RecordingFormat::writeHeader(header, headerBytes);
+    m_indexFile.write(headerBytes, RecordingFormat::INDEX_HEADER_SIZE);
+
+    // Reset here rather than in start() so the previous recording's last
+    // batch isn't counted towards this one
+    m_fileOffset = 0;
+    m_fileGeneration = generation;
+    m_recordedFrames.store(0, std::memory_order_relaxed);
+    m_recordedBytes.store(0, std::memory_order_relaxed);
+
+    qDebug() << "StreamRecorder: Recording to" << path;
+    emit recordingStarted(path);
+}
+
+void StreamRecorder::stop()
+{
+    if (!m_recording.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    // Frames queued so far belong to this recording, even if another one is
+    // started before the writer thread gets to them
+    std::vector<PendingFrame> remaining;
+    {
+        QMutexLocker locker(&m_mutex);
+        remaining.swap(m_pending);
+        m_pendingBytes = 0;
+    }
+
+    QMetaObject::invokeMethod(&m_context, [this, remaining = std::move(remaining)]() mutable {
+        m_batch.swap(remaining);
+        writeBatch();
+        const QString path = m_file.fileName();
+        const bool wasOpen = m_file.isOpen();
+        m_file.close();
+        m_indexFile.close();
+
+        if (wasOpen) {
+            qDebug() << "StreamRecorder: Stopped," << recordedFrames() << "frames,"
+                     << recordedBytes() << "bytes," << droppedFrames() << "dropped";
+            emit recordingStopped(path);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void StreamRecorder::append(const JpegFrame &frame, quint64 timestampUs)
+{
+    if (!isRecording() || frame.isNull()) {
+        return;
+    }
+
+    bool wake = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pendingBytes + frame.size > MAX_PENDING_BYTES) {
+            m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_pending.push_back({frame, timestampUs});
+        m_pendingBytes += frame.size;
+        wake = !m_scheduled;
+        m_scheduled = true;
+    }
+
+    if (wake) {
+        // Let a batch build up before touching the disk
+        QMetaObject::invokeMethod(&m_context, [this]() {
+            QTimer::singleShot(FLUSH_INTERVAL, &m_context, [this]() { writePending(); });
+        }, Qt::QueuedConnection);
+    }
+}
+
+void StreamRecorder::writePending()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_batch.swap(m_pending);
+        m_pendingBytes = 0;
+        m_scheduled = false;
+    }
+
+    writeBatch();
+}
+
+void StreamRecorder::writeBatch()
+{
+    if (m_batch.empty() || !m_file.isOpen()) {
+        m_batch.clear();
+        return;
+    }
+
+    m_indexBatch.resize(static_cast<qsizetype>(m_batch.size()) * RecordingFormat::INDEX_RECORD_SIZE);
+    char *record = m_indexBatch.data();
+    quint64 written = 0;
+    QString error;
+
+    for (const PendingFrame &pending : m_batch) {
+        if (m_file.write(pending.frame.data, pending.frame.size) != pending.frame.size) {
+            error = m_file.errorString();
+            break;
+        }
+
+        RecordingFormat::IndexRecord entry;
+        entry.offset = m_fileOffset;
+        entry.size = static_cast<quint32>(pending.frame.size);
+        entry.timestampUs = pending.timestampUs;
+        RecordingFormat::writeRecord(entry, record);
+        record += RecordingFormat::INDEX_RECORD_SIZE;
+
+        m_fileOffset += static_cast<quint64>(pending.frame.size);
+        written++;
+    }
+
+    // One index write per batch; index entries never point past the data
+    m_file.flush();
+    m_indexFile.write(m_indexBatch.constData(),
+                      static_cast<qint64>(written) * RecordingFormat::INDEX_RECORD_SIZE);
+    m_indexFile.flush();
+
+    m_recordedFrames.fetch_add(written, std::memory_order_relaxed);
+    m_recordedBytes.store(m_fileOffset, std::memory_order_relaxed);
+
+    // Release the stream storage the frames were referencing
+    m_batch.clear();
+
+    if (!error.isNull()) {
+        failRecording(error);
+    }
+}
+
+void StreamRecorder::failRecording(const QString &message)
+{
+    // Cut off the partly written frame so the recording ends on the last
+    // frame the index points at, then end it; later batches find the files
+    // closed and are discarded
+    qDebug() << "StreamRecorder: Write failed, recording ended:" << message;
+    m_file.resize(static_cast<qint64>(m_fileOffset));
+    m_file.close();
+    m_indexFile.close();
+
+    QMetaObject::invokeMethod(this, [this, generation = m_fileGeneration]() {
+        if (m_generation == generation) {
+            m_recording.store(false, std::memory_order_release);
+        }
+    }, Qt::QueuedConnection);
+    emit writeError(message);
+}
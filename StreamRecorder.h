@@ -0,0 +1,136 @@
+#ifndef STREAMRECORDER_H
+#define STREAMRECORDER_H
+
+#include <QObject>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <atomic>
+#include <vector>
+#include "StreamBuffer.h"
+
+// On-disk layout of a camera recording. The .mjpg file holds the JPEG frames
+// exactly as received, back to back, so any MJPEG player can open it. The
+// .idx file next to it starts with a 32-byte header followed by one 24-byte
+// record per frame; all fields are little-endian:
+//
+//   header  0  8  magic "RCMJIDX1"
+//           8  4  version (1)
+//          12  4  record size (24)
+//          16  8  wall-clock start time, ms since epoch
+//          24  8  monotonic start time, us (RobotProtocol::timestampUs)
+//
+//   record  0  8  offset of the frame in the .mjpg file
+//           8  4  frame size
+//          12  4  reserved (0)
+//          16  8  monotonic receive time, us
+namespace RecordingFormat {
+
+constexpr char INDEX_MAGIC[8] = { 'R', 'C', 'M', 'J', 'I', 'D', 'X', '1' };
+constexpr quint32 INDEX_VERSION = 1;
+constexpr qsizetype INDEX_HEADER_SIZE = 32;
+constexpr qsizetype INDEX_RECORD_SIZE = 24;
+
+struct IndexHeader {
+    quint64 wallClockStartMs = 0;
+    quint64 startUs = 0;
+};
+
+struct IndexRecord {
+    quint64 offset = 0;
+    quint32 size = 0;
+    quint64 timestampUs = 0;
+};
+
+void writeHeader(const IndexHeader &header, char *out);
+void writeRecord(const IndexRecord &record, char *out);
+bool readHeader(const char *data, qsizetype size, IndexHeader &header);
+IndexRecord readRecord(const char *data);
+
+// foo.mjpg -> foo.idx
+QString indexPathFor(const QString &recordingPath);
+
+} // namespace RecordingFormat
+
+// Writes camera frames to a recording without re-encoding them. append()
+// only queues a reference to the frame's stream storage; a writer thread
+// picks up everything queued every FLUSH_INTERVAL ms and writes it in one
+// batch. Files are opened and closed on the writer thread too, so no call
+// here waits for the disk. If the disk can't keep up, frames are dropped
+// rather than holding up the live view.
+class StreamRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamRecorder(QObject *parent = nullptr);
+    ~StreamRecorder();
+
+    // Starts recording to path and its index. Frames are queued at once;
+    // the files are opened on the writer thread, which emits
+    // recordingStarted() or, if either can't be created, recordingFailed().
+    void start(const QString &path);
+    // Writes what is queued and closes the files on the writer thread;
+    // recordingStopped() follows once they are complete
+    void stop();
+
+    bool isRecording() const { return m_recording.load(std::memory_order_acquire); }
+    QString path() const { return m_path; }
+
+    // Safe to call from any thread; never blocks on I/O
+    void append(const JpegFrame &frame, quint64 timestampUs);
+
+    quint64 recordedFrames() const { return m_recordedFrames.load(std::memory_order_relaxed); }
+    quint64 recordedBytes() const { return m_recordedBytes.load(std::memory_order_relaxed); }
+    quint64 droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+
+signals:
+    // Emitted on the writer thread
+    void recordingStarted(const QString &path);
+    void recordingFailed(const QString &path, const QString &message);
+    void recordingStopped(const QString &path);
+    // A write failed; the recording has been ended at the last whole frame
+    void writeError(const QString &message);
+
+private:
+    struct PendingFrame {
+        JpegFrame frame;
+        quint64 timestampUs;
+    };
+
+    void openFiles(const QString &path, quint32 generation);
+    void writePending();
+    void writeBatch();
+    void failRecording(const QString &message);
+
+    QThread m_thread;
+    QObject m_context; // Lives on m_thread; target for queued writes
+
+    // Only touched on the writer thread while recording
+    QFile m_file;
+    QFile m_indexFile;
+    quint64 m_fileOffset;
+    quint32 m_fileGeneration; // Of the recording the files belong to
+    std::vector<PendingFrame> m_batch;
+    QByteArray m_indexBatch;
+
+    // Owning thread only
+    QString m_path;
+    quint32 m_generation; // Bumped by every start()
+
+    std::atomic<bool> m_recording;
+
+    QMutex m_mutex;
+    std::vector<PendingFrame> m_pending;
+    qsizetype m_pendingBytes;
+    bool m_scheduled;
+
+    std::atomic<quint64> m_recordedFrames;
+    std::atomic<quint64> m_recordedBytes;
+    std::atomic<quint64> m_droppedFrames;
+
+    static const int FLUSH_INTERVAL = 200;                      // ms between batched writes
+    static constexpr qsizetype MAX_PENDING_BYTES = 32 * 1024 * 1024; // Drop frames beyond this
+};
+
+#endif // STREAMRECORDER_H
@@ -0,0 +1,223 @@
+#include "VideoSurface.h"
+#include <QQuickWindow>
+#include <QSGDynamicTexture>
+#include <QSGSimpleTextureNode>
+#include <QDebug>
+#include "RobotProtocol.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+#include <rhi/qrhi.h>
+
+namespace {
+
+// Texture that owns one QRhiTexture and re-uploads into it whenever a new
+// frame is set. The scene graph calls commitTextureOperations() while
+// preparing the frame, so the upload is recorded into the renderer's own
+// resource batch; the texture is only recreated when the frame size or
+// format changes.
+class VideoTexture : public QSGDynamicTexture
+{
+public:
+    ~VideoTexture() override
+    {
+        if (m_texture) {
+            m_texture->deleteLater();
+        }
+    }
+
+    void setFrame(const QImage &image)
+    {
+        m_pending = image;
+        m_dirty = true;
+    }
+
+    qint64 comparisonKey() const override { return qint64(reinterpret_cast<quintptr>(this)); }
+    QRhiTexture *rhiTexture() const override { return m_texture; }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return false; }
+    bool hasMipmaps() const override { return false; }
+
+    bool updateTexture() override
+    {
+        return m_dirty;
+    }
+
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override
+    {
+        if (!m_dirty || m_pending.isNull()) {
+            return;
+        }
+        m_dirty = false;
+
+        // RGB32 is BGRA in memory and uploads as is; anything else is
+        // converted once here
+        QRhiTexture::Format format = QRhiTexture::BGRA8;
+        QImage image = std::move(m_pending);
+        if (!rhi->isTextureFormatSupported(format)) {
+            format = QRhiTexture::RGBA8;
+            image = std::move(image).convertToFormat(QImage::Format_RGBA8888);
+        } else if (image.format() != QImage::Format_RGB32
+                   && image.format() != QImage::Format_ARGB32_Premultiplied) {
+            image = std::move(image).convertToFormat(QImage::Format_RGB32);
+        }
+
+        if (!m_texture || m_size != image.size() || m_format != format) {
+            if (m_texture) {
+                m_texture->deleteLater();
+            }
+            m_texture = rhi->newTexture(format, image.size());
+            if (!m_texture->create()) {
+                qDebug() << "VideoSurface: Failed to create texture" << image.size();
+                delete m_texture;
+                m_texture = nullptr;
+                return;
+            }
+            m_size = image.size();
+            m_format = format;
+        }
+
+        resourceUpdates->uploadTexture(m_texture, image);
+    }
+
+private:
+    QImage m_pending;
+    QRhiTexture *m_texture = nullptr;
+    QRhiTexture::Format m_format = QRhiTexture::UnknownFormat;
+    QSize m_size;
+    bool m_dirty = false;
+};
+
+} // namespace
+#endif
+
+VideoSurface::VideoSurface(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_frameSequence(0)
+    , m_frameDirty(false)
+    , m_unpresentedSequence(0)
+{
+    setFlag(ItemHasContents, true);
+    connect(this, &QQuickItem::smoothChanged, this, &QQuickItem::update);
+}
+
+void VideoSurface::setStreamer(MjpegStreamer *streamer)
+{
+    if (m_streamer == streamer) {
+        return;
+    }
+
+    if (m_streamer) {
+        disconnect(m_streamer, nullptr, this, nullptr);
+        disconnect(this, nullptr, m_streamer, nullptr);
+    }
+
+    m_streamer = streamer;
+
+    if (m_streamer) {
+        connect(m_streamer, &MjpegStreamer::newFrame, this, &VideoSurface::onNewFrame);
+        connect(this, &VideoSurface::framePresented, m_streamer, &MjpegStreamer::framePresented,
+                Qt::QueuedConnection);
+        setFrame(m_streamer->latestFrame(), m_streamer->latestFrameSequence());
+    } else {
+        setFrame(QImage(), 0);
+    }
+
+    emit streamerChanged();
+}
+
+void VideoSurface::clear()
+{
+    setFrame(QImage(), 0);
+}
+
+void VideoSurface::onNewFrame(const QImage &image)
+{
+    setFrame(image, m_streamer ? m_streamer->latestFrameSequence() : 0);
+}
+
+void VideoSurface::setFrame(const QImage &image, quint64 sequence)
+{
+    const bool hadFrame = hasFrame();
+    const QSize oldSize = m_frame.size();
+
+    // Shares the decoder's pixels; no copy is made until upload
+    m_frame = image;
+    m_frameSequence = sequence;
+    m_frameDirty = true;
+    update();
+
+    if (hadFrame != hasFrame()) {
+        emit hasFrameChanged();
+    }
+    if (oldSize != m_frame.size()) {
+        emit frameSizeChanged();
+    }
+}
+
+QSGNode *VideoSurface::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    auto *node = static_cast<QSGSimpleTextureNode *>(oldNode);
+
+    if (m_frame.isNull() || width() <= 0 || height() <= 0) {
+        delete node;
+        m_frameDirty = true; // Upload again once a node exists
+        return nullptr;
+    }
+
+    if (!node) {
+        node = new QSGSimpleTextureNode();
+        node->setOwnsTexture(true);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        node->setTexture(new VideoTexture());
+#endif
+    }
+
+    if (m_frameDirty) {
+        m_frameDirty = false;
+        m_unpresentedSequence = m_frameSequence;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        static_cast<VideoTexture *>(node->texture())->setFrame(m_frame);
+        node->markDirty(QSGNode::DirtyMaterial);
+#else
+        // Without the public RHI API a texture has to be created per frame
+        QSGTexture *previous = node->texture();
+        node->setTexture(window()->createTextureFromImage(m_frame));
+        delete previous;
+#endif
+    }
+
+    node->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+
+    // Letterbox the frame inside the item, like Image.PreserveAspectFit
+    QSizeF fitted = QSizeF(m_frame.size()).scaled(size(), Qt::KeepAspectRatio);
+    node->setRect(QRectF((width() - fitted.width()) / 2.0,
+                         (height() - fitted.height()) / 2.0,
+                         fitted.width(), fitted.height()));
+
+    return node;
+}
+
+void VideoSurface::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    if (change == ItemSceneChange) {
+        if (m_window) {
+            disconnect(m_window, &QQuickWindow::frameSwapped, this, nullptr);
+        }
+        m_window = value.window;
+        if (m_window) {
+            // Direct: the swap time is taken on the render thread itself
+            connect(m_window, &QQuickWindow::frameSwapped, this, &VideoSurface::onFrameSwapped,
+                    Qt::DirectConnection);
+        }
+    }
+    QQuickItem::itemChange(change, value);
+}
+
+void VideoSurface::onFrameSwapped()
+{
+    if (m_unpresentedSequence == 0) {
+        return;
+    }
+    emit framePresented(m_unpresentedSequence, RobotProtocol::timestampUs());
+    m_unpresentedSequence = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef VIDEOSURFACE_H
+#define VIDEOSURFACE_H
+
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QImage>
+#include <QPointer>
+#include "MjpegStreamer.h"
+
+// Scene graph item that shows the frames of an MjpegStreamer. Each decoded
+// frame is handed to the render thread by reference and uploaded into a
+// texture that is kept for the lifetime of the item; the item only repaints
+// when a new frame arrives. Once a frame has been swapped to the screen its
+// sequence number is reported back to the streamer for latency statistics.
+class VideoSurface : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(MjpegStreamer *streamer READ streamer WRITE setStreamer NOTIFY streamerChanged)
+    Q_PROPERTY(bool hasFrame READ hasFrame NOTIFY hasFrameChanged)
+    Q_PROPERTY(QSize frameSize READ frameSize NOTIFY frameSizeChanged)
+
+public:
+    explicit VideoSurface(QQuickItem *parent = nullptr);
+
+    MjpegStreamer *streamer() const { return m_streamer; }
+    void setStreamer(MjpegStreamer *streamer);
+
+    bool hasFrame() const { return !m_frame.isNull(); }
+    QSize frameSize() const { return m_frame.size(); }
+
+    // Drops the current frame, e.g. when the stream stops
+    Q_INVOKABLE void clear();
+
+signals:
+    void streamerChanged();
+    void hasFrameChanged();
+    void frameSizeChanged();
+
+    // Emitted on the render thread after the frame reached the screen
+    void framePresented(quint64 sequence, quint64 presentedUs);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+
+private slots:
+    void onNewFrame(const QImage &image);
+
+private:
+    void setFrame(const QImage &image, quint64 sequence);
+    void onFrameSwapped();
+
+    QPointer<MjpegStreamer> m_streamer;
+    QPointer<QQuickWindow> m_window;
+    QImage m_frame;
+    quint64 m_frameSequence;
+    bool m_frameDirty;
+
+    // Render thread only: frame synced into the scene graph, not yet swapped
+    quint64 m_unpresentedSequence;
+};
+
+#endif // VIDEOSURFACE_H
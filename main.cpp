@@ -1,4 +1,5 @@
 #include <QGuiApplication>
+#include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 
@@ -7,15 +8,32 @@
 #include <CarController.h>
 #include <ArmController.h>
 #include "MjpegStreamer.h"
+#include "VideoSurface.h"
+#include "SessionLog.h"
+#include "SessionReplay.h"
+#include "PoseEstimator.h"
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
 
+    // Reproducible control workloads, e.g. against tools/mock_robot:
+    //   appRC_GUI_NEW --replay-session drive.rcs --replay-speed 0 --exit-after-replay
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption recordOption("record-session", "Record control inputs and commands to a file.", "file");
+    QCommandLineOption replayOption("replay-session", "Replay a recorded session through the controllers.", "file");
+    QCommandLineOption replaySpeedOption("replay-speed", "Replay speed; 0 replays as fast as possible.", "x", "1");
+    QCommandLineOption exitOption("exit-after-replay", "Quit when the replay has finished.");
+    QCommandLineOption heartbeatOption("deadman-heartbeat", "Send the heartbeat for the robot's dead-man timer.");
+    parser.addOptions({recordOption, replayOption, replaySpeedOption, exitOption, heartbeatOption});
+    parser.process(app);
+
     qmlRegisterType<PathfindingEngine>("PathfindingEngine", 1, 0, "PathfindingEngine");
     qmlRegisterType<CarController>("CarController", 1, 0, "CarController");
     qmlRegisterType<ArmController>("ArmController", 1, 0, "ArmController");
     qmlRegisterType<MjpegStreamer>("CameraStream", 1, 0, "MjpegStreamer");
+    qmlRegisterType<VideoSurface>("CameraStream", 1, 0, "VideoSurface");
 
     QQmlApplicationEngine engine;
 
@@ -23,12 +41,24 @@ int main(int argc, char *argv[])
     CarController carController;
     ArmController armController;
 
+    SessionRecorder sessionRecorder;
+    sessionRecorder.attach(&carController);
+    sessionRecorder.attach(&armController);
+    SessionReplay sessionReplay;
+    sessionReplay.setControllers(&carController, &armController);
+    PoseEstimator poseEstimator;
+    poseEstimator.attach(&carController);
+
+    NetworkManager::instance()->setDeadmanHeartbeat(parser.isSet(heartbeatOption));
     engine.rootContext()->setContextProperty("networkManager", NetworkManager::instance());
     engine.rootContext()->setContextProperty("pathfindingEngine", &pathfindingEngine);
     engine.rootContext()->setContextProperty("carController", &carController);
     engine.rootContext()->setContextProperty("armController", &armController);
-    // Register the image provider
-    engine.addImageProvider("stream", MjpegStreamer::getImageProvider());
+    engine.rootContext()->setContextProperty("sessionRecorder", &sessionRecorder);
+    engine.rootContext()->setContextProperty("sessionReplay", &sessionReplay);
+    engine.rootContext()->setContextProperty("poseEstimator", &poseEstimator);
+    // Latest frame of each camera by stream ID: image://camera/<streamId>
+    engine.addImageProvider("camera", new StreamImageProvider());
 
     const QUrl url(QStringLiteral("qrc:/Main.qml"));
     QObject::connect(&engine, &QQmlApplicationEngine::objectCreated,
@@ -39,5 +69,19 @@ int main(int argc, char *argv[])
 
     engine.load(url);
 
+    if (parser.isSet(recordOption)) {
+        sessionRecorder.start(parser.value(recordOption));
+    }
+    if (parser.isSet(replayOption)) {
+        sessionReplay.setSpeed(parser.value(replaySpeedOption).toDouble());
+        if (parser.isSet(exitOption)) {
+            QObject::connect(&sessionReplay, &SessionReplay::finished, &app, &QCoreApplication::quit,
+                             Qt::QueuedConnection);
+        }
+        if (!sessionReplay.start(parser.value(replayOption)) && parser.isSet(exitOption)) {
+            return 1;
+        }
+    }
+
     return app.exec();
 }
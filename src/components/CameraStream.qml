@@ -1,6 +1,7 @@
 import QtQuick 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
+import QtQuick.Window 2.15
 import CameraStream 1.0
 
 Item {
@@ -8,17 +9,26 @@ Item {
 
     // Public properties that can be set from outside
     property string streamUrl: "http://192.168.4.1/stream"
+    property string streamId: "camera" // Unique per camera; see image://camera/<streamId>
     property bool autoConnect: true
     property bool showControls: true
     property bool showStatus: true
     property color backgroundColor: "black"
     property color borderColor: "gray"
     property int borderWidth: 2
+    property bool measureEndToEnd: false // Needs a camera that embeds timestamps
+    property bool adaptiveQuality: true  // Let the streamer lower camera resolution/quality under load
 
     // Read-only properties that external code can bind to
     readonly property bool connected: mjpegStreamer.connected
     readonly property string status: mjpegStreamer.status
     readonly property int frameRate: mjpegStreamer.frameRate
+    readonly property int decodedFrames: mjpegStreamer.decodedFrames
+    readonly property int droppedFrames: mjpegStreamer.droppedFrames
+    readonly property int queuedFrames: mjpegStreamer.queuedFrames
+    readonly property real latencyMs: mjpegStreamer.pipelineLatency
+    readonly property real endToEndLatencyMs: mjpegStreamer.endToEndLatency
+    readonly property bool recording: mjpegStreamer.recording
     readonly property alias streamer: mjpegStreamer
 
     // Signals that external code can connect to
@@ -43,30 +53,22 @@ Item {
         mjpegStreamer.url = url
     }
 
-    // Frame update timer to control refresh rate and reduce flicker
-    Timer {
-        id: frameUpdateTimer
-        interval: 33 // ~30 FPS max to prevent excessive updates
-        repeat: false
-        onTriggered: {
-            if (mjpegStreamer.connected) {
-                streamImage.source = ""
-                streamImage.source = "image://stream/frame"
-            }
-        }
+    // Let the streamer decode no larger than this view shows the stream
+    function updateConsumerSize() {
+        mjpegStreamer.setConsumerSize("view",
+                                      Math.ceil(videoSurface.width * Screen.devicePixelRatio),
+                                      Math.ceil(videoSurface.height * Screen.devicePixelRatio))
     }
 
     MjpegStreamer {
         id: mjpegStreamer
         url: root.streamUrl
+        streamId: root.streamId
+        adaptiveQuality: root.adaptiveQuality
+        measureEndToEnd: root.measureEndToEnd
 
-        onNewFrame: function(pixmap) {
-            root.frameReceived(pixmap)
-
-            // Only update image if timer is not running (throttle updates)
-            if (!frameUpdateTimer.running) {
-                frameUpdateTimer.start()
-            }
+        onNewFrame: function(image) {
+            root.frameReceived(image)
         }
 
         onConnectedChanged: {
@@ -75,11 +77,8 @@ Item {
                 root.errorOccurred(status)
             }
 
-            // Update image immediately on connection change
-            if (connected) {
-                streamImage.source = "image://stream/frame"
-            } else {
-                streamImage.source = ""
+            if (!connected) {
+                videoSurface.clear()
             }
         }
 
@@ -126,6 +125,46 @@ Item {
                 enabled: !mjpegStreamer.connected
                 onClicked: mjpegStreamer.reconnect()
             }
+
+            Button {
+                text: mjpegStreamer.recording ? "Stop Rec" : "Record"
+                onClicked: {
+                    if (mjpegStreamer.recording) {
+                        mjpegStreamer.stopRecording()
+                    } else {
+                        mjpegStreamer.startRecording()
+                    }
+                }
+            }
+        }
+
+        // Replay controls - only while a recording is playing
+        RowLayout {
+            Layout.fillWidth: true
+            visible: mjpegStreamer.replaying
+
+            Slider {
+                id: replaySlider
+                Layout.fillWidth: true
+                from: 0
+                to: Math.max(1, mjpegStreamer.replayDuration)
+                value: mjpegStreamer.replayPosition
+                onMoved: mjpegStreamer.seek(value)
+            }
+
+            Text {
+                text: (mjpegStreamer.replayPosition / 1000).toFixed(1) + " / "
+                      + (mjpegStreamer.replayDuration / 1000).toFixed(1) + " s"
+                font.pointSize: 9
+            }
+
+            ComboBox {
+                model: ["0.5x", "1x", "2x", "4x", "Max"]
+                currentIndex: 1
+                onActivated: function(index) {
+                    mjpegStreamer.replaySpeed = [0.5, 1, 2, 4, 0][index]
+                }
+            }
         }
 
         // Status bar - only visible if showStatus is true
@@ -153,6 +192,50 @@ Item {
                 visible: mjpegStreamer.connected
             }
 
+            Text {
+                text: "latency " + mjpegStreamer.pipelineLatency.toFixed(1)
+                      + " ms (±" + mjpegStreamer.pipelineJitter.toFixed(1) + ")"
+                      + (mjpegStreamer.endToEndLatency >= 0
+                         ? "  glass-to-glass " + mjpegStreamer.endToEndLatency.toFixed(1) + " ms" : "")
+                color: "gray"
+                font.pointSize: 9
+                visible: mjpegStreamer.connected
+            }
+
+            Text {
+                text: mjpegStreamer.ingestBandwidth.toFixed(0) + " KB/s"
+                      + (mjpegStreamer.adaptiveQuality ? "  " + mjpegStreamer.qualityDescription : "")
+                color: "gray"
+                font.pointSize: 9
+                visible: mjpegStreamer.connected && !mjpegStreamer.replaying
+            }
+
+            Text {
+                text: "decode " + mjpegStreamer.decodeLoad.toFixed(0) + "% cpu"
+                color: "gray"
+                font.pointSize: 9
+                visible: mjpegStreamer.connected
+            }
+
+            Text {
+                text: "decoded " + mjpegStreamer.decodedFrames
+                      + "  dropped " + mjpegStreamer.droppedFrames
+                      + "  queued " + mjpegStreamer.queuedFrames
+                color: "gray"
+                font.pointSize: 9
+                visible: mjpegStreamer.connected
+            }
+
+            Text {
+                text: "REC " + mjpegStreamer.recordedFrames + " frames, "
+                      + mjpegStreamer.recordedMegabytes.toFixed(1) + " MB"
+                      + (mjpegStreamer.recordingDroppedFrames > 0
+                         ? " (" + mjpegStreamer.recordingDroppedFrames + " dropped)" : "")
+                color: "red"
+                font.pointSize: 9
+                visible: mjpegStreamer.recording
+            }
+
             Item { Layout.fillWidth: true } // Spacer
         }
 
@@ -164,17 +247,16 @@ Item {
             border.color: root.borderColor
             border.width: root.borderWidth
 
-            Image {
-                id: streamImage
+            // Frames go straight from the decoder to a scene graph texture
+            VideoSurface {
+                id: videoSurface
                 anchors.fill: parent
                 anchors.margins: root.borderWidth + 2
-                fillMode: Image.PreserveAspectFit
-                cache: false
-                asynchronous: true
-                smooth: true // Enable smooth scaling
+                streamer: mjpegStreamer
+                smooth: true
 
-                // Use static source to prevent flicker
-                source: mjpegStreamer.connected ? "image://stream/frame" : ""
+                onWidthChanged: root.updateConsumerSize()
+                onHeightChanged: root.updateConsumerSize()
 
                 // Fallback content when no stream
                 Rectangle {
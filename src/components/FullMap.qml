@@ -16,6 +16,8 @@ Rectangle {
         showConnections: true
         showOptimalPath: true
         optimalPath: globalOptimalPath
+        robotPosition: poseEstimator.position
+        robotHeading: poseEstimator.heading
 
         Component.onCompleted: {
             initializePathfindingEngineLocal()
@@ -107,4 +107,34 @@ RowLayout {
             keyboardHandler.forceActiveFocus()
         }
     }
+
+    Button {
+        text: "Robot at Start"
+        enabled: !carController.followingPath && globalOptimalPath.length > 1
+        onClicked: {
+            // Dead reckoning starts from the route's first node, facing the second
+            var start = globalOptimalPath[0]
+            var next = globalOptimalPath[1]
+            for (var i = 2; i < globalOptimalPath.length && next.x === start.x && next.y === start.y; i++) {
+                next = globalOptimalPath[i]
+            }
+            poseEstimator.reset(start.x, start.y, Math.atan2(next.y - start.y, next.x - start.x))
+            keyboardHandler.forceActiveFocus()
+        }
+    }
+
+    Button {
+        text: carController.followingPath ? "Stop Following" : "Follow Path"
+        enabled: carController.followingPath || globalOptimalPath.length > 1
+        onClicked: {
+            if (carController.followingPath) {
+                carController.cancelPath()
+            } else if (carController.followPath(globalOptimalPath)) {
+                pathStatusText.text = "Following route"
+            } else {
+                pathStatusText.text = "Can't follow route"
+            }
+            keyboardHandler.forceActiveFocus()
+        }
+    }
 }
@@ -20,6 +20,8 @@ Rectangle {
         showConnections: false
         showOptimalPath: true
         optimalPath: globalOptimalPath
+        robotPosition: poseEstimator.position
+        robotHeading: poseEstimator.heading
 
         Connections {
             target: application
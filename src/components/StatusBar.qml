@@ -14,8 +14,56 @@ RowLayout {
 
     //StatusIndicator goes here
     StatusIndicator {
-        label: networkManager.isConnected ? "Car Connected" : "Car Disconnected"
-        labelColor: networkManager.isConnected ? "green" : "red"
-        circleColor: networkManager.isConnected ? "green" : "red"
+        readonly property int quality: networkManager.linkQuality
+        readonly property color qualityColor: quality >= 70 ? "green" : (quality >= 40 ? "orange" : "red")
+
+        label: "Link " + quality + "%  ("
+               + Math.round(networkManager.rttMs) + " ms, "
+               + Math.round(networkManager.packetLoss) + "% loss)"
+        labelColor: qualityColor
+        circleColor: qualityColor
+    }
+
+    Text {
+        text: "Requests: " + networkManager.requestsSent
+              + " (warm " + networkManager.warmRequests + ")"
+              + "  Connects: " + networkManager.connectionsOpened
+        color: networkManager.connectionWarm ? "green" : "#666666"
+        font.pointSize: 10
+    }
+
+    Text {
+        text: "Tick: " + carController.effectiveControlRate.toFixed(1) + " Hz"
+              + " (±" + carController.tickJitter.toFixed(1) + " ms"
+              + ", overruns " + carController.tickOverruns + ")"
+              + "  Suppressed: " + carController.suppressedCommands
+        color: carController.tickOverruns > 0 ? "orange" : "#666666"
+        font.pointSize: 10
+    }
+
+    Text {
+        text: "Controller: " + (carController.hardwareConnected ? carController.hardwarePort : "not connected")
+              + "  Gamepad: " + (carController.gamepadConnected ? carController.gamepadName : "none")
+        color: carController.hardwareConnected || carController.gamepadConnected ? "green" : "#666666"
+        font.pointSize: 10
+    }
+
+    Text {
+        visible: networkManager.inputLatencyMax > 0
+        text: "Input→send: " + networkManager.inputLatency.toFixed(1) + " ms"
+              + " (±" + networkManager.inputLatencyJitter.toFixed(1)
+              + ", max " + networkManager.inputLatencyMax.toFixed(1) + ")"
+        color: "#666666"
+        font.pointSize: 10
+    }
+
+    Text {
+        visible: networkManager.stopsAcknowledged > 0 || networkManager.stopRetries > 0
+        text: "Stop: " + networkManager.stopLatency.toFixed(1) + " ms"
+              + " (max " + networkManager.stopLatencyMax.toFixed(1)
+              + ", retries " + networkManager.stopRetries
+              + ", preempted " + networkManager.preemptedCommands + ")"
+        color: networkManager.stopRetries > 0 ? "orange" : "#666666"
+        font.pointSize: 10
     }
 }
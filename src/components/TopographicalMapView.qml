@@ -9,6 +9,7 @@ Item {
     property real scaleX: width / 500
     property real scaleY: height / 420
     property point robotPosition: Qt.point(50,50)
+    property real robotHeading: 0 // radians, clockwise from +x
     property var optimalPath: []
     property bool showConnections: true
     property bool showOptimalPath: false
@@ -211,8 +212,6 @@ Item {
             }
 
             drawNodes(ctx)
-
-            // drawRobot(ctx)
         }
 
         function drawNodes(ctx){
@@ -413,6 +412,34 @@ Item {
         }
     }
 
+    // Robot marker; moved by bindings so pose updates don't repaint the map
+    Item {
+        id: robotMarker
+        width: 16
+        height: 16
+        x: robotPosition.x * scaleX - width / 2
+        y: robotPosition.y * scaleY - height / 2
+        rotation: robotHeading * 180 / Math.PI
+        z: 999
+
+        Rectangle {
+            anchors.fill: parent
+            radius: 3
+            color: "#3498db"
+            border.color: "white"
+            border.width: 2
+        }
+
+        // Front of the robot
+        Rectangle {
+            width: parent.width / 2
+            height: 4
+            anchors.right: parent.right
+            anchors.verticalCenter: parent.verticalCenter
+            color: "white"
+        }
+    }
+
     // Tooltip
     Rectangle {
         id: tooltip
@@ -55,6 +55,7 @@ Page {
                             Layout.fillWidth: true
                             Layout.fillHeight: true
 
+                            streamId: "drive"
                             streamUrl: "http://192.168.4.1/stream"
                             autoConnect: true
                             showControls: true
@@ -80,6 +81,22 @@ Page {
                             }
                         }
 
+                        // Arm camera, decoded on the same pool as the drive camera
+                        CameraStream {
+                            Layout.fillWidth: true
+                            Layout.fillHeight: true
+
+                            streamId: "arm"
+                            streamUrl: "http://192.168.4.2/stream"
+                            autoConnect: false
+                            showControls: true
+                            showStatus: true
+
+                            onErrorOccurred: function(error) {
+                                console.log("Arm camera error:", error)
+                            }
+                        }
+
                     }
                 }
 
@@ -0,0 +1,146 @@
+#include <QGuiApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QPixmap>
+#include <QTextStream>
+
+#include "JpegDecoder.h"
+
+// Compares the old camera decode path (full QPixmap decode, then a smooth
+// scale to the view size) with DCT-scaled decoding at each scale factor.
+//
+//   ./decodeBench --size 1280x720 --target 320x180 --iterations 500
+//   ./decodeBench --jpeg frame.jpg --target 400x300
+
+namespace {
+
+QByteArray syntheticJpeg(const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0.0, Qt::darkBlue);
+    gradient.setColorAt(1.0, Qt::yellow);
+    painter.fillRect(image.rect(), gradient);
+    for (int x = 0; x < size.width(); x += 16) {
+        painter.fillRect(x, 0, 4, size.height(), QColor::fromHsv((x * 7) % 360, 200, 220));
+    }
+    painter.end();
+
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "JPEG");
+    writer.setQuality(80);
+    writer.write(image);
+    return jpeg;
+}
+
+template <typename Fn>
+double timePerFrameMs(int iterations, Fn fn)
+{
+    fn(); // Warm up caches and plugin loading
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    return timer.nsecsElapsed() / 1e6 / iterations;
+}
+
+QSize parseSize(const QString &text, const QSize &fallback)
+{
+    const QStringList parts = text.split('x');
+    if (parts.size() != 2) {
+        return fallback;
+    }
+    return QSize(parts[0].toInt(), parts[1].toInt());
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Camera JPEG decode benchmark");
+    parser.addHelpOption();
+    QCommandLineOption jpegOption("jpeg", "JPEG file to decode instead of a synthetic frame.", "file");
+    QCommandLineOption sizeOption("size", "Synthetic frame size.", "WxH", "1280x720");
+    QCommandLineOption targetOption("target", "Display size the frame is shown at.", "WxH", "320x180");
+    QCommandLineOption iterationsOption("iterations", "Decodes per measurement.", "n", "200");
+    parser.addOptions({jpegOption, sizeOption, targetOption, iterationsOption});
+    parser.process(app);
+
+    QByteArray jpeg;
+    if (parser.isSet(jpegOption)) {
+        QFile file(parser.value(jpegOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not open" << file.fileName();
+            return 1;
+        }
+        jpeg = file.readAll();
+    } else {
+        jpeg = syntheticJpeg(parseSize(parser.value(sizeOption), QSize(1280, 720)));
+    }
+
+    const QSize target = parseSize(parser.value(targetOption), QSize(320, 180));
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const uchar *data = reinterpret_cast<const uchar *>(jpeg.constData());
+
+    QTextStream out(stdout);
+    const QImage reference = QImage::fromData(jpeg, "JPEG");
+    out << "Frame " << reference.width() << 'x' << reference.height()
+        << ", " << jpeg.size() << " bytes, target " << target.width() << 'x' << target.height()
+        << ", libjpeg " << (JpegDecoder::hasLibjpeg() ? "yes" : "no (Qt reader fallback)") << "\n\n";
+
+    out << qSetFieldWidth(28) << Qt::left << "path" << qSetFieldWidth(12) << Qt::right
+        << "ms/frame" << "output" << "bytes" << qSetFieldWidth(0) << '\n';
+
+    auto report = [&](const QString &name, double ms, const QImage &image) {
+        out << qSetFieldWidth(28) << Qt::left << name << qSetFieldWidth(12) << Qt::right
+            << QString::number(ms, 'f', 3)
+            << QString("%1x%2").arg(image.width()).arg(image.height())
+            << image.sizeInBytes() << qSetFieldWidth(0) << '\n';
+    };
+
+    // The path MjpegStreamer and StreamImageProvider used before
+    QPixmap scaledPixmap;
+    double pixmapMs = timePerFrameMs(iterations, [&]() {
+        QPixmap pixmap;
+        pixmap.loadFromData(data, static_cast<uint>(jpeg.size()), "JPEG");
+        scaledPixmap = pixmap.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    });
+    report("QPixmap + smooth scale", pixmapMs, scaledPixmap.toImage());
+
+    QImage fullImage;
+    double fullMs = timePerFrameMs(iterations, [&]() {
+        fullImage = JpegDecoder::decode(data, jpeg.size(), QSize());
+    });
+    report("JpegDecoder full size", fullMs, fullImage);
+
+    QImage scaledImage;
+    int scale = 1;
+    double scaledMs = timePerFrameMs(iterations, [&]() {
+        scaledImage = JpegDecoder::decode(data, jpeg.size(), target, &scale);
+    });
+    report(QString("JpegDecoder for target 1/%1").arg(scale), scaledMs, scaledImage);
+
+    out << "\nSpeed-up over the QPixmap path: "
+        << QString::number(pixmapMs / scaledMs, 'f', 1) << "x, memory "
+        << QString::number(double(reference.sizeInBytes()) / qMax<qsizetype>(1, scaledImage.sizeInBytes()), 'f', 1)
+        << "x smaller than a full decode\n";
+
+    return 0;
+}
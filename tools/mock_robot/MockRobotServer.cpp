@@ -0,0 +1,619 @@
+#include "MockRobotServer.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QImage>
+#include <QImageWriter>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QUrlQuery>
+
+MockRobotServer::MockRobotServer(const MockRobotConfig &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_server(new QTcpServer(this))
+    , m_streamTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+    , m_deadmanTimer(new QTimer(this))
+    , m_rng(std::random_device{}())
+    , m_nextFrame(0)
+    , m_commandsReceived(0)
+    , m_commandsDropped(0)
+    , m_framesSent(0)
+    , m_framesSkipped(0)
+    , m_heartbeats(0)
+    , m_deadmanStops(0)
+    , m_lastSequence(0)
+    , m_outOfOrder(0)
+    , m_sequenceGaps(0)
+    , m_badPackets(0)
+    , m_latencySumUs(0)
+    , m_latencySamples(0)
+    , m_leftMotor(0)
+    , m_rightMotor(0)
+{
+    m_clock.start();
+
+    connect(m_server, &QTcpServer::newConnection, this, &MockRobotServer::onNewConnection);
+
+    m_streamTimer->setTimerType(Qt::PreciseTimer);
+    m_streamTimer->setInterval(1000 / qMax(1, m_config.frameRate));
+    connect(m_streamTimer, &QTimer::timeout, this, &MockRobotServer::sendStreamFrame);
+
+    m_statsTimer->setInterval(1000);
+    connect(m_statsTimer, &QTimer::timeout, this, &MockRobotServer::printStatistics);
+
+    // Armed by the first heartbeat, so clients without one still work
+    m_deadmanTimer->setTimerType(Qt::PreciseTimer);
+    m_deadmanTimer->setSingleShot(true);
+    m_deadmanTimer->setInterval(m_config.deadmanTimeoutMs);
+    connect(m_deadmanTimer, &QTimer::timeout, this, &MockRobotServer::onDeadmanTimeout);
+}
+
+bool MockRobotServer::start()
+{
+    if (!m_config.logPath.isEmpty()) {
+        m_logFile.setFileName(m_config.logPath);
+        if (!m_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            qWarning() << "MockRobot: Could not open log file" << m_config.logPath;
+            return false;
+        }
+        m_log.setDevice(&m_logFile);
+    } else {
+        m_logFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+        m_log.setDevice(&m_logFile);
+    }
+
+    if (!m_config.recordingPath.isEmpty()) {
+        if (!loadRecording(m_config.recordingPath)) {
+            return false;
+        }
+    } else {
+        generateSyntheticFrames();
+    }
+
+    if (!m_server->listen(QHostAddress::Any, m_config.port)) {
+        qWarning() << "MockRobot: Could not listen on port" << m_config.port
+                   << m_server->errorString();
+        return false;
+    }
+
+    qInfo() << "MockRobot: Listening on port" << m_server->serverPort()
+            << "with" << m_frames.size() << "stream frames"
+            << "latency" << m_config.latencyMs << "ms jitter" << m_config.jitterMs << "ms"
+            << "loss" << m_config.lossRate * 100.0 << "%"
+            << "bandwidth" << m_config.bandwidthKBps << "KB/s"
+            << "dead-man" << m_config.deadmanTimeoutMs << "ms";
+
+    m_streamTimer->start();
+    m_statsTimer->start();
+    return true;
+}
+
+void MockRobotServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_clients.insert(socket, ClientState());
+
+        connect(socket, &QTcpSocket::readyRead, this, &MockRobotServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &MockRobotServer::onDisconnected);
+    }
+}
+
+void MockRobotServer::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+
+    m_clients.remove(socket);
+    socket->deleteLater();
+}
+
+void MockRobotServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_clients.contains(socket)) {
+        return;
+    }
+
+    ClientState &client = m_clients[socket];
+    client.buffer.append(socket->readAll());
+
+    // Stream clients never send anything meaningful after the request
+    if (client.streaming) {
+        client.buffer.clear();
+        return;
+    }
+
+    Request request;
+    while (parseRequest(client.buffer, request)) {
+        handleRequest(socket, request);
+        if (!m_clients.contains(socket) || m_clients[socket].streaming) {
+            break;
+        }
+    }
+
+    if (m_clients.contains(socket) && m_clients[socket].buffer.size() > MAX_REQUEST_SIZE) {
+        qWarning() << "MockRobot: Request too large, closing connection";
+        socket->abort();
+    }
+}
+
+bool MockRobotServer::parseRequest(QByteArray &buffer, Request &request)
+{
+    int headerEnd;
+    int contentLength;
+    for (;;) {
+        headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return false;
+        }
+
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            // Drop the malformed request; any pipelined behind it are still served
+            qWarning() << "MockRobot: Malformed request line" << lines.first().trimmed();
+            buffer.remove(0, headerEnd + 4);
+            continue;
+        }
+
+        request = Request();
+        request.method = requestLine[0];
+        request.path = requestLine[1];
+        if (requestLine.size() > 2 && requestLine[2] == "HTTP/1.0") {
+            request.keepAlive = false;
+        }
+
+        contentLength = 0;
+        bool validLength = true;
+        for (int i = 1; i < lines.size(); ++i) {
+            const QByteArray line = lines[i].trimmed();
+            int colon = line.indexOf(':');
+            if (colon < 0) {
+                continue;
+            }
+
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            const QByteArray value = line.mid(colon + 1).trimmed();
+
+            if (name == "content-length") {
+                contentLength = value.toInt(&validLength);
+                validLength = validLength && contentLength >= 0;
+                if (!validLength) {
+                    qWarning() << "MockRobot: Malformed Content-Length" << value;
+                    break;
+                }
+            } else if (name == "content-type") {
+                request.contentType = value;
+            } else if (name == "connection") {
+                request.keepAlive = value.toLower() != "close";
+            }
+        }
+
+        if (validLength) {
+            break;
+        }
+
+        // Where the body would end is unknown; drop the headers like a bad
+        // request line
+        buffer.remove(0, headerEnd + 4);
+    }
+
+    int bodyStart = headerEnd + 4;
+    if (buffer.size() - bodyStart < contentLength) {
+        return false; // Wait for the rest of the body
+    }
+
+    request.body = buffer.mid(bodyStart, contentLength);
+    buffer.remove(0, bodyStart + contentLength);
+    return true;
+}
+
+void MockRobotServer::handleRequest(QTcpSocket *socket, const Request &request)
+{
+    const QByteArray path = request.path.left(request.path.indexOf('?'));
+
+    if (path == "/stream" && request.method == "GET") {
+        startStreaming(socket);
+    } else if ((path == "/setSpeed" || path == "/setServo") && request.method == "POST") {
+        handleCommand(socket, request);
+    } else if (path == "/control" && request.method == "GET") {
+        handleControl(socket, request);
+    } else if (path == "/heartbeat" && request.method == "GET") {
+        m_heartbeats++;
+        if (m_config.deadmanTimeoutMs > 0) {
+            m_deadmanTimer->start();
+        }
+        sendResponse(socket, 200, "OK", "", request.keepAlive);
+    } else if (path == "/") {
+        // Keep-alive probes and browsers
+        sendResponse(socket, 200, "OK", "Mock robot\n", request.keepAlive,
+                     request.method == "HEAD");
+    } else {
+        sendResponse(socket, 404, "Not Found", "Not found\n", request.keepAlive,
+                     request.method == "HEAD");
+    }
+}
+
+void MockRobotServer::handleCommand(QTcpSocket *socket, const Request &request)
+{
+    m_commandsReceived++;
+
+    if (request.contentType == "application/octet-stream") {
+        if (!applyBinaryCommand(request)) {
+            sendResponse(socket, 400, "Bad Request", "Bad packet\n", request.keepAlive);
+            return;
+        }
+    } else {
+        logCommand(request);
+        applyLegacyCommand(request);
+    }
+
+    int delay = m_config.latencyMs;
+    if (m_config.jitterMs > 0) {
+        delay += std::uniform_int_distribution<int>(0, m_config.jitterMs)(m_rng);
+    }
+
+    bool drop = m_config.lossRate > 0.0
+                && std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < m_config.lossRate;
+    bool keepAlive = request.keepAlive;
+
+    auto reply = [this, socket, drop, keepAlive]() {
+        if (drop) {
+            // A lost command looks like a dead connection to the client
+            m_commandsDropped++;
+            socket->abort();
+        } else {
+            sendResponse(socket, 200, "OK", "OK", keepAlive);
+        }
+    };
+
+    if (delay > 0) {
+        QTimer::singleShot(delay, socket, reply);
+    } else {
+        reply();
+    }
+}
+
+void MockRobotServer::handleControl(QTcpSocket *socket, const Request &request)
+{
+    // Same variables and framesize_t values as the ESP32-CAM web server
+    static const struct { int framesize; int width; int height; } FRAME_SIZES[] = {
+        { 0, 96, 96 }, { 1, 160, 120 }, { 2, 176, 144 }, { 3, 240, 176 }, { 4, 240, 240 },
+        { 5, 320, 240 }, { 6, 400, 296 }, { 7, 480, 320 }, { 8, 640, 480 }, { 9, 800, 600 },
+        { 10, 1024, 768 }, { 11, 1280, 720 }, { 12, 1280, 1024 }, { 13, 1600, 1200 },
+    };
+
+    const QUrlQuery query(QString::fromLatin1(request.path.mid(request.path.indexOf('?') + 1)));
+    const QString variable = query.queryItemValue("var");
+    bool ok = false;
+    const int value = query.queryItemValue("val").toInt(&ok);
+
+    bool applied = false;
+    if (ok && variable == "framesize") {
+        for (const auto &size : FRAME_SIZES) {
+            if (size.framesize == value) {
+                m_config.frameWidth = size.width;
+                m_config.frameHeight = size.height;
+                applied = true;
+            }
+        }
+    } else if (ok && variable == "quality" && value >= 10 && value <= 63) {
+        m_config.jpegQuality = value;
+        applied = true;
+    }
+
+    if (!applied) {
+        sendResponse(socket, 400, "Bad Request", "Unknown control\n", request.keepAlive);
+        return;
+    }
+
+    qInfo() << "MockRobot: Camera" << variable << "=" << value
+            << "->" << m_config.frameWidth << "x" << m_config.frameHeight
+            << "quality" << m_config.jpegQuality;
+
+    // A recording is streamed as recorded; only synthetic frames follow the settings
+    if (m_config.recordingPath.isEmpty()) {
+        m_frames.clear();
+        m_nextFrame = 0;
+        generateSyntheticFrames();
+    }
+
+    sendResponse(socket, 200, "OK", "", request.keepAlive);
+}
+
+void MockRobotServer::startStreaming(QTcpSocket *socket)
+{
+    ClientState &client = m_clients[socket];
+    client.streaming = true;
+    client.tokens = 0;
+
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Connection: keep-alive\r\n"
+                  "\r\n");
+
+    qInfo() << "MockRobot: Stream client connected from" << socket->peerAddress().toString();
+}
+
+void MockRobotServer::sendStreamFrame()
+{
+    if (m_frames.isEmpty()) {
+        return;
+    }
+
+    const QByteArray &frame = m_frames.at(m_nextFrame);
+    m_nextFrame = (m_nextFrame + 1) % m_frames.size();
+
+    // The capture timestamp goes right after SOI; the rest of the frame is
+    // written from the pre-encoded buffer as is
+    const QByteArray timestamp = m_config.embedTimestamps
+        ? RobotProtocol::cameraTimestampSegment(RobotProtocol::timestampUs())
+        : QByteArray();
+    const qint64 frameSize = frame.size() + timestamp.size();
+
+    const QByteArray header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: "
+                              + QByteArray::number(frameSize) + "\r\n\r\n";
+    const qint64 partSize = header.size() + frameSize + 2;
+
+    const qint64 refill = static_cast<qint64>(m_config.bandwidthKBps) * 1024 * m_streamTimer->interval() / 1000;
+    const qint64 maxTokens = static_cast<qint64>(m_config.bandwidthKBps) * 1024;
+
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        if (!it.value().streaming) {
+            continue;
+        }
+
+        QTcpSocket *socket = it.key();
+        ClientState &client = it.value();
+
+        // Like a real camera, skip frames instead of queueing them when the
+        // client or the bandwidth limit can't keep up
+        bool clientBehind = socket->bytesToWrite() > 2 * partSize;
+        bool overBudget = false;
+        if (m_config.bandwidthKBps > 0) {
+            client.tokens = qMin(client.tokens + refill, maxTokens);
+            overBudget = client.tokens < partSize;
+        }
+
+        if (clientBehind || overBudget) {
+            m_framesSkipped++;
+            continue;
+        }
+
+        if (m_config.bandwidthKBps > 0) {
+            client.tokens -= partSize;
+        }
+
+        socket->write(header);
+        if (timestamp.isEmpty()) {
+            socket->write(frame);
+        } else {
+            socket->write(frame.constData(), 2);
+            socket->write(timestamp);
+            socket->write(frame.constData() + 2, frame.size() - 2);
+        }
+        socket->write("\r\n");
+        m_framesSent++;
+    }
+}
+
+void MockRobotServer::sendResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                                   const QByteArray &body, bool keepAlive, bool headOnly)
+{
+    if (socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n"
+                          "Content-Type: text/plain\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n"
+                          "\r\n";
+    if (!headOnly) {
+        response += body;
+    }
+
+    socket->write(response);
+
+    if (!keepAlive) {
+        socket->disconnectFromHost();
+    }
+}
+
+void MockRobotServer::logCommand(const Request &request)
+{
+    if (!m_config.logRequests) {
+        return;
+    }
+
+    m_log << QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+          << ' ' << m_clock.nsecsElapsed() / 1000 << "us "
+          << request.method << ' ' << request.path << ' '
+          << request.contentType << ' ' << request.body << '\n';
+    m_log.flush();
+}
+
+bool MockRobotServer::applyBinaryCommand(const Request &request)
+{
+    RobotProtocol::Command command;
+    RobotProtocol::PacketHeader header;
+    if (!RobotProtocol::decode(request.body.constData(), static_cast<std::size_t>(request.body.size()),
+                               command, header)) {
+        m_badPackets++;
+        return false;
+    }
+
+    qint64 latencyUs = static_cast<qint64>(RobotProtocol::timestampUs() - header.timestampUs);
+
+    // Anything not newer than the last applied command is stale
+    bool stale = m_lastSequence != 0 && static_cast<qint32>(header.sequence - m_lastSequence) <= 0;
+    if (stale) {
+        m_outOfOrder++;
+    } else {
+        if (m_lastSequence != 0) {
+            m_sequenceGaps += static_cast<int>(header.sequence - m_lastSequence - 1);
+        }
+        m_lastSequence = header.sequence;
+        m_latencySumUs += latencyUs;
+        m_latencySamples++;
+
+        if (command.type == RobotProtocol::CommandType::Stop) {
+            setMotors(0, 0);
+        } else if (command.type == RobotProtocol::CommandType::Drive) {
+            setMotors(command.values[0], command.values[1]);
+        }
+    }
+
+    if (m_config.logRequests) {
+        m_log << QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+              << ' ' << m_clock.nsecsElapsed() / 1000 << "us "
+              << request.method << ' ' << request.path
+              << " seq=" << header.sequence
+              << " one-way=" << latencyUs << "us"
+              << (stale ? " STALE " : " ")
+              << RobotProtocol::describe(command) << '\n';
+        m_log.flush();
+    }
+    return true;
+}
+
+void MockRobotServer::applyLegacyCommand(const Request &request)
+{
+    // "plain=<left> <right>", as the firmware reads it for drive and stop
+    if (!request.path.startsWith("/setSpeed")) {
+        return;
+    }
+    const QUrlQuery query(QString::fromLatin1(request.body));
+    const QStringList speeds = query.queryItemValue("plain").split(' ');
+    if (speeds.size() == 2) {
+        setMotors(speeds[0].toInt(), speeds[1].toInt());
+    }
+}
+
+void MockRobotServer::setMotors(int left, int right)
+{
+    m_leftMotor = left;
+    m_rightMotor = right;
+}
+
+void MockRobotServer::onDeadmanTimeout()
+{
+    qInfo() << "MockRobot: No heartbeat for" << m_config.deadmanTimeoutMs << "ms"
+            << (m_leftMotor != 0 || m_rightMotor != 0 ? "- dead-man stop" : "- motors already stopped");
+
+    if (m_leftMotor != 0 || m_rightMotor != 0) {
+        setMotors(0, 0);
+        m_deadmanStops++;
+    }
+}
+
+void MockRobotServer::printStatistics()
+{
+    int streamClients = 0;
+    for (const ClientState &client : std::as_const(m_clients)) {
+        if (client.streaming) {
+            streamClients++;
+        }
+    }
+
+    qInfo().noquote() << QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+                      << "commands/s:" << m_commandsReceived
+                      << "dropped:" << m_commandsDropped
+                      << "seq gaps:" << m_sequenceGaps
+                      << "stale:" << m_outOfOrder
+                      << "bad:" << m_badPackets
+                      << "one-way us:" << (m_latencySamples > 0 ? m_latencySumUs / m_latencySamples : 0)
+                      << "frames/s:" << m_framesSent
+                      << "skipped:" << m_framesSkipped
+                      << "heartbeats/s:" << m_heartbeats
+                      << "dead-man stops:" << m_deadmanStops
+                      << "connections:" << m_clients.size()
+                      << "streaming:" << streamClients;
+
+    m_commandsReceived = 0;
+    m_commandsDropped = 0;
+    m_sequenceGaps = 0;
+    m_outOfOrder = 0;
+    m_badPackets = 0;
+    m_latencySumUs = 0;
+    m_latencySamples = 0;
+    m_framesSent = 0;
+    m_framesSkipped = 0;
+    m_heartbeats = 0;
+}
+
+bool MockRobotServer::loadRecording(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "MockRobot: Could not open recording" << path;
+        return false;
+    }
+
+    // Split concatenated JPEGs (or a captured multipart stream) on SOI/EOI
+    const QByteArray data = file.readAll();
+    const QByteArray soi("\xFF\xD8", 2);
+    const QByteArray eoi("\xFF\xD9", 2);
+
+    qsizetype pos = 0;
+    while (true) {
+        qsizetype start = data.indexOf(soi, pos);
+        if (start < 0) {
+            break;
+        }
+        qsizetype end = data.indexOf(eoi, start + 2);
+        if (end < 0) {
+            break;
+        }
+        m_frames.append(data.mid(start, end + 2 - start));
+        pos = end + 2;
+    }
+
+    if (m_frames.isEmpty()) {
+        qWarning() << "MockRobot: No JPEG frames found in" << path;
+        return false;
+    }
+    return true;
+}
+
+void MockRobotServer::generateSyntheticFrames()
+{
+    // Encode a short looping animation up front so the stream loop only
+    // writes bytes and can sustain high frame rates
+    const int width = m_config.frameWidth;
+    const int height = m_config.frameHeight;
+
+    for (int i = 0; i < SYNTHETIC_FRAME_COUNT; ++i) {
+        QImage image(width, height, QImage::Format_RGB32);
+        QPainter painter(&image);
+
+        QLinearGradient gradient(0, 0, width, height);
+        gradient.setColorAt(0.0, QColor::fromHsv((i * 12) % 360, 160, 200));
+        gradient.setColorAt(1.0, QColor::fromHsv((i * 12 + 180) % 360, 160, 80));
+        painter.fillRect(image.rect(), gradient);
+
+        // Moving bar so dropped or repeated frames are visible
+        int barWidth = width / 10;
+        int barX = (width - barWidth) * i / (SYNTHETIC_FRAME_COUNT - 1);
+        painter.fillRect(barX, 0, barWidth, height, Qt::white);
+        painter.end();
+
+        QByteArray jpeg;
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        QImageWriter writer(&buffer, "JPEG");
+        // Map the camera's 10-63 scale (lower is better) onto Qt's 0-100
+        writer.setQuality(qBound(5, 85 - (m_config.jpegQuality - 10) * 80 / 53, 95));
+        if (!writer.write(image)) {
+            qWarning() << "MockRobot: JPEG encoding failed:" << writer.errorString();
+            continue;
+        }
+        m_frames.append(jpeg);
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef MOCKROBOTSERVER_H
+#define MOCKROBOTSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QFile>
+#include <QTextStream>
+#include <random>
+#include "RobotProtocol.h"
+
+// Fault injection and stream settings for the mock robot
+struct MockRobotConfig {
+    quint16 port = 8080;
+    int latencyMs = 0;          // Added before every command reply
+    int jitterMs = 0;           // Uniform random extra latency, 0..jitterMs
+    double lossRate = 0.0;      // Fraction of commands whose connection is dropped
+    int bandwidthKBps = 0;      // Stream bandwidth cap, 0 = unlimited
+    int frameRate = 30;
+    int frameWidth = 640;
+    int frameHeight = 480;
+    int jpegQuality = 12;       // ESP32-CAM scale: 10 (best) - 63
+    QString recordingPath;      // Recorded MJPEG to replay instead of synthetic frames
+    bool embedTimestamps = true; // Send time in a COM segment of every frame
+    QString logPath;            // Command log file, empty = stdout
+    bool logRequests = true;    // Disable for load tests; per-second totals are still printed
+    int deadmanTimeoutMs = 300; // Stop the motors when heartbeats stop for this long, 0 = off
+};
+
+// Stand-in for the ESP32 on the robot. Serves /setSpeed, /setServo and
+// /stream over HTTP/1.1 with keep-alive, logs every received command with a
+// timestamp, and can inject latency, loss and a bandwidth limit. Binary
+// commands are checked for sequence order like the firmware would, and their
+// one-way latency is measured (client and mock share the host's clock).
+// /control?var=framesize|quality&val=N changes the synthetic stream like the
+// ESP32-CAM camera settings do. Once a client sends GET /heartbeat, a
+// dead-man timer stops the motors if the heartbeats stop.
+class MockRobotServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MockRobotServer(const MockRobotConfig &config, QObject *parent = nullptr);
+
+    bool start();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void sendStreamFrame();
+    void printStatistics();
+    void onDeadmanTimeout();
+
+private:
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        QByteArray contentType;
+        QByteArray body;
+        bool keepAlive = true;
+    };
+
+    struct ClientState {
+        QByteArray buffer;
+        bool streaming = false;
+        qint64 tokens = 0; // Bandwidth budget in bytes
+    };
+
+    bool parseRequest(QByteArray &buffer, Request &request);
+    void handleRequest(QTcpSocket *socket, const Request &request);
+    void handleCommand(QTcpSocket *socket, const Request &request);
+    void startStreaming(QTcpSocket *socket);
+    void handleControl(QTcpSocket *socket, const Request &request);
+    void sendResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                      const QByteArray &body, bool keepAlive, bool headOnly = false);
+    void logCommand(const Request &request);
+    bool applyBinaryCommand(const Request &request);
+    void applyLegacyCommand(const Request &request);
+    void setMotors(int left, int right);
+
+    bool loadRecording(const QString &path);
+    void generateSyntheticFrames();
+
+    MockRobotConfig m_config;
+    QTcpServer *m_server;
+    QTimer *m_streamTimer;
+    QTimer *m_statsTimer;
+    QTimer *m_deadmanTimer;
+    QElapsedTimer m_clock;
+    std::mt19937 m_rng;
+
+    QHash<QTcpSocket*, ClientState> m_clients;
+
+    // Pre-encoded JPEG frames, cycled through by the stream timer
+    QList<QByteArray> m_frames;
+    int m_nextFrame;
+
+    QFile m_logFile;
+    QTextStream m_log;
+
+    // Per-second totals
+    int m_commandsReceived;
+    int m_commandsDropped;
+    int m_framesSent;
+    int m_framesSkipped;
+    int m_heartbeats;
+    int m_deadmanStops;
+
+    // Binary command tracking, as the robot firmware does it
+    quint32 m_lastSequence;
+    int m_outOfOrder;
+    int m_sequenceGaps;
+    int m_badPackets;
+    qint64 m_latencySumUs;
+    int m_latencySamples;
+
+    // Motor state as last commanded
+    int m_leftMotor;
+    int m_rightMotor;
+
+    static const int MAX_REQUEST_SIZE = 64 * 1024;
+    static const int SYNTHETIC_FRAME_COUNT = 30;
+};
+
+#endif // MOCKROBOTSERVER_H
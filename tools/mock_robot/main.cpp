@@ -0,0 +1,63 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+
+#include "MockRobotServer.h"
+
+int main(int argc, char *argv[])
+{
+    // Frames are rendered off-screen; no display is needed
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("mockRobot");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mock ESP32 robot serving /setSpeed, /setServo and /stream");
+    parser.addHelpOption();
+
+    QCommandLineOption portOption({"p", "port"}, "Port to listen on.", "port", "8080");
+    QCommandLineOption latencyOption("latency", "Added latency per command reply.", "ms", "0");
+    QCommandLineOption jitterOption("jitter", "Random extra latency per command reply.", "ms", "0");
+    QCommandLineOption lossOption("loss", "Percentage of commands to drop.", "percent", "0");
+    QCommandLineOption bandwidthOption("bandwidth", "Stream bandwidth limit, 0 = unlimited.", "KB/s", "0");
+    QCommandLineOption fpsOption("fps", "Stream frame rate.", "fps", "30");
+    QCommandLineOption sizeOption("size", "Synthetic frame size.", "WxH", "640x480");
+    QCommandLineOption recordingOption("mjpeg", "Recorded MJPEG file to stream.", "file");
+    QCommandLineOption logOption("log", "Write the command log to a file.", "file");
+    QCommandLineOption quietOption({"q", "quiet"}, "Don't log individual commands.");
+    QCommandLineOption noTimestampsOption("no-timestamps", "Don't embed the send time in stream frames.");
+    QCommandLineOption deadmanOption("deadman", "Stop the motors after this long without a heartbeat, 0 = off.", "ms", "300");
+
+    parser.addOptions({portOption, latencyOption, jitterOption, lossOption, bandwidthOption,
+                       fpsOption, sizeOption, recordingOption, logOption, quietOption,
+                       noTimestampsOption, deadmanOption});
+    parser.process(app);
+
+    MockRobotConfig config;
+    config.port = static_cast<quint16>(parser.value(portOption).toUInt());
+    config.latencyMs = parser.value(latencyOption).toInt();
+    config.jitterMs = parser.value(jitterOption).toInt();
+    config.lossRate = qBound(0.0, parser.value(lossOption).toDouble() / 100.0, 1.0);
+    config.bandwidthKBps = parser.value(bandwidthOption).toInt();
+    config.frameRate = qMax(1, parser.value(fpsOption).toInt());
+    config.recordingPath = parser.value(recordingOption);
+    config.logPath = parser.value(logOption);
+    config.logRequests = !parser.isSet(quietOption);
+    config.embedTimestamps = !parser.isSet(noTimestampsOption);
+    config.deadmanTimeoutMs = qMax(0, parser.value(deadmanOption).toInt());
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    if (size.size() == 2) {
+        config.frameWidth = qMax(16, size[0].toInt());
+        config.frameHeight = qMax(16, size[1].toInt());
+    }
+
+    MockRobotServer server(config);
+    if (!server.start()) {
+        return 1;
+    }
+
+    return app.exec();
+}
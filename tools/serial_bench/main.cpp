@@ -0,0 +1,206 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTextStream>
+#include <QtMath>
+
+#include "SerialInputParser.h"
+
+// Measures CarController's serial input parsing on a capture of the
+// hardware controller's byte stream, against the QString path it replaced.
+// Captures are raw bytes as read from the port, e.g. recorded with
+//
+//   stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.bin
+//
+//   ./serialBench --capture capture.bin
+//   ./serialBench --format binary --samples 200000 --noise 0.1
+//   ./serialBench --format ascii --save ascii.bin
+
+namespace {
+
+struct Result {
+    double seconds = 0.0;
+    quint64 samples = 0;
+    quint64 rejected = 0;
+};
+
+QByteArray syntheticCapture(const QString &format, int samples, double noisePercent)
+{
+    QByteArray capture;
+    capture.reserve(samples * 12);
+    char frame[SerialInputParser::FRAME_SIZE];
+
+    for (int i = 0; i < samples; ++i) {
+        // Slow sweeps of both sticks, like a driver moving them
+        const int speed = qRound(255 * qSin(i * 0.002));
+        const int turn = qRound(50 * qSin(i * 0.0071));
+        const bool binary = format == "binary" || (format == "mixed" && (i / 1000) % 2);
+        if (binary) {
+            SerialInputParser::encodeFrame(static_cast<qint16>(speed), static_cast<qint16>(turn), frame);
+            capture.append(frame, sizeof(frame));
+        } else {
+            capture.append(QByteArray::number(speed)).append(',')
+                   .append(QByteArray::number(turn)).append("\r\n");
+        }
+    }
+
+    // Line noise: flip random bits
+    QRandomGenerator random(42);
+    const qsizetype flips = qsizetype(capture.size() * noisePercent / 100.0);
+    for (qsizetype i = 0; i < flips; ++i) {
+        const qsizetype at = random.bounded(capture.size());
+        capture[at] = static_cast<char>(capture[at] ^ (1 << random.bounded(8)));
+    }
+    return capture;
+}
+
+Result runParser(const QByteArray &capture, int chunk, int iterations)
+{
+    Result result;
+    SerialInputParser::Sample sample;
+    int checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        SerialInputParser parser;
+        // Feed in port-sized reads so partial lines and frames are exercised
+        for (qsizetype offset = 0; offset < capture.size(); offset += chunk) {
+            const char *data = capture.constData() + offset;
+            const char *end = data + qMin<qsizetype>(chunk, capture.size() - offset);
+            while (parser.next(data, end, sample)) {
+                checksum += sample.speed ^ sample.turn;
+            }
+        }
+        result.samples += parser.asciiSamples() + parser.binarySamples();
+        result.rejected += parser.malformedLines() + parser.crcErrors();
+    }
+    result.seconds = timer.nsecsElapsed() / 1e9;
+
+    if (checksum == 0x7FFFFFFF) {
+        qDebug() << "unlikely"; // Keeps the loop from being optimized out
+    }
+    return result;
+}
+
+// The readLine/QString/split path readSerialData used before
+Result runLegacy(const QByteArray &capture, int iterations)
+{
+    Result result;
+    int checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        qsizetype start = 0;
+        qsizetype newline;
+        while ((newline = capture.indexOf('\n', start)) >= 0) {
+            QByteArray data = capture.mid(start, newline - start + 1);
+            start = newline + 1;
+
+            QString dataString = QString::fromUtf8(data).trimmed();
+            QStringList values = dataString.split(',');
+            if (values.size() == 2) {
+                bool speedOk, turnOk;
+                int speed = values[0].toInt(&speedOk);
+                int turn = values[1].toInt(&turnOk);
+                if (speedOk && turnOk) {
+                    checksum += speed ^ turn;
+                    ++result.samples;
+                    continue;
+                }
+            }
+            ++result.rejected;
+        }
+    }
+    result.seconds = timer.nsecsElapsed() / 1e9;
+
+    if (checksum == 0x7FFFFFFF) {
+        qDebug() << "unlikely";
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serial input parser benchmark");
+    parser.addHelpOption();
+    QCommandLineOption captureOption("capture", "Raw serial capture to parse instead of synthetic data.", "file");
+    QCommandLineOption formatOption("format", "Synthetic capture encoding: ascii, binary or mixed.", "format", "ascii");
+    QCommandLineOption samplesOption("samples", "Samples in the synthetic capture.", "n", "100000");
+    QCommandLineOption noiseOption("noise", "Percentage of synthetic bytes with a flipped bit.", "percent", "0");
+    QCommandLineOption chunkOption("chunk", "Bytes delivered per port read.", "bytes", "64");
+    QCommandLineOption iterationsOption("iterations", "Passes over the capture.", "n", "20");
+    QCommandLineOption saveOption("save", "Write the synthetic capture to a file.", "file");
+    parser.addOptions({captureOption, formatOption, samplesOption, noiseOption,
+                       chunkOption, iterationsOption, saveOption});
+    parser.process(app);
+
+    QByteArray capture;
+    if (parser.isSet(captureOption)) {
+        QFile file(parser.value(captureOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not open" << file.fileName();
+            return 1;
+        }
+        capture = file.readAll();
+    } else {
+        capture = syntheticCapture(parser.value(formatOption),
+                                   qMax(1, parser.value(samplesOption).toInt()),
+                                   parser.value(noiseOption).toDouble());
+    }
+
+    if (parser.isSet(saveOption)) {
+        QFile file(parser.value(saveOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(capture) != capture.size()) {
+            qWarning() << "Could not write" << file.fileName();
+            return 1;
+        }
+    }
+
+    if (capture.isEmpty()) {
+        qWarning() << "Capture is empty";
+        return 1;
+    }
+
+    const int chunk = qMax(1, parser.value(chunkOption).toInt());
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+
+    QTextStream out(stdout);
+    out << "Capture " << capture.size() << " bytes, " << chunk << "-byte reads, "
+        << iterations << " passes\n\n";
+
+    out << qSetFieldWidth(20) << Qt::left << "path" << qSetFieldWidth(12) << Qt::right
+        << "MB/s" << "samples/s" << "ns/sample" << "samples" << "rejected" << qSetFieldWidth(0) << '\n';
+
+    auto report = [&](const QString &name, const Result &result) {
+        const double megabytes = double(capture.size()) * iterations / (1024.0 * 1024.0);
+        const quint64 perPass = result.samples / iterations;
+        out << qSetFieldWidth(20) << Qt::left << name << qSetFieldWidth(12) << Qt::right
+            << QString::number(megabytes / result.seconds, 'f', 1)
+            << QString::number(result.samples / result.seconds, 'f', 0)
+            << QString::number(result.samples ? result.seconds * 1e9 / result.samples : 0.0, 'f', 1)
+            << perPass << result.rejected / iterations << qSetFieldWidth(0) << '\n';
+    };
+
+    const Result parsed = runParser(capture, chunk, iterations);
+    report("SerialInputParser", parsed);
+    const Result legacy = runLegacy(capture, iterations);
+    report("QString split", legacy);
+
+    // 115200 baud 8N1 carries 11520 bytes/s
+    out << "\nSpeed-up over the QString path: "
+        << QString::number(legacy.seconds / parsed.seconds, 'f', 1) << "x; parser headroom at 115200 baud: "
+        << QString::number(double(capture.size()) * iterations / parsed.seconds / 11520.0, 'f', 0) << "x\n";
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+#include <QtMath>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// Creates a uinput virtual gamepad and sweeps its sticks, for exercising
+// CarController's evdev backend without hardware. Needs write access to
+// /dev/uinput (root, or a udev rule for the input group).
+//
+//   ./virtualGamepad --rate 250 --duration 30
+//   ./virtualGamepad --pattern steps
+
+namespace {
+
+bool setupAxis(int fd, int code, int minimum, int maximum, int flat)
+{
+    struct uinput_abs_setup setup = {};
+    setup.code = static_cast<__u16>(code);
+    setup.absinfo.minimum = minimum;
+    setup.absinfo.maximum = maximum;
+    setup.absinfo.flat = flat;
+    return ioctl(fd, UI_SET_ABSBIT, code) == 0 && ioctl(fd, UI_ABS_SETUP, &setup) == 0;
+}
+
+void emitEvent(int fd, int type, int code, int value)
+{
+    struct input_event event = {};
+    event.type = static_cast<__u16>(type);
+    event.code = static_cast<__u16>(code);
+    event.value = value;
+    if (write(fd, &event, sizeof(event)) != sizeof(event)) {
+        qWarning() << "write failed:" << strerror(errno);
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Virtual gamepad for testing the evdev input backend");
+    parser.addHelpOption();
+    QCommandLineOption rateOption("rate", "Reports per second.", "hz", "250");
+    QCommandLineOption durationOption("duration", "Seconds to run; 0 runs until killed.", "s", "0");
+    QCommandLineOption patternOption("pattern", "sweep (smooth sines) or steps (full deflection jumps).",
+                                     "pattern", "sweep");
+    parser.addOptions({rateOption, durationOption, patternOption});
+    parser.process(app);
+
+    const int rate = qBound(1, parser.value(rateOption).toInt(), 2000);
+    const double duration = parser.value(durationOption).toDouble();
+    const bool steps = parser.value(patternOption) == "steps";
+
+    const int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        qWarning() << "Could not open /dev/uinput:" << strerror(errno);
+        return 1;
+    }
+
+    // Buttons are what make the kernel and CarController treat it as a gamepad
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_KEYBIT, BTN_SOUTH);
+    ioctl(fd, UI_SET_KEYBIT, BTN_EAST);
+    ioctl(fd, UI_SET_EVBIT, EV_ABS);
+
+    // Same ranges as a typical Xbox-style pad
+    const int range = 32767;
+    if (!setupAxis(fd, ABS_X, -range - 1, range, 128) || !setupAxis(fd, ABS_Y, -range - 1, range, 128)
+        || !setupAxis(fd, ABS_RX, -range - 1, range, 128) || !setupAxis(fd, ABS_RY, -range - 1, range, 128)) {
+        qWarning() << "Could not set up axes:" << strerror(errno);
+        close(fd);
+        return 1;
+    }
+
+    struct uinput_setup setup = {};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1234;
+    setup.id.product = 0x5678;
+    std::strncpy(setup.name, "RC_GUI virtual gamepad", UINPUT_MAX_NAME_SIZE - 1);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        qWarning() << "Could not create device:" << strerror(errno);
+        close(fd);
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << "Virtual gamepad running at " << rate << " Hz, pattern "
+        << (steps ? "steps" : "sweep") << Qt::endl;
+
+    QElapsedTimer clock;
+    clock.start();
+    const qint64 periodNs = 1000000000LL / rate;
+    qint64 next = 0;
+    quint64 reports = 0;
+
+    while (duration <= 0 || clock.elapsed() < duration * 1000) {
+        const double t = clock.nsecsElapsed() / 1e9;
+        int speed, turn;
+        if (steps) {
+            // Forward, stop, reverse, stop, with a turn on every other step
+            static const int SPEEDS[] = {range, 0, -range, 0};
+            const int phase = static_cast<int>(t) % 4;
+            speed = SPEEDS[phase];
+            turn = phase % 2 == 0 ? range / 2 : 0;
+        } else {
+            speed = qRound(range * qSin(t * 0.7));
+            turn = qRound(range * qSin(t * 1.9));
+        }
+
+        // Forward on the stick is negative Y
+        emitEvent(fd, EV_ABS, ABS_Y, -speed);
+        emitEvent(fd, EV_ABS, ABS_RX, turn);
+        emitEvent(fd, EV_SYN, SYN_REPORT, 0);
+        ++reports;
+
+        next += periodNs;
+        const qint64 wait = next - clock.nsecsElapsed();
+        if (wait > 0) {
+            QThread::usleep(static_cast<unsigned long>(wait / 1000));
+        }
+    }
+
+    out << reports << " reports sent" << Qt::endl;
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    return 0;
+}